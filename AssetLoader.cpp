@@ -0,0 +1,568 @@
+#include "AssetLoader.h"
+#include "MeshCache.h"
+#include "ThreadPool.h"
+#include "ChannelPacker.h"
+#include "TextureAtlas.h"
+#include "DDSTextureLoader.h"
+#include <wincodec.h>
+#include <fstream>
+#include <stdio.h>
+
+AssetLoader::AssetLoader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+{
+	this->device = device;
+	this->context = context;
+	pending = 0;
+	running = 0;
+	closing = false;
+}
+
+AssetLoader::~AssetLoader()
+{
+	// The workers still point at this, so wait for them - but loads
+	// that haven't started yet give up (see Cancelled) rather than
+	// decoding.  Whatever was made is thrown away; the game is
+	// shutting down anyway.
+	std::unique_lock<std::mutex> lock(loadMutex);
+	closing = true;
+	loadCondition.wait(lock, [&]() { return running == 0; });
+}
+
+void AssetLoader::LoadTexture(const std::wstring& file, Material* material, const std::string& textureName, TextureKind kind,
+	std::function<void(unsigned long long)> onLoaded)
+{
+	LoadInBackground([this, file, kind](unsigned long long* bytes, DirectX::XMFLOAT2* uvScale) { return LoadTextureNow(file, kind, bytes, uvScale); },
+		material, textureName, onLoaded);
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetLoader::LoadTextureNow(const std::wstring& file, TextureKind kind, unsigned long long* bytes,
+	DirectX::XMFLOAT2* uvScale)
+{
+	if (bytes)
+		*bytes = 0;
+
+	// Cooked on an earlier run?
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv = LoadCached(std::vector<std::wstring>(1, file), file, kind, bytes, uvScale);
+	if (srv)
+		return srv;
+
+	DecodedImage image;
+	if (!DecodeImage(file.c_str(), image))
+	{
+#if defined(DEBUG) || defined(_DEBUG)
+		printf("Could not load texture %ls\n", file.c_str());
+#endif
+		return nullptr;
+	}
+	return Cook(image, kind, file, bytes, uvScale);
+}
+
+void AssetLoader::LoadSurfaceTexture(const std::wstring& roughnessFile, const std::wstring& metalnessFile,
+	Material* material, const std::string& textureName, std::function<void(unsigned long long)> onLoaded)
+{
+	LoadInBackground([this, roughnessFile, metalnessFile](unsigned long long* bytes, DirectX::XMFLOAT2* uvScale)
+	{
+		return LoadSurfaceTextureNow(roughnessFile, metalnessFile, bytes, uvScale);
+	}, material, textureName, onLoaded);
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetLoader::LoadSurfaceTextureNow(const std::wstring& roughnessFile, const std::wstring& metalnessFile,
+	unsigned long long* bytes, DirectX::XMFLOAT2* uvScale)
+{
+	if (bytes)
+		*bytes = 0;
+
+	const std::wstring files[2] = { roughnessFile, metalnessFile };
+	std::vector<std::wstring> sources;
+	unsigned int hash = 2166136261u;
+	for (int c = 0; c < 2; c++)
+	{
+		if (!files[c].empty())
+			sources.push_back(files[c]);
+
+		// Each combination gets its own cache
+		HashName(files[c] + L"|", hash);
+	}
+	if (sources.empty())
+		return nullptr;
+
+	// BC5 keeps each of the two as sharp as its own BC4 texture would be
+	wchar_t suffix[16];
+	swprintf_s(suffix, L".%08x", hash);
+	std::wstring cacheBase = sources[0] + suffix;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv = LoadCached(sources, cacheBase, SurfaceTexture, bytes, uvScale);
+	if (srv)
+		return srv;
+
+	DecodedImage channels[2];
+	const MipLevel* packSources[3] = {};
+	bool anyDecoded = false;
+	for (int c = 0; c < 2; c++)
+	{
+		if (files[c].empty())
+			continue;
+
+		if (!DecodeImage(files[c].c_str(), channels[c]))
+		{
+#if defined(DEBUG) || defined(_DEBUG)
+			printf("Could not load texture %ls\n", files[c].c_str());
+#endif
+			continue;
+		}
+		packSources[c] = &channels[c].mips[0];
+		anyDecoded = true;
+	}
+	if (!anyDecoded)
+		return nullptr;
+
+	// No map means smooth and not metal (blue isn't kept by BC5)
+	static const unsigned char constants[3] = { 0, 0, 0 };
+	DecodedImage packed;
+	packed.mips.resize(1);
+	ChannelPacker::Pack(packSources, constants, packed.mips[0]);
+	return Cook(packed, SurfaceTexture, cacheBase, bytes, uvScale);
+}
+
+bool AssetLoader::PlanAtlas(const std::vector<std::wstring>& files, TextureAtlas& atlas)
+{
+	std::vector<unsigned int> widths(files.size(), 0);
+	std::vector<unsigned int> heights(files.size(), 0);
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		// One that can't be read keeps 0 x 0, which still gets a (white) spot
+		if (!ReadImageSize(files[i].c_str(), widths[i], heights[i]))
+		{
+#if defined(DEBUG) || defined(_DEBUG)
+			printf("Could not load texture %ls\n", files[i].c_str());
+#endif
+		}
+	}
+
+	if (!atlas.Plan(files, widths, heights, D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION))
+	{
+#if defined(DEBUG) || defined(_DEBUG)
+		printf("Could not fit %zu images into one atlas\n", files.size());
+#endif
+		return false;
+	}
+
+#if defined(DEBUG) || defined(_DEBUG)
+	printf("Atlas of %zu images starting with %ls: %ux%u, %.1f%% used\n", files.size(), files[0].c_str(),
+		atlas.GetWidth(), atlas.GetHeight(), atlas.GetEfficiency() * 100.0f);
+#endif
+	return true;
+}
+
+void AssetLoader::LoadAtlas(TextureAtlas* atlas, Material* material, const std::string& textureName, std::function<void(unsigned long long)> onLoaded)
+{
+	LoadInBackground([this, atlas](unsigned long long* bytes, DirectX::XMFLOAT2* uvScale) { return LoadAtlasNow(atlas, bytes, uvScale); },
+		material, textureName, onLoaded);
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetLoader::LoadAtlasNow(TextureAtlas* atlas, unsigned long long* bytes, DirectX::XMFLOAT2* uvScale)
+{
+	if (bytes)
+		*bytes = 0;
+	if (atlas->GetImageCount() == 0 || atlas->GetWidth() == 0)
+		return nullptr;
+
+	// The names and the layout both go into the cache's name, so
+	// a different set of images (or a new layout) cooks afresh
+	std::vector<std::wstring> sources;
+	unsigned int hash = 2166136261u;
+	for (int i = 0; i < atlas->GetImageCount(); i++)
+	{
+		sources.push_back(atlas->GetFile(i));
+		HashName(atlas->GetFile(i) + L"|", hash);
+	}
+	HashName(std::to_wstring(atlas->GetWidth()) + L"x" + std::to_wstring(atlas->GetHeight()), hash);
+
+	wchar_t suffix[32];
+	swprintf_s(suffix, L".atlas.%08x", hash);
+	std::wstring cacheBase = sources[0] + suffix;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv = LoadCached(sources, cacheBase, ColorTexture, bytes, uvScale);
+	if (srv)
+		return srv;
+
+	DecodedImage packed;
+	packed.mips.resize(1);
+	MipLevel& top = packed.mips[0];
+	top.width = atlas->GetWidth();
+	top.height = atlas->GetHeight();
+	top.pixels.resize((size_t)top.width * top.height * 4);
+
+	// Every image has its own spot, so they can all go in at once
+	ThreadPool::GetInstance().ParallelFor(atlas->GetImageCount(), [atlas, &top](int i)
+	{
+		DecodedImage image;
+		bool decoded = DecodeImage(atlas->GetFile(i).c_str(), image);
+#if defined(DEBUG) || defined(_DEBUG)
+		if (!decoded)
+			printf("Could not load texture %ls\n", atlas->GetFile(i).c_str());
+#endif
+		atlas->Place(i, decoded ? &image.mips[0] : nullptr, top);
+	});
+
+	// The gutters only cover the first few mips
+	return Cook(packed, ColorTexture, cacheBase, bytes, uvScale, ATLAS_MIP_LEVELS);
+}
+
+void AssetLoader::LoadMesh(const std::string& file, bool optimize, bool packVertices, std::function<void(std::shared_ptr<Mesh>)> onLoaded)
+{
+	{
+		std::lock_guard<std::mutex> lock(loadMutex);
+		pending++;
+		running++;
+	}
+
+	// Making buffers is fine off the main thread (the device is
+	// thread safe), so the whole mesh is built on the worker
+	ThreadPool::GetInstance().Enqueue([this, file, optimize, packVertices, onLoaded]()
+	{
+		if (Cancelled())
+			return;
+
+		std::shared_ptr<Mesh> mesh = MeshCache::GetInstance().Load(file.c_str(), device, optimize, packVertices);
+		Complete([mesh, onLoaded]() { onLoaded(mesh); });
+	});
+}
+
+void AssetLoader::Update()
+{
+	std::vector<std::function<void()>> ready;
+	{
+		std::lock_guard<std::mutex> lock(loadMutex);
+		ready.swap(completed);
+	}
+
+	for (std::function<void()>& finish : ready)
+	{
+		finish();
+	}
+
+	std::lock_guard<std::mutex> lock(loadMutex);
+	pending -= (int)ready.size();
+}
+
+void AssetLoader::Finish()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(loadMutex);
+			loadCondition.wait(lock, [&]() { return pending == 0 || !completed.empty(); });
+			if (pending == 0)
+				return;
+		}
+		Update();
+	}
+}
+
+int AssetLoader::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(loadMutex);
+	return pending;
+}
+
+void AssetLoader::Complete(std::function<void()> onMainThread)
+{
+	{
+		std::lock_guard<std::mutex> lock(loadMutex);
+		completed.push_back(onMainThread);
+		running--;
+	}
+	loadCondition.notify_all();
+}
+
+// Called by a worker before it starts a load.  Once the loader is
+// being destroyed the load is dropped (and no longer running).
+bool AssetLoader::Cancelled()
+{
+	{
+		std::lock_guard<std::mutex> lock(loadMutex);
+		if (!closing)
+			return false;
+		running--;
+	}
+	loadCondition.notify_all();
+	return true;
+}
+
+// Reads any image WIC understands into tightly packed RGBA8 (the top mip)
+bool AssetLoader::DecodeImage(const wchar_t* file, DecodedImage& image)
+{
+	image.mips.resize(1);
+	MipLevel& top = image.mips[0];
+
+	// Each worker needs COM before it can touch WIC
+	HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	bool decoded = false;
+	{
+		Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+		Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+		Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+		Microsoft::WRL::ComPtr<IWICFormatConverter> converter;
+
+		if (SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf())))
+			&& SUCCEEDED(factory->CreateDecoderFromFilename(file, nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf()))
+			&& SUCCEEDED(decoder->GetFrame(0, frame.GetAddressOf()))
+			&& SUCCEEDED(frame->GetSize(&top.width, &top.height))
+			&& SUCCEEDED(factory->CreateFormatConverter(converter.GetAddressOf()))
+			&& SUCCEEDED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom)))
+		{
+			UINT stride = top.width * 4;
+			top.pixels.resize((size_t)stride * top.height);
+			decoded = top.width > 0 && top.height > 0
+				&& SUCCEEDED(converter->CopyPixels(nullptr, stride, (UINT)top.pixels.size(), &top.pixels[0]));
+		}
+	}
+
+	if (SUCCEEDED(comResult))
+		CoUninitialize();
+
+	return decoded;
+}
+
+// Reads only as far as the image's size, without decoding it
+bool AssetLoader::ReadImageSize(const wchar_t* file, unsigned int& width, unsigned int& height)
+{
+	HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	bool read = false;
+	{
+		Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+		Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+		Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+
+		read = SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf())))
+			&& SUCCEEDED(factory->CreateDecoderFromFilename(file, nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf()))
+			&& SUCCEEDED(decoder->GetFrame(0, frame.GetAddressOf()))
+			&& SUCCEEDED(frame->GetSize(&width, &height));
+	}
+
+	if (SUCCEEDED(comResult))
+		CoUninitialize();
+
+	return read;
+}
+
+// GPU memory for the image and its mip chain
+unsigned long long AssetLoader::GetTextureBytes(const DecodedImage& image)
+{
+	unsigned long long bytes = 0;
+	for (const MipLevel& mip : image.mips)
+	{
+		bytes += mip.pixels.size();
+	}
+	return bytes;
+}
+
+void AssetLoader::LoadInBackground(std::function<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>(unsigned long long*, DirectX::XMFLOAT2*)> load,
+	Material* material, const std::string& textureName, std::function<void(unsigned long long)> onLoaded)
+{
+	{
+		std::lock_guard<std::mutex> lock(loadMutex);
+		pending++;
+		running++;
+	}
+
+	// Creating textures only needs the device (which is thread
+	// safe), so the whole load happens on the worker
+	ThreadPool::GetInstance().Enqueue([this, load, material, textureName, onLoaded]()
+	{
+		if (Cancelled())
+			return;
+
+		unsigned long long bytes = 0;
+		DirectX::XMFLOAT2 uvScale(1.0f, 1.0f);
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv = load(&bytes, &uvScale);
+
+		// A failed load still reports in (as nothing), so nobody waits on it
+		Complete([srv, bytes, uvScale, material, textureName, onLoaded]()
+		{
+			if (srv)
+			{
+				material->SetTextureSRV(textureName, srv);
+				material->SetTextureUVScale(uvScale);
+			}
+			if (onLoaded)
+				onLoaded(bytes);
+		});
+	});
+}
+
+// Loads a texture cooked on an earlier run, or returns null if there isn't one.
+// A ColorTexture may have been cooked with its alpha, so that's tried too.
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetLoader::LoadCached(const std::vector<std::wstring>& sources, const std::wstring& cacheBase, TextureKind kind,
+	unsigned long long* bytes, DirectX::XMFLOAT2* uvScale)
+{
+	if (kind == ColorTexture)
+	{
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv = LoadCached(sources, cacheBase, ColorAlphaTexture, bytes, uvScale);
+		if (srv)
+			return srv;
+	}
+
+	std::wstring cachePath = GetCachePath(cacheBase, kind);
+	unsigned long long cacheSize = 0;
+	std::vector<unsigned char> dds;
+	if (!IsCacheCurrent(sources, cachePath, cacheSize) || !ReadCache(cachePath, dds))
+		return nullptr;
+	return CreateCompressedTexture(dds, bytes, uvScale);
+}
+
+// Compresses a freshly decoded image, saves it for next time and makes the texture
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetLoader::Cook(DecodedImage& image, TextureKind kind, const std::wstring& cacheBase, unsigned long long* bytes,
+	DirectX::XMFLOAT2* uvScale, unsigned int maxMipLevels)
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+
+	// Smaller than a block, so it stays RGBA8
+	if (!TextureCompressor::CanCompress(image.mips[0]))
+	{
+		MipGenerator::GenerateMips(image.mips);
+		if (maxMipLevels > 0 && image.mips.size() > maxMipLevels)
+			image.mips.resize(maxMipLevels);
+		srv = UploadImage(image);
+		if (srv && bytes)
+			*bytes = GetTextureBytes(image);
+		if (uvScale)
+			*uvScale = DirectX::XMFLOAT2(1.0f, 1.0f);
+		return srv;
+	}
+
+	// BC1 would throw away the alpha of cut outs and decals
+	if (kind == ColorTexture && TextureCompressor::HasAlpha(image.mips[0]))
+		kind = ColorAlphaTexture;
+
+	unsigned int imageWidth = image.mips[0].width;
+	unsigned int imageHeight = image.mips[0].height;
+	TextureCompressor::PadToBlocks(image.mips[0]);
+	MipGenerator::GenerateMips(image.mips);
+	if (maxMipLevels > 0 && image.mips.size() > maxMipLevels)
+		image.mips.resize(maxMipLevels);
+	std::vector<unsigned char> dds;
+	TextureCompressor::BuildDDS(image.mips, kind, dds, imageWidth, imageHeight);
+	WriteCache(GetCachePath(cacheBase, kind), dds);
+	return CreateCompressedTexture(dds, bytes, uvScale);
+}
+
+// Makes the texture for a DDS file of ours, with the UV scale its padding needs
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetLoader::CreateCompressedTexture(const std::vector<unsigned char>& dds, unsigned long long* bytes,
+	DirectX::XMFLOAT2* uvScale)
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	if (FAILED(DirectX::CreateDDSTextureFromMemory(device.Get(), &dds[0], dds.size(), nullptr, srv.GetAddressOf())))
+		return nullptr;
+	if (bytes)
+		*bytes = dds.size() - DDS_FILE_HEADER_SIZE;
+	if (uvScale)
+		TextureCompressor::ReadImageScale(&dds[0], uvScale->x, uvScale->y);
+	return srv;
+}
+
+// For images too small to compress.  Every mip is already
+// built, so the texture goes up in one go and never changes
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetLoader::UploadImage(const DecodedImage& image)
+{
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = image.mips[0].width;
+	desc.Height = image.mips[0].height;
+	desc.MipLevels = (UINT)image.mips.size();
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData(image.mips.size());
+	for (size_t i = 0; i < image.mips.size(); i++)
+	{
+		initialData[i].pSysMem = &image.mips[i].pixels[0];
+		initialData[i].SysMemPitch = image.mips[i].width * 4;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	if (FAILED(device->CreateTexture2D(&desc, &initialData[0], texture.GetAddressOf())))
+		return nullptr;
+	if (FAILED(device->CreateShaderResourceView(texture.Get(), nullptr, srv.GetAddressOf())))
+		return nullptr;
+	return srv;
+}
+
+// FNV-1a, for telling caches built from different sets of files apart
+void AssetLoader::HashName(const std::wstring& name, unsigned int& hash)
+{
+	for (wchar_t character : name)
+	{
+		hash ^= (unsigned int)character;
+		hash *= 16777619u;
+	}
+}
+
+// Each format gets its own file, as the same image could be used as more than one kind
+std::wstring AssetLoader::GetCachePath(const std::wstring& file, TextureKind kind)
+{
+	int channels = TextureCompressor::GetChannelCount(kind);
+	return file + (channels == 4 ? L".bc3.dds" : (channels == 3 ? L".bc1.dds" : (channels == 2 ? L".bc5.dds" : L".bc4.dds")));
+}
+
+// The cache is good as long as it was written after the sources last changed
+bool AssetLoader::IsCacheCurrent(const std::vector<std::wstring>& sources, const std::wstring& cachePath, unsigned long long& cacheSize)
+{
+	WIN32_FILE_ATTRIBUTE_DATA cache = {};
+	if (!GetFileAttributesExW(cachePath.c_str(), GetFileExInfoStandard, &cache))
+		return false;
+
+	cacheSize = ((unsigned long long)cache.nFileSizeHigh << 32) | cache.nFileSizeLow;
+	if (cacheSize <= DDS_FILE_HEADER_SIZE)
+		return false;
+
+	for (const std::wstring& file : sources)
+	{
+		// No source at all?  Then the cache is all we have
+		WIN32_FILE_ATTRIBUTE_DATA source = {};
+		if (GetFileAttributesExW(file.c_str(), GetFileExInfoStandard, &source)
+			&& CompareFileTime(&cache.ftLastWriteTime, &source.ftLastWriteTime) < 0)
+			return false;
+	}
+	return true;
+}
+
+// The whole file, so the texture and its header come from one read
+bool AssetLoader::ReadCache(const std::wstring& cachePath, std::vector<unsigned char>& dds)
+{
+	std::ifstream in(cachePath.c_str(), std::ios::binary | std::ios::ate);
+	if (!in.is_open())
+		return false;
+	std::streamoff size = in.tellg();
+	if (size <= (std::streamoff)DDS_FILE_HEADER_SIZE)
+		return false;
+	dds.resize((size_t)size);
+	in.seekg(0);
+	return (bool)in.read((char*)&dds[0], size);
+}
+
+// Writes to a temporary file first, so another worker (or the next run)
+// never sees half a file.  Failing just means cooking again next time.
+void AssetLoader::WriteCache(const std::wstring& cachePath, const std::vector<unsigned char>& dds)
+{
+	std::wstring tempPath = cachePath + L"." + std::to_wstring(GetCurrentThreadId()) + L".tmp";
+	{
+		std::ofstream out(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return;
+		out.write((const char*)&dds[0], dds.size());
+		if (!out.good())
+		{
+			out.close();
+			DeleteFileW(tempPath.c_str());
+			return;
+		}
+	}
+
+	if (!MoveFileExW(tempPath.c_str(), cachePath.c_str(), MOVEFILE_REPLACE_EXISTING))
+		DeleteFileW(tempPath.c_str());
+}
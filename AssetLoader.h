@@ -0,0 +1,125 @@
+#pragma once
+
+#include "DXCore.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "MipGenerator.h"
+#include "TextureCompressor.h"
+#include "TextureAtlas.h"
+#include <wrl/client.h>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Loads textures and meshes in the background
+//
+// Files are read and decoded on the ThreadPool's workers,
+// which also build the textures' mip chains and create the
+// textures and buffers (the device is free threaded; the
+// immediate context is only used on the main thread).  The
+// results wait until Update() runs on the main thread, which
+// swaps them in.  Until then materials keep whatever
+// placeholder textures they were given.
+//
+// Textures are block compressed the first time they load and
+// the result is kept in a .dds file next to the source, so
+// later runs just hand that to DDSTextureLoader.
+// --------------------------------------------------------
+class AssetLoader
+{
+public:
+	AssetLoader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	~AssetLoader();
+
+	// Loads the image in the background, then puts it in the
+	// material's textureName slot and calls onLoaded (if given) with
+	// the texture's size in bytes (0 if it couldn't be loaded).  The
+	// material also takes the texture's UV scale, which is under 1
+	// when the image was padded out to whole blocks - so all of a
+	// material's textures should be the same size.
+	void LoadTexture(const std::wstring& file, Material* material, const std::string& textureName, TextureKind kind,
+		std::function<void(unsigned long long)> onLoaded = nullptr);
+
+	// Loads the image on the calling thread, from the compressed cache
+	// if it's up to date or else cooking (and caching) it first.  A
+	// ColorTexture with any transparency is kept as ColorAlphaTexture.
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> LoadTextureNow(const std::wstring& file, TextureKind kind, unsigned long long* bytes = nullptr,
+		DirectX::XMFLOAT2* uvScale = nullptr);
+
+	// Like LoadTexture, but packs the red channels of two images (either
+	// can be left empty) into one texture: roughness and metalness.
+	// Ambient occlusion is a separate GrayscaleTexture - the three maps
+	// aren't related, and BC1 can't keep three unrelated channels sharp.
+	void LoadSurfaceTexture(const std::wstring& roughnessFile, const std::wstring& metalnessFile,
+		Material* material, const std::string& textureName, std::function<void(unsigned long long)> onLoaded = nullptr);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> LoadSurfaceTextureNow(const std::wstring& roughnessFile, const std::wstring& metalnessFile,
+		unsigned long long* bytes = nullptr, DirectX::XMFLOAT2* uvScale = nullptr);
+
+	// Reads just the images' sizes and lays them out in the atlas, so
+	// entities can take their UVs from it before any pixels load
+	bool PlanAtlas(const std::vector<std::wstring>& files, TextureAtlas& atlas);
+
+	// Like LoadTexture, for every image in a planned atlas at once.
+	// The atlas has to outlive the load.
+	void LoadAtlas(TextureAtlas* atlas, Material* material, const std::string& textureName, std::function<void(unsigned long long)> onLoaded = nullptr);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> LoadAtlasNow(TextureAtlas* atlas, unsigned long long* bytes = nullptr, DirectX::XMFLOAT2* uvScale = nullptr);
+
+	// Builds the mesh (through MeshCache) in the background, then
+	// hands it to onLoaded on the main thread
+	void LoadMesh(const std::string& file, bool optimize, bool packVertices, std::function<void(std::shared_ptr<Mesh>)> onLoaded);
+
+	// Finishes off everything that's done loading - main thread only
+	void Update();
+
+	// Blocks until everything queued so far has loaded
+	void Finish();
+
+	int GetPendingCount();
+
+private:
+	// An image decoded to RGBA8 with all its mips, waiting for upload
+	struct DecodedImage
+	{
+		std::vector<MipLevel> mips;
+	};
+
+	static bool DecodeImage(const wchar_t* file, DecodedImage& image);
+	static bool ReadImageSize(const wchar_t* file, unsigned int& width, unsigned int& height);
+	static unsigned long long GetTextureBytes(const DecodedImage& image);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> UploadImage(const DecodedImage& image);
+
+	// The shared halves of the two kinds of texture load.  cacheBase
+	// is the cache's path, less the suffix GetCachePath() adds.
+	void LoadInBackground(std::function<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>(unsigned long long*, DirectX::XMFLOAT2*)> load,
+		Material* material, const std::string& textureName, std::function<void(unsigned long long)> onLoaded);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> LoadCached(const std::vector<std::wstring>& sources, const std::wstring& cacheBase, TextureKind kind,
+		unsigned long long* bytes, DirectX::XMFLOAT2* uvScale);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Cook(DecodedImage& image, TextureKind kind, const std::wstring& cacheBase, unsigned long long* bytes,
+		DirectX::XMFLOAT2* uvScale, unsigned int maxMipLevels = 0); // 0 is the full chain
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateCompressedTexture(const std::vector<unsigned char>& dds, unsigned long long* bytes,
+		DirectX::XMFLOAT2* uvScale);
+
+	static void HashName(const std::wstring& name, unsigned int& hash);
+	static std::wstring GetCachePath(const std::wstring& file, TextureKind kind);
+	static bool IsCacheCurrent(const std::vector<std::wstring>& sources, const std::wstring& cachePath, unsigned long long& cacheSize);
+	static bool ReadCache(const std::wstring& cachePath, std::vector<unsigned char>& dds);
+	static void WriteCache(const std::wstring& cachePath, const std::vector<unsigned char>& dds);
+
+	// Called by the workers with the main thread's half of the job
+	void Complete(std::function<void()> onMainThread);
+	bool Cancelled();
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+	std::mutex loadMutex;
+	std::condition_variable loadCondition;
+	std::vector<std::function<void()>> completed;
+	int pending;	// Queued and not yet through Update
+	int running;	// Still on a worker
+	bool closing;	// Being destroyed, so loads not yet started are dropped
+};
@@ -0,0 +1,172 @@
+#include "AtlasPacker.h"
+#include <algorithm>
+
+bool AtlasPacker::Pack(std::vector<AtlasRect>& rects, unsigned int maxSize, unsigned int& atlasWidth, unsigned int& atlasHeight)
+{
+	// Tallest first (widest breaking ties) keeps the skyline flattest
+	std::vector<size_t> order(rects.size());
+	for (size_t i = 0; i < rects.size(); i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&rects](size_t a, size_t b)
+	{
+		if (rects[a].height != rects[b].height)
+			return rects[a].height > rects[b].height;
+		return rects[a].width > rects[b].width;
+	});
+
+	unsigned int widest = 0;
+	unsigned long long totalWidth = 0;
+	for (const AtlasRect& rect : rects)
+	{
+		widest = rect.width > widest ? rect.width : widest;
+		totalWidth += rect.width;
+	}
+	if (widest > maxSize)
+		return false;
+
+	// Nothing's gained going wider than everything in one row
+	unsigned int widthLimit = totalWidth < maxSize ? (unsigned int)totalWidth : maxSize;
+
+	// Try a spread of widths from the widest rect up to that
+	static const unsigned int WIDTH_STEPS = 64;
+	bool packed = false;
+	unsigned long long bestArea = 0;
+	std::vector<AtlasRect> best;
+	for (unsigned int step = 0; step <= WIDTH_STEPS; step++)
+	{
+		AtlasPacker packer(widest + (unsigned int)((unsigned long long)(widthLimit - widest) * step / WIDTH_STEPS));
+		std::vector<AtlasRect> placed = rects;
+		bool fits = true;
+		for (size_t i : order)
+		{
+			if (!packer.Insert(placed[i].width, placed[i].height, placed[i].x, placed[i].y) || packer.GetHeight() > maxSize)
+			{
+				fits = false;
+				break;
+			}
+		}
+		if (!fits)
+			continue;
+
+		// The rects don't always reach all the way across
+		unsigned int width = 0;
+		for (const AtlasRect& rect : placed)
+			width = rect.x + rect.width > width ? rect.x + rect.width : width;
+		unsigned int height = packer.GetHeight();
+
+		// Least area wins, then the squarer of two the same
+		unsigned long long area = (unsigned long long)width * height;
+		unsigned int longSide = width > height ? width : height;
+		if (!packed || area < bestArea || (area == bestArea && longSide < (atlasWidth > atlasHeight ? atlasWidth : atlasHeight)))
+		{
+			packed = true;
+			bestArea = area;
+			best = placed;
+			atlasWidth = width;
+			atlasHeight = height;
+		}
+	}
+
+	if (packed)
+		rects = best;
+	return packed;
+}
+
+AtlasPacker::AtlasPacker(unsigned int width)
+{
+	this->width = width;
+	height = 0;
+	skyline.push_back({ 0, 0, width });
+}
+
+bool AtlasPacker::Insert(unsigned int width, unsigned int height, unsigned int& x, unsigned int& y)
+{
+	// Find the segment that leaves the rect's top lowest
+	size_t best = skyline.size();
+	unsigned int bestY = 0;
+	unsigned long long bestWaste = 0;
+	for (size_t i = 0; i < skyline.size(); i++)
+	{
+		unsigned int fitY;
+		unsigned long long waste;
+		if (!Fit(i, width, fitY, waste))
+			continue;
+
+		if (best == skyline.size() || fitY < bestY || (fitY == bestY && waste < bestWaste))
+		{
+			best = i;
+			bestY = fitY;
+			bestWaste = waste;
+		}
+	}
+	if (best == skyline.size())
+		return false;
+
+	x = skyline[best].x;
+	y = bestY;
+
+	// The segments under the rect go, and one partly under it gets trimmed
+	unsigned int right = x + width;
+	size_t i = best;
+	while (i < skyline.size() && skyline[i].x < right)
+	{
+		unsigned int end = skyline[i].x + skyline[i].width;
+		if (end > right)
+		{
+			skyline[i].x = right;
+			skyline[i].width = end - right;
+			break;
+		}
+		skyline.erase(skyline.begin() + i);
+	}
+	skyline.insert(skyline.begin() + best, { x, y + height, width });
+
+	// Neighbors at the same height are really one segment
+	for (i = 0; i + 1 < skyline.size(); )
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	if (y + height > this->height)
+		this->height = y + height;
+	return true;
+}
+
+unsigned int AtlasPacker::GetHeight()
+{
+	return height;
+}
+
+bool AtlasPacker::Fit(size_t i, unsigned int width, unsigned int& y, unsigned long long& waste)
+{
+	unsigned int left = skyline[i].x;
+	unsigned int right = left + width;
+	if (right > this->width)
+		return false;
+
+	// It rests on the highest segment it spans...
+	y = 0;
+	for (size_t j = i; j < skyline.size() && skyline[j].x < right; j++)
+	{
+		if (skyline[j].y > y)
+			y = skyline[j].y;
+	}
+
+	// ...leaving gaps over the lower ones
+	waste = 0;
+	for (size_t j = i; j < skyline.size() && skyline[j].x < right; j++)
+	{
+		unsigned int end = skyline[j].x + skyline[j].width;
+		end = end < right ? end : right;
+		waste += (unsigned long long)(y - skyline[j].y) * (end - skyline[j].x);
+	}
+	return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// A spot in an atlas, in texels
+struct AtlasRect
+{
+	unsigned int x;
+	unsigned int y;
+	unsigned int width;
+	unsigned int height;
+};
+
+// --------------------------------------------------------
+// Packs rectangles into as small an atlas as it can
+//
+// Everything placed so far is summed up by its skyline - the
+// top edge of the pile, kept as a list of flat segments.  A
+// new rect sits at whichever segment leaves its top lowest
+// (ties go to the spot wasting less space underneath), then
+// raises the skyline over itself.  Pack() feeds the rects in
+// tallest first, tries a range of atlas widths and keeps the
+// one with the least area.
+// --------------------------------------------------------
+class AtlasPacker
+{
+public:
+	// Places rects (their width and height are the input, x and y the
+	// output) and gives back the atlas size that just holds them.
+	// False if there's no way to fit them in maxSize both ways.
+	static bool Pack(std::vector<AtlasRect>& rects, unsigned int maxSize, unsigned int& atlasWidth, unsigned int& atlasHeight);
+
+	// Packs into a fixed width, growing as tall as it needs to
+	AtlasPacker(unsigned int width);
+	bool Insert(unsigned int width, unsigned int height, unsigned int& x, unsigned int& y);
+	unsigned int GetHeight();
+
+private:
+	struct SkylineSegment
+	{
+		unsigned int x;
+		unsigned int y;
+		unsigned int width;
+	};
+
+	// Where a rect starting at segment i would sit, or false if it runs off the side
+	bool Fit(size_t i, unsigned int width, unsigned int& y, unsigned long long& waste);
+
+	std::vector<SkylineSegment> skyline;
+	unsigned int width;
+	unsigned int height;
+};
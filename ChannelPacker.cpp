@@ -0,0 +1,69 @@
+#include "ChannelPacker.h"
+#include <cstddef>
+
+void ChannelPacker::Pack(const MipLevel* const sources[3], const unsigned char constants[3], MipLevel& packed)
+{
+	packed.width = 1;
+	packed.height = 1;
+	for (int c = 0; c < 3; c++)
+	{
+		if (sources[c] && sources[c]->width > packed.width)
+			packed.width = sources[c]->width;
+		if (sources[c] && sources[c]->height > packed.height)
+			packed.height = sources[c]->height;
+	}
+	packed.pixels.resize((size_t)packed.width * packed.height * 4);
+
+	for (int c = 0; c < 3; c++)
+	{
+		const MipLevel* source = sources[c];
+		unsigned char* out = &packed.pixels[c];
+
+		if (!source)
+		{
+			for (size_t i = 0; i < (size_t)packed.width * packed.height; i++)
+				out[i * 4] = constants[c];
+			continue;
+		}
+
+		// Same size is just a copy
+		if (source->width == packed.width && source->height == packed.height)
+		{
+			for (size_t i = 0; i < (size_t)packed.width * packed.height; i++)
+				out[i * 4] = source->pixels[i * 4];
+			continue;
+		}
+
+		// Line up texel centers, then sample in the source's texels
+		float scaleX = (float)source->width / packed.width;
+		float scaleY = (float)source->height / packed.height;
+		for (unsigned int y = 0; y < packed.height; y++)
+		{
+			for (unsigned int x = 0; x < packed.width; x++)
+			{
+				out[((size_t)y * packed.width + x) * 4] = SampleRed(*source, (x + 0.5f) * scaleX - 0.5f, (y + 0.5f) * scaleY - 0.5f);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < (size_t)packed.width * packed.height; i++)
+		packed.pixels[i * 4 + 3] = 255;
+}
+
+// Bilinear, clamped at the edges
+unsigned char ChannelPacker::SampleRed(const MipLevel& source, float x, float y)
+{
+	x = x < 0 ? 0 : (x > source.width - 1 ? (float)(source.width - 1) : x);
+	y = y < 0 ? 0 : (y > source.height - 1 ? (float)(source.height - 1) : y);
+
+	unsigned int x0 = (unsigned int)x;
+	unsigned int y0 = (unsigned int)y;
+	unsigned int x1 = x0 + 1 < source.width ? x0 + 1 : x0;
+	unsigned int y1 = y0 + 1 < source.height ? y0 + 1 : y0;
+	float fx = x - x0;
+	float fy = y - y0;
+
+	float top = source.pixels[((size_t)y0 * source.width + x0) * 4] * (1 - fx) + source.pixels[((size_t)y0 * source.width + x1) * 4] * fx;
+	float bottom = source.pixels[((size_t)y1 * source.width + x0) * 4] * (1 - fx) + source.pixels[((size_t)y1 * source.width + x1) * 4] * fx;
+	return (unsigned char)(top * (1 - fy) + bottom * fy + 0.5f);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "MipGenerator.h"
+
+// --------------------------------------------------------
+// Packs single channel images into one RGBA8 image
+//
+// Each output channel takes the red channel of its source,
+// or a constant where there's no source.  The result is as
+// big as the largest source, and smaller ones are scaled up
+// bilinearly to match (e.g. a 128x128 metalness map going
+// in with a 1024x1024 roughness map).
+// --------------------------------------------------------
+class ChannelPacker
+{
+public:
+	// sources[c] (or nullptr) fills channel c, constants[c] fills it
+	// otherwise.  Alpha is always 255.
+	static void Pack(const MipLevel* const sources[3], const unsigned char constants[3], MipLevel& packed);
+
+private:
+	static unsigned char SampleRed(const MipLevel& source, float x, float y);
+};
@@ -1,7 +1,8 @@
 #include "Exhibit.h"
+#include <unordered_set>
 
 //std::vector<GameEntity*>* Exhibit::mainEntityList;
-Mesh* Exhibit::cube;
+std::shared_ptr<Mesh> Exhibit::cube;
 Material* Exhibit::cobblestone;
 Material* Exhibit::marble;
 
@@ -56,10 +57,23 @@ const std::vector<GameEntity*>* Exhibit::GetEntities()
 	return surfaces;
 }
 
+// everything placed here with PlaceObject()
+const std::vector<GameEntity*>& Exhibit::GetObjects()
+{
+	return objects;
+}
+
+// the exhibits this one has a doorway to
+const std::vector<Exhibit*>& Exhibit::GetNeighbors()
+{
+	return neighbors;
+}
+
 // places the entity relative to the origin of this room for convenience
 void Exhibit::PlaceObject(GameEntity* entity, const DirectX::XMFLOAT3& position)
 {
 	entity->GetTransform()->SetPosition(origin.x + position.x, origin.y + position.y, origin.z + position.z);
+	objects.push_back(entity);
 }
 
 // places this exhibit up against another one in the desired direction. This does not move objects already within the exhibit and can only be used once per exhibit
@@ -85,6 +99,10 @@ void Exhibit::AttachTo(Exhibit* other, Direction direction)
 	XMFLOAT3 oldOrigin = origin;
 	origin = XMFLOAT3(other->origin.x + shiftDir.x * scale, 0, other->origin.z + shiftDir.y * scale);
 
+	// remember the doorway both ways, for streaming
+	neighbors.push_back(other);
+	other->neighbors.push_back(this);
+
 	// shift walls and floors
 	XMFLOAT3 shift = XMFLOAT3(origin.x - oldOrigin.x, 0, origin.z - oldOrigin.z);
 	for (GameEntity* surface : *surfaces) {
@@ -182,3 +200,21 @@ bool Exhibit::IsInExhibit(const XMFLOAT3& position)
 		&& position.z > origin.z - size / 2
 		&& position.z < origin.z + size / 2;
 }
+
+// adds up each mesh once, however many entities here share it
+unsigned long long Exhibit::GetMeshMemory()
+{
+	std::unordered_set<Mesh*> meshes;
+	for (GameEntity* surface : *surfaces) {
+		meshes.insert(surface->GetMesh());
+	}
+	for (GameEntity* object : objects) {
+		meshes.insert(object->GetMesh());
+	}
+
+	unsigned long long bytes = 0;
+	for (Mesh* mesh : meshes) {
+		bytes += mesh->GetMemorySize();
+	}
+	return bytes;
+}
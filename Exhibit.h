@@ -13,7 +13,7 @@ enum Direction {
 class Exhibit
 {
 public:
-	static Mesh* cube;
+	static std::shared_ptr<Mesh> cube;
 	static Material* cobblestone;
 	static Material* marble;
 
@@ -21,15 +21,20 @@ public:
 	Exhibit(float size);
 	~Exhibit();
 	const std::vector<GameEntity*>* GetEntities();
+	const std::vector<GameEntity*>& GetObjects();
+	const std::vector<Exhibit*>& GetNeighbors();
 	void PlaceObject(GameEntity* entity, const XMFLOAT3& position);
 	void AttachTo(Exhibit* other, Direction direction);
 	void CheckCollisions(Camera* camera);
 	bool IsInExhibit(const XMFLOAT3& position);
+	unsigned long long GetMeshMemory(); // GPU memory of the distinct meshes in here
 	DirectX::XMFLOAT3 origin;
 private:
 	
 	float size;
 	std::vector<GameEntity*>* surfaces; // the floor and walls
+	std::vector<GameEntity*> objects; // everything placed in here (owned by Game)
+	std::vector<Exhibit*> neighbors; // exhibits joined by AttachTo(), either way round
 	const float THICKNESS = 1;
 	const float WALL_HEIGHT = 15;
 };
\ No newline at end of file
@@ -3,11 +3,14 @@
 #include "Particle.h"
 #include "Input.h"
 #include "Exhibit.h"
+#include "MeshCache.h"
+#include "ThreadPool.h"
 
 // Needed for a helper function to read compiled shader files from the hard drive
 #pragma comment(lib, "d3dcompiler.lib")
 #include <d3dcompiler.h>
 #include <math.h>
+#include <algorithm>
 
 //For texture
 #include "WICTextureLoader.h"
@@ -33,6 +36,9 @@ Game::Game(HINSTANCE hInstance)
 		true)			   // Show extra stats (fps) in title bar?
 {
 	camera = 0;
+	assetLoader = 0;
+	residency = 0;
+	textureBudgetMB = 256;
 	ambientColor= XMFLOAT3(0.2f, 0.2f, 0.2f);
 	//Set up exhibit variables
 	exhibitIndex = 0;
@@ -55,6 +61,12 @@ Game::Game(HINSTANCE hInstance)
 // --------------------------------------------------------
 Game::~Game()
 {
+	// Loads still in flight refer to the materials below
+	delete assetLoader;
+	assetLoader = nullptr;
+
+	delete residency;
+	residency = nullptr;
 
 	for (auto& en : entityList) { 
 		delete en; 
@@ -71,14 +83,18 @@ Game::~Game()
 		mat = nullptr;
 	}
 
+	for (auto& atlas : atlasList) {
+		delete atlas;
+		atlas = nullptr;
+	}
+
 	delete camera;
 	camera = nullptr;
 
-	delete cube;
-	cube= nullptr;
-
-	delete sphere;
+	// The meshes go once the last entity using them is gone
+	cube = nullptr;
 	sphere = nullptr;
+	Exhibit::cube = nullptr;
 
 	delete pixelShader;
 	pixelShader = nullptr;
@@ -110,17 +126,29 @@ Game::~Game()
 	delete vertexShaderShadow;
 	vertexShaderShadow = nullptr;
 
+	delete vertexShaderPacked;
+	vertexShaderPacked = nullptr;
+
+	delete vertexShaderShadowPacked;
+	vertexShaderShadowPacked = nullptr;
+
 	delete pixelShaderParticle;
 	pixelShaderParticle = nullptr;
 
 	delete vertexShaderParticle;
 	vertexShaderParticle = nullptr;
 
+	delete vertexShaderParticleCPU;
+	vertexShaderParticleCPU = nullptr;
+
 	delete sky;
 	sky = nullptr;
 
 	delete particleManager;
 	particleManager = nullptr;
+
+	// Every load and particle job is finished, so join the workers
+	ThreadPool::Shutdown();
 }
 
 // --------------------------------------------------------
@@ -170,6 +198,10 @@ void Game::Init()
 	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/defaults/blackTexture.png").c_str(), 0, defaultBlackSRV.GetAddressOf());
 	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/defaults/defaultNormals.png").c_str(), 0, defaultNormalSRV.GetAddressOf());
 	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/defaults/pureWhite.png").c_str(), 0, pureWhiteSRV.GetAddressOf());
+
+	// Everything else loads in the background, showing the defaults above until it's ready
+	assetLoader = new AssetLoader(device, context);
+	residency = new ResidencyManager((unsigned long long)textureBudgetMB << 20);
 	
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> spaceBox = CreateCubemap(
 		GetFullPathTo_Wide(L"../../Assets/Textures/SmallerSpaceBox/Left_Tex.png").c_str(),
@@ -227,22 +259,30 @@ void Game::Init()
 		L"../../Assets/Textures/marble/Marble_Tiles_001_basecolor.jpg",
 		L"../../Assets/Textures/marble/Marble_Tiles_001_normal.jpg",
 		L"../../Assets/Textures/marble/Marble_Tiles_001_roughness.jpg",
-		nullptr
+		nullptr,
+		L"../../Assets/Textures/marble/Marble_Tiles_001_ambientOcclusion.jpg"
 	);
 
-	auto MakeSign = [&](Material* material) {
-		GameEntity* sign = new GameEntity(cube, material);
+	// every sign comes out of one atlas, so they all share a material
+	const wchar_t* introSignImage = L"../../Assets/Textures/signs/intro sign.png";
+	const wchar_t* blurSignImage = L"../../Assets/Textures/signs/blur sign.png";
+	const wchar_t* brightnessSignImage = L"../../Assets/Textures/signs/brightness sign.png";
+	const wchar_t* bloomSignImage = L"../../Assets/Textures/signs/bloom sign.png";
+	const wchar_t* celSignImage = L"../../Assets/Textures/signs/cel sign.png";
+	const wchar_t* particleSignImage = L"../../Assets/Textures/signs/particle sign.png";
+	const wchar_t* everythingSignImage = L"../../Assets/Textures/signs/everything sign.png";
+	TextureAtlas* signAtlas = CreateAtlas({ introSignImage, blurSignImage, brightnessSignImage, bloomSignImage,
+		celSignImage, particleSignImage, everythingSignImage });
+	Material* signMaterial = CreateAtlasMaterial(signAtlas);
+
+	auto MakeSign = [&](const wchar_t* image) {
+		GameEntity* sign = new GameEntity(cube, signMaterial);
 		entityList.push_back(sign);
 		sign->GetTransform()->SetScale(0.1f, 3.5f, 4.5f);
+		UseAtlasImage(sign, signAtlas, image);
 		return sign;
 	};
 
-	Material* blurSignMat = CreateMaterial(L"../../Assets/Textures/signs/blur sign.png", nullptr, nullptr, nullptr);
-	Material* brightnessSignMat = CreateMaterial(L"../../Assets/Textures/signs/brightness sign.png", nullptr, nullptr, nullptr);
-	Material* bloomSignMat = CreateMaterial(L"../../Assets/Textures/signs/bloom sign.png", nullptr, nullptr, nullptr);
-	Material* celSignMat = CreateMaterial(L"../../Assets/Textures/signs/cel sign.png", nullptr, nullptr, nullptr);
-	Material* particleSignMat = CreateMaterial(L"../../Assets/Textures/signs/particle sign.png", nullptr, nullptr, nullptr);
-
 	// intro exhibit
 	exhibits[Intro] = new Exhibit(30);
 	GameEntity* firstPillar = new GameEntity(cube, Exhibit::marble);
@@ -250,14 +290,14 @@ void Game::Init()
 	firstPillar->GetTransform()->SetScale(5, 10, 5);
 	exhibits[Intro]->PlaceObject(firstPillar, XMFLOAT3(0, 5, 0));
 
-	GameEntity* introSign = MakeSign(CreateMaterial(L"../../Assets/Textures/signs/intro sign.png", nullptr, nullptr, nullptr));
+	GameEntity* introSign = MakeSign(introSignImage);
 	introSign->GetTransform()->SetRotation(0, XM_PIDIV2, 0);
 	exhibits[Intro]->PlaceObject(introSign, XMFLOAT3(0, 6, -2.5f));
 
-	GameEntity* introToBlurSign = MakeSign(blurSignMat);
+	GameEntity* introToBlurSign = MakeSign(blurSignImage);
 	exhibits[Intro]->PlaceObject(introToBlurSign, XMFLOAT3(14.5f, 6, -7.0f));
 
-	GameEntity* introToBrightnessSign = MakeSign(brightnessSignMat);
+	GameEntity* introToBrightnessSign = MakeSign(brightnessSignImage);
 	exhibits[Intro]->PlaceObject(introToBrightnessSign, XMFLOAT3(-14.5f, 6, -7.0f));
 
 	// brightness contrast exhibit
@@ -274,53 +314,66 @@ void Game::Init()
 	exhibits[Blur] = new Exhibit(55);
 	exhibits[Blur]->AttachTo(exhibits[Intro], POSX);
 
-	Material* monaLisaMaterial = CreateMaterial(L"../../Assets/Textures/mona lisa.png", nullptr, nullptr, nullptr);
-	Material* starryNightMaterial = CreateMaterial(L"../../Assets/Textures/starry night.jpg", nullptr, nullptr, nullptr);
-	Material* persistMemMaterial = CreateMaterial(L"../../Assets/Textures/persistence memory.png", nullptr, nullptr, nullptr);
-	Material* pearlEarringMat = CreateMaterial(L"../../Assets/Textures/girl pearl earring.jpg", nullptr, nullptr, nullptr);
-	Material* convergenceMat = CreateMaterial(L"../../Assets/Textures/convergence.jpg", nullptr, nullptr, nullptr);
-	Material* sundayAfternoonMat = CreateMaterial(L"../../Assets/Textures/sunday afternoon.jpg", nullptr, nullptr, nullptr);
-	Material* impressionSunriseMat = CreateMaterial(L"../../Assets/Textures/impression sunrise.jpg", nullptr, nullptr, nullptr);
+	// the paintings share an atlas too (they all dither together anyway)
+	const wchar_t* monaLisaImage = L"../../Assets/Textures/mona lisa.png";
+	const wchar_t* starryNightImage = L"../../Assets/Textures/starry night.jpg";
+	const wchar_t* persistMemImage = L"../../Assets/Textures/persistence memory.png";
+	const wchar_t* pearlEarringImage = L"../../Assets/Textures/girl pearl earring.jpg";
+	const wchar_t* convergenceImage = L"../../Assets/Textures/convergence.jpg";
+	const wchar_t* sundayAfternoonImage = L"../../Assets/Textures/sunday afternoon.jpg";
+	const wchar_t* impressionSunriseImage = L"../../Assets/Textures/impression sunrise.jpg";
+	TextureAtlas* paintingAtlas = CreateAtlas({ monaLisaImage, starryNightImage, persistMemImage, pearlEarringImage,
+		convergenceImage, sundayAfternoonImage, impressionSunriseImage });
+	Material* paintingMaterial = CreateAtlasMaterial(paintingAtlas);
 	// neon lights
-	Material* neonlight1 = CreateMaterial(L"../../Assets/Textures/neon/neonlight1.png", nullptr, nullptr, nullptr);
-	Material* neonlight2 = CreateMaterial(L"../../Assets/Textures/neon/neonlight2.png", nullptr, nullptr, nullptr);
-	Material* neonlight3 = CreateMaterial(L"../../Assets/Textures/neon/neonlight3.png", nullptr, nullptr, nullptr);
+	const wchar_t* neonlight1 = L"../../Assets/Textures/neon/neonlight1.png";
+	const wchar_t* neonlight2 = L"../../Assets/Textures/neon/neonlight2.png";
+	const wchar_t* neonlight3 = L"../../Assets/Textures/neon/neonlight3.png";
+	TextureAtlas* neonAtlas = CreateAtlas({ neonlight1, neonlight2, neonlight3 });
+	Material* neonMaterial = CreateAtlasMaterial(neonAtlas);
 
-	GameEntity* starryNight = new GameEntity(cube, starryNightMaterial);
+	GameEntity* starryNight = new GameEntity(cube, paintingMaterial);
 	entityList.push_back(starryNight);
+	UseAtlasImage(starryNight, paintingAtlas, starryNightImage);
 	starryNight->GetTransform()->SetScale(1.0f, 12.0f, 16.0f);
 	starryNight->GetTransform()->SetRotation(0.0f, XM_PIDIV2, 0.0f);
 	exhibits[Blur]->PlaceObject(starryNight, XMFLOAT3(-16.0f, 7.5f, 27.4f));
 
-	GameEntity* persistenceMemory = new GameEntity(cube, persistMemMaterial);
+	GameEntity* persistenceMemory = new GameEntity(cube, paintingMaterial);
 	entityList.push_back(persistenceMemory);
+	UseAtlasImage(persistenceMemory, paintingAtlas, persistMemImage);
 	persistenceMemory->GetTransform()->SetScale(1.0f, 12.0f, 16.0f);
 	persistenceMemory->GetTransform()->SetRotation(0.0f, XM_PIDIV2, 0.0f);
 	exhibits[Blur]->PlaceObject(persistenceMemory, XMFLOAT3(16.0f, 7.5f, 27.4f));
 
-	GameEntity* theMonaLisa = new GameEntity(cube, monaLisaMaterial);
+	GameEntity* theMonaLisa = new GameEntity(cube, paintingMaterial);
 	entityList.push_back(theMonaLisa);
+	UseAtlasImage(theMonaLisa, paintingAtlas, monaLisaImage);
 	theMonaLisa->GetTransform()->SetScale(1.0f, 12.0f, 9.0);
 	exhibits[Blur]->PlaceObject(theMonaLisa, XMFLOAT3(-27.4f, 7.5f, 16.0f));
 
-	GameEntity* pearlEarring = new GameEntity(cube, pearlEarringMat);
+	GameEntity* pearlEarring = new GameEntity(cube, paintingMaterial);
 	entityList.push_back(pearlEarring);
+	UseAtlasImage(pearlEarring, paintingAtlas, pearlEarringImage);
 	pearlEarring->GetTransform()->SetScale(1.0f, 12.0f, 9.0f);
 	exhibits[Blur]->PlaceObject(pearlEarring, XMFLOAT3(-27.4f, 7.5f, -16.0f));
 
-	GameEntity* convergence = new GameEntity(cube, convergenceMat);
+	GameEntity* convergence = new GameEntity(cube, paintingMaterial);
 	entityList.push_back(convergence);
+	UseAtlasImage(convergence, paintingAtlas, convergenceImage);
 	convergence->GetTransform()->SetScale(1.0f, 12.0f, 20.0f);
 	exhibits[Blur]->PlaceObject(convergence, XMFLOAT3(27.4f, 7.5f, 0.0f));
 
-	GameEntity* sundayAfternoon = new GameEntity(cube, sundayAfternoonMat);
+	GameEntity* sundayAfternoon = new GameEntity(cube, paintingMaterial);
 	entityList.push_back(sundayAfternoon);
+	UseAtlasImage(sundayAfternoon, paintingAtlas, sundayAfternoonImage);
 	sundayAfternoon->GetTransform()->SetScale(1.0f, 12.0f, 16.0f);
 	sundayAfternoon->GetTransform()->SetRotation(0.0f, XM_PIDIV2, 0.0f);
 	exhibits[Blur]->PlaceObject(sundayAfternoon, XMFLOAT3(-12.0f, 7.5f, -27.4f));
 
-	GameEntity* impressionSunrise = new GameEntity(cube, impressionSunriseMat);
+	GameEntity* impressionSunrise = new GameEntity(cube, paintingMaterial);
 	entityList.push_back(impressionSunrise);
+	UseAtlasImage(impressionSunrise, paintingAtlas, impressionSunriseImage);
 	impressionSunrise->GetTransform()->SetScale(1.0f, 12.0f, 16.0f);
 	impressionSunrise->GetTransform()->SetRotation(0.0f, XM_PIDIV2, 0.0f);
 	exhibits[Blur]->PlaceObject(impressionSunrise, XMFLOAT3(12.0f, 7.5f, -27.4f));
@@ -336,19 +389,19 @@ void Game::Init()
 	// halls
 	exhibits[LeftHall] = new Exhibit(20);
 	exhibits[LeftHall]->AttachTo(exhibits[BrightContrast], POSZ);
-	GameEntity* hallToBright = MakeSign(brightnessSignMat);
+	GameEntity* hallToBright = MakeSign(brightnessSignImage);
 	hallToBright->GetTransform()->SetRotation(0, XM_PIDIV2, 0);
 	exhibits[LeftHall]->PlaceObject(hallToBright, XMFLOAT3(-6.5f, 7.5f, -9.5f));
-	GameEntity* hallToCel = MakeSign(celSignMat);
+	GameEntity* hallToCel = MakeSign(celSignImage);
 	hallToCel->GetTransform()->SetRotation(0, XM_PIDIV2, 0);
 	exhibits[LeftHall]->PlaceObject(hallToCel, XMFLOAT3(-6.5f, 7.5f, 9.5f));
 
 	exhibits[RightHall] = new Exhibit(20);
 	exhibits[RightHall]->AttachTo(exhibits[Blur], POSZ);
-	GameEntity* hallToBlur = MakeSign(blurSignMat);
+	GameEntity* hallToBlur = MakeSign(blurSignImage);
 	hallToBlur->GetTransform()->SetRotation(0, XM_PIDIV2, 0);
 	exhibits[RightHall]->PlaceObject(hallToBlur, XMFLOAT3(6.5f, 7.5f, -9.5f));
-	GameEntity* hallToBloom = MakeSign(bloomSignMat);
+	GameEntity* hallToBloom = MakeSign(bloomSignImage);
 	hallToBloom->GetTransform()->SetRotation(0, XM_PIDIV2, 0);
 	exhibits[RightHall]->PlaceObject(hallToBloom, XMFLOAT3(6.5f, 7.5f, 9.5f));
 
@@ -356,21 +409,25 @@ void Game::Init()
 	exhibits[CelShading] = new Exhibit(40);
 	exhibits[CelShading]->AttachTo(exhibits[LeftHall], POSZ);
 
-	Mesh* statueMesh = new Mesh(GetFullPathTo("../../Assets/Models/statue/statue.obj").c_str(), device);
+	// the statue is big, so it shows up whenever it's ready
 	Material* statueMaterial = CreateColorMaterial(XMFLOAT3(0.5f, 0.5f, 0.5f));
-	GameEntity* statue = new GameEntity(statueMesh, statueMaterial);
-	statue->GetTransform()->SetScale(0.1f, 0.1f, 0.1f);
-	statue->GetTransform()->SetRotation(XM_PIDIV2, -XM_PIDIV2, 0);
-	entityList.push_back(statue);
-	exhibits[CelShading]->PlaceObject(statue, XMFLOAT3(0.0f, 0.0f, 0.0f));
-	GameEntity* celToParticle = MakeSign(particleSignMat);
+	assetLoader->LoadMesh(GetFullPathTo("../../Assets/Models/statue/statue.obj"), true, true, [this, statueMaterial](std::shared_ptr<Mesh> statueMesh) {
+		GameEntity* statue = new GameEntity(statueMesh, statueMaterial);
+		statue->GetTransform()->SetScale(0.1f, 0.1f, 0.1f);
+		statue->GetTransform()->SetRotation(XM_PIDIV2, -XM_PIDIV2, 0);
+		entityList.push_back(statue);
+		exhibits[CelShading]->PlaceObject(statue, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	});
+	GameEntity* celToParticle = MakeSign(particleSignImage);
 	exhibits[CelShading]->PlaceObject(celToParticle, XMFLOAT3(19.5f, 7.5f, 7.0f));
 
 	// bloom & emmisive
 	exhibits[Bloom] = new Exhibit(40);
 	exhibits[Bloom]->AttachTo(exhibits[RightHall], POSZ);
-	GameEntity* neonlightObj1 = new GameEntity(cube, neonlight1);
-	GameEntity* neonlightObj4 = new GameEntity(cube, neonlight1);
+	GameEntity* neonlightObj1 = new GameEntity(cube, neonMaterial);
+	GameEntity* neonlightObj4 = new GameEntity(cube, neonMaterial);
+	UseAtlasImage(neonlightObj1, neonAtlas, neonlight1);
+	UseAtlasImage(neonlightObj4, neonAtlas, neonlight1);
 	entityList.push_back(neonlightObj1);
 	entityList.push_back(neonlightObj4);
 	neonlightObj1->GetTransform()->SetScale(1.0f, 12.0f, 12.0f);
@@ -380,8 +437,10 @@ void Game::Init()
 	exhibits[Bloom]->PlaceObject(neonlightObj1, XMFLOAT3(10, 7, 19.5));
 	exhibits[Bloom]->PlaceObject(neonlightObj4, XMFLOAT3(19.5, 7, 10));
 
-	GameEntity* neonlightObj2 = new GameEntity(cube, neonlight2);
-	GameEntity* neonlightObj5 = new GameEntity(cube, neonlight2);
+	GameEntity* neonlightObj2 = new GameEntity(cube, neonMaterial);
+	GameEntity* neonlightObj5 = new GameEntity(cube, neonMaterial);
+	UseAtlasImage(neonlightObj2, neonAtlas, neonlight2);
+	UseAtlasImage(neonlightObj5, neonAtlas, neonlight2);
 	entityList.push_back(neonlightObj2);
 	entityList.push_back(neonlightObj5);
 	neonlightObj2->GetTransform()->SetScale(1.0f, 12.0f, 12.0f);
@@ -391,8 +450,10 @@ void Game::Init()
 	exhibits[Bloom]->PlaceObject(neonlightObj2, XMFLOAT3(0, 7, 19.5));
 	exhibits[Bloom]->PlaceObject(neonlightObj5, XMFLOAT3(19.5, 7, 0));
 
-	GameEntity* neonlightObj3 = new GameEntity(cube, neonlight3);
-	GameEntity* neonlightObj6 = new GameEntity(cube, neonlight3);
+	GameEntity* neonlightObj3 = new GameEntity(cube, neonMaterial);
+	GameEntity* neonlightObj6 = new GameEntity(cube, neonMaterial);
+	UseAtlasImage(neonlightObj3, neonAtlas, neonlight3);
+	UseAtlasImage(neonlightObj6, neonAtlas, neonlight3);
 	entityList.push_back(neonlightObj3);
 	entityList.push_back(neonlightObj6);
 	neonlightObj3->GetTransform()->SetScale(1.0f, 12.0f, 12.0f);
@@ -401,7 +462,7 @@ void Game::Init()
 	neonlightObj6->GetTransform()->SetRotation(0.0f, XM_PI, 0.0f);
 	exhibits[Bloom]->PlaceObject(neonlightObj3, XMFLOAT3(-10, 7, 19.5));
 	exhibits[Bloom]->PlaceObject(neonlightObj6, XMFLOAT3(19.5, 7, -10));
-	GameEntity* bloomToParticle = MakeSign(particleSignMat);
+	GameEntity* bloomToParticle = MakeSign(particleSignImage);
 	exhibits[Bloom]->PlaceObject(bloomToParticle, XMFLOAT3(-19.5f, 7.5f, 7.0f));
 
 	// particles
@@ -413,11 +474,11 @@ void Game::Init()
 	pmStartPos.z /= 2;
 	pmStartPos.y += 2;
 	particleManager = new ParticleManager(device, pmStartPos);
-	GameEntity* particleToCel = MakeSign(celSignMat);
+	GameEntity* particleToCel = MakeSign(celSignImage);
 	exhibits[Particles]->PlaceObject(particleToCel, XMFLOAT3(-22.0f, 7.5f, 7.0f));
-	GameEntity* particleToBloom = MakeSign(bloomSignMat);
+	GameEntity* particleToBloom = MakeSign(bloomSignImage);
 	exhibits[Particles]->PlaceObject(particleToBloom, XMFLOAT3(22.0f, 7.5f, 7.0f));
-	GameEntity* everythingSign = MakeSign(CreateMaterial(L"../../Assets/Textures/signs/everything sign.png", nullptr, nullptr, nullptr));
+	GameEntity* everythingSign = MakeSign(everythingSignImage);
 	everythingSign->GetTransform()->SetRotation(0, XM_PIDIV2, 0);
 	exhibits[Particles]->PlaceObject(everythingSign, XMFLOAT3(7.0f, 7.5f, 22.0f));
 
@@ -458,6 +519,43 @@ void Game::Init()
 	ditherObjects.push_back(earth);
 	ditherObjects.push_back(moon);
 	ditherObjects.push_back(sun);
+
+	CreateExhibitResidency();
+}
+
+// --------------------------------------------------------
+// Tells the residency manager which textures each exhibit
+// uses and how the exhibits connect, then starts loading
+// the ones around the first exhibit
+// --------------------------------------------------------
+void Game::CreateExhibitResidency()
+{
+	auto AddMaterial = [&](int exhibit, Material* material) {
+		for (int texture : materialTextures[material]) {
+			residency->AddRoomAsset(exhibit, texture);
+		}
+	};
+
+	for (int i = 0; i < NUM_EXHIBITS; i++) {
+		for (GameEntity* surface : *exhibits[i]->GetEntities()) {
+			AddMaterial(i, surface->GetMaterial());
+		}
+		for (GameEntity* object : exhibits[i]->GetObjects()) {
+			AddMaterial(i, object->GetMaterial());
+		}
+		for (Exhibit* neighbor : exhibits[i]->GetNeighbors()) {
+			int j = (int)(std::find(exhibits, exhibits + NUM_EXHIBITS, neighbor) - exhibits);
+			if (i < j) {
+				residency->ConnectRooms(i, j);
+			}
+		}
+	}
+
+	// the planets orbit instead of being placed, but they live here
+	AddMaterial(Everything, earth->GetMaterial());
+	AddMaterial(Everything, moon->GetMaterial());
+
+	residency->Update(exhibitIndex);
 }
 
 void Game::CreateShadowMapResources()
@@ -547,6 +645,7 @@ void Game::LoadShaders()
 	pixelShader = new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"PixelShader.cso").c_str());
 	vertexShaderShadow = new SimpleVertexShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"VertexShaderShadow.cso").c_str());
 	vertexShaderParticle = new SimpleVertexShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"ParticlesVS.cso").c_str());
+	vertexShaderParticleCPU = new SimpleVertexShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"ParticlesCPUVS.cso").c_str());
 	pixelShaderParticle = new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"ParticlesPS.cso").c_str());
 	vertexShaderSky = new SimpleVertexShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"VertexShaderSky.cso").c_str());
 	pixelShaderSky = new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"PixelShaderSky.cso").c_str());
@@ -556,12 +655,31 @@ void Game::LoadShaders()
 	pixelShaderBlur = new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"PixelShaderBlur.cso").c_str());
 	pixelShaderBloomE= new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"PixelShaderBloomE.cso").c_str());
 	pixelShaderNoPostProcess = new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"PixelShaderNoPostProcess.cso").c_str());
+	vertexShaderPacked = LoadPackedVertexShader(L"VertexShaderPacked.cso", false);
+	vertexShaderShadowPacked = LoadPackedVertexShader(L"VertexShaderShadowPacked.cso", true);
+}
+
+// --------------------------------------------------------
+// Loads a vertex shader that takes PackedVertex input.
+// Reflection can't tell SNORM16 or half floats from full
+// floats, so the input layout has to be made by hand.
+// --------------------------------------------------------
+SimpleVertexShader* Game::LoadPackedVertexShader(const wchar_t* shaderFile, bool positionOnly)
+{
+	std::wstring path = GetFullPathTo_Wide(shaderFile);
+
+	Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+	if (SUCCEEDED(D3DReadFileToBlob(path.c_str(), shaderBlob.GetAddressOf())))
+		inputLayout = Mesh::CreatePackedInputLayout(device, shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), positionOnly);
+
+	return new SimpleVertexShader(device.Get(), context.Get(), path.c_str(), inputLayout, false);
 }
 
 void Game::CreateBasicGeometry()
 {
-	cube = new Mesh(GetFullPathTo("../../Assets/Models/cube.obj").c_str(), device);
-	sphere = new Mesh(GetFullPathTo("../../Assets/Models/sphere.obj").c_str(), device);
+	cube = MeshCache::GetInstance().Load(GetFullPathTo("../../Assets/Models/cube.obj").c_str(), device);
+	sphere = MeshCache::GetInstance().Load(GetFullPathTo("../../Assets/Models/sphere.obj").c_str(), device);
 }
 
 void Game::CreateParticleStates() {
@@ -665,51 +783,111 @@ void Game::ResizePostProcessResources()
 	device->CreateShaderResourceView(sceneDepthsTexture.Get(), 0, sceneDepthSRV.GetAddressOf());
 }
 
-Material* Game::CreateMaterial(const wchar_t* albedoPath, const wchar_t* normalsPath, const wchar_t* roughnessPath, const wchar_t* metalPath)
+Material* Game::CreateMaterial(const wchar_t* albedoPath, const wchar_t* normalsPath, const wchar_t* roughnessPath, const wchar_t* metalPath, const wchar_t* ambientOcclusionPath)
 {
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> albedoSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> normalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> roughnessSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalSRV;
+	Material* material = new Material(DirectX::XMFLOAT3(+2.5f, +2.5f, +2.5f), 0.0f, pixelShader, vertexShader);
+	material->SetPackedVertexShader(vertexShaderPacked);
+	material->AddSamplerState("BasicSamplerState", samplerState);
+	material->AddTextureSRV("Albedo", pureWhiteSRV);
+	material->AddTextureSRV("NormalMap", defaultNormalSRV);
+	material->AddTextureSRV("SurfaceMap", defaultBlackSRV);
+	materialList.push_back(material);
 
-	CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(albedoPath).c_str(), 0, albedoSRV.GetAddressOf());
-	
-	if (normalsPath == nullptr) {
-		normalSRV = defaultNormalSRV;
-	} else {
-		CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(normalsPath).c_str(), 0, normalSRV.GetAddressOf());
+	// the real textures replace the defaults while the camera is nearby
+	StreamTexture(material, "Albedo", albedoPath, ColorTexture, pureWhiteSRV);
+	if (normalsPath != nullptr) {
+		StreamTexture(material, "NormalMap", normalsPath, NormalTexture, defaultNormalSRV);
 	}
-
-	if (roughnessPath == nullptr) {
-		roughnessSRV = defaultBlackSRV;
-	} else {
-		CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(roughnessPath).c_str(), 0, roughnessSRV.GetAddressOf());
+	if (roughnessPath != nullptr || metalPath != nullptr) {
+		StreamSurfaceTexture(material, roughnessPath, metalPath);
+	}
+	if (ambientOcclusionPath != nullptr) {
+		// the only materials that sample (or bind) an occlusion map
+		material->SetHasOcclusionMap(true);
+		material->AddTextureSRV("OcclusionMap", pureWhiteSRV);
+		StreamTexture(material, "OcclusionMap", ambientOcclusionPath, GrayscaleTexture, pureWhiteSRV);
 	}
+	return material;
+}
+
+void Game::StreamTexture(Material* material, const std::string& textureName, const wchar_t* path, TextureKind kind, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> placeholder)
+{
+	std::wstring fullPath = GetFullPathTo_Wide(path);
+	StreamTexture(material, textureName, placeholder,
+		[this, fullPath, material, textureName, kind](std::function<void(unsigned long long)> onLoaded) {
+			assetLoader->LoadTexture(fullPath, material, textureName, kind, onLoaded);
+		});
+}
+
+// roughness and metalness get packed into one texture
+void Game::StreamSurfaceTexture(Material* material, const wchar_t* roughnessPath, const wchar_t* metalPath)
+{
+	std::wstring roughness = roughnessPath ? GetFullPathTo_Wide(roughnessPath) : L"";
+	std::wstring metalness = metalPath ? GetFullPathTo_Wide(metalPath) : L"";
+	StreamTexture(material, "SurfaceMap", defaultBlackSRV,
+		[this, roughness, metalness, material](std::function<void(unsigned long long)> onLoaded) {
+			assetLoader->LoadSurfaceTexture(roughness, metalness, material, "SurfaceMap", onLoaded);
+		});
+}
 
-	if (metalPath == nullptr) {
-		metalSRV = defaultBlackSRV;
-	} else {
-		CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(metalPath).c_str(), 0, metalSRV.GetAddressOf());
+// Registers a texture with the residency manager, which loads it in the
+// background when needed and puts the placeholder back when it's evicted
+void Game::StreamTexture(Material* material, const std::string& textureName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> placeholder,
+	std::function<void(std::function<void(unsigned long long)>)> load)
+{
+	int texture = residency->AddAsset(
+		[this, load](int asset) {
+			load([this, asset](unsigned long long bytes) {
+				residency->AssetLoaded(asset, bytes);
+			});
+		},
+		[material, textureName, placeholder]() {
+			material->SetTextureSRV(textureName, placeholder);
+		});
+	materialTextures[material].push_back(texture);
+}
+
+// Lays out an atlas of the images, which a material can then stream in
+TextureAtlas* Game::CreateAtlas(const std::vector<const wchar_t*>& paths)
+{
+	std::vector<std::wstring> files;
+	for (const wchar_t* path : paths) {
+		files.push_back(GetFullPathTo_Wide(path));
 	}
+	TextureAtlas* atlas = new TextureAtlas();
+	assetLoader->PlanAtlas(files, *atlas);
+	atlasList.push_back(atlas);
+	return atlas;
+}
 
-	Material* material = new Material(DirectX::XMFLOAT3(+2.5f, +2.5f, +2.5f), 0.0f, pixelShader, vertexShader);
-	material->AddSamplerState("BasicSamplerState", samplerState);
-	material->AddTextureSRV("Albedo", albedoSRV);
-	material->AddTextureSRV("NormalMap", normalSRV);
-	material->AddTextureSRV("RoughnessMap", roughnessSRV);
-	material->AddTextureSRV("MetalnessMap", metalSRV);
-	materialList.push_back(material);
+// Like CreateMaterial with just an albedo, but the albedo is an atlas -
+// each entity using it needs UseAtlasImage() to pick its own image
+Material* Game::CreateAtlasMaterial(TextureAtlas* atlas)
+{
+	Material* material = CreateColorMaterial(DirectX::XMFLOAT3(+2.5f, +2.5f, +2.5f));
+	StreamTexture(material, "Albedo", pureWhiteSRV,
+		[this, atlas, material](std::function<void(unsigned long long)> onLoaded) {
+			assetLoader->LoadAtlas(atlas, material, "Albedo", onLoaded);
+		});
 	return material;
 }
 
+void Game::UseAtlasImage(GameEntity* entity, TextureAtlas* atlas, const wchar_t* path)
+{
+	int image = atlas->Find(GetFullPathTo_Wide(path));
+	if (image >= 0 && atlas->GetWidth() > 0) {
+		entity->SetUVTransform(atlas->GetUVScale(image), atlas->GetUVOffset(image));
+	}
+}
+
 Material* Game::CreateColorMaterial(XMFLOAT3 color)
 {
 	Material* material = new Material(color, 0.0f, pixelShader, vertexShader);
+	material->SetPackedVertexShader(vertexShaderPacked);
 	material->AddSamplerState("BasicSamplerState", samplerState);
 	material->AddTextureSRV("Albedo", pureWhiteSRV);
 	material->AddTextureSRV("NormalMap", defaultNormalSRV);
-	material->AddTextureSRV("RoughnessMap", defaultBlackSRV);
-	material->AddTextureSRV("MetalnessMap", defaultBlackSRV);
+	material->AddTextureSRV("SurfaceMap", defaultBlackSRV);
 	materialList.push_back(material);
 	return material;
 }
@@ -723,6 +901,9 @@ void Game::Update(float deltaTime, float totalTime)
 	if (Input::GetInstance().KeyDown(VK_ESCAPE))
 		Quit();
 
+	// swap in anything that finished loading since last frame
+	assetLoader->Update();
+
 	// allow exhibit walls to trap the camera
 	for(Exhibit* exhibit : exhibits) {
 		exhibit->CheckCollisions(camera);
@@ -751,6 +932,10 @@ void Game::Update(float deltaTime, float totalTime)
 			break;
 		}
 	}
+
+	// stream textures in and out around the current exhibit
+	residency->Update(exhibitIndex);
+
 	if (Input::GetInstance().KeyPress('E')) {
 		firstPerson = !firstPerson;
 		Input::GetInstance().SwapMouseVisible();
@@ -782,8 +967,8 @@ void Game::Draw(float deltaTime, float totalTime)
 	//also set up lighting stuff
 	
 	for (int i = 0; i < entityList.size(); i++) {
-		entityList[i]->GetMaterial()->GetVertexShader()->SetMatrix4x4("shadowView", shadowViewMatrix);
-		entityList[i]->GetMaterial()->GetVertexShader()->SetMatrix4x4("shadowProjection", shadowProjectionMatrix);
+		entityList[i]->GetVertexShader()->SetMatrix4x4("shadowView", shadowViewMatrix);
+		entityList[i]->GetVertexShader()->SetMatrix4x4("shadowProjection", shadowProjectionMatrix);
 		
 		entityList[i]->GetMaterial()->GetPixelShader()->SetFloat3("ambientColor",ambientColor);
 		entityList[i]->GetMaterial()->GetPixelShader()->SetData("lights", &lightList[0], sizeof(Light) * (int)lightList.size());
@@ -798,8 +983,8 @@ void Game::Draw(float deltaTime, float totalTime)
 	for (Exhibit* exhibit : exhibits) {
 		const std::vector<GameEntity*>* surfaces = exhibit->GetEntities();
 		for (GameEntity* surface : *surfaces) {
-			surface->GetMaterial()->GetVertexShader()->SetMatrix4x4("shadowView", shadowViewMatrix);
-			surface->GetMaterial()->GetVertexShader()->SetMatrix4x4("shadowProjection", shadowProjectionMatrix);
+			surface->GetVertexShader()->SetMatrix4x4("shadowView", shadowViewMatrix);
+			surface->GetVertexShader()->SetMatrix4x4("shadowProjection", shadowProjectionMatrix);
 
 			surface->GetMaterial()->GetPixelShader()->SetFloat3("ambientColor", ambientColor);
 			surface->GetMaterial()->GetPixelShader()->SetData("lights", &lightList[0], sizeof(Light) * (int)lightList.size());
@@ -850,6 +1035,25 @@ void Game::Draw(float deltaTime, float totalTime)
 		ImGui::DragFloat(": velocity", &particleManager->velocityRange, 0.01f, 0.0f, 5.0f);
 		ImGui::DragFloat(": particle size", &particleManager->particleSize, 0.01f, 0.1f, 1.0f);
 		ImGui::ColorEdit4(": particle color", &particleManager->particleColor.x);
+		ImGui::Checkbox(": expand particles on GPU", &particleManager->expandOnGPU);
+		ImGui::Text("particle upload: %.1f KB per frame", particleManager->GetUploadedBytes() / 1024.0);
+	}
+
+	MeshCacheStats meshStats = MeshCache::GetInstance().GetStats();
+	ImGui::Text("meshes: %u resident, %.1f KB (%u hits, %u misses)",
+		meshStats.residentMeshes, meshStats.residentBytes / 1024.0, meshStats.hits, meshStats.misses);
+	ImGui::Text("meshes in this exhibit: %.1f KB", exhibits[exhibitIndex]->GetMeshMemory() / 1024.0);
+	ImGui::Text("textures: %.1f MB resident, %.1f MB peak",
+		residency->GetResidentBytes() / 1048576.0, residency->GetPeakResidentBytes() / 1048576.0);
+	if (ImGui::DragInt(": texture budget (MB)", &textureBudgetMB, 1, 16, 4096)) {
+		residency->SetBudget((unsigned long long)textureBudgetMB << 20);
+	}
+	for (TextureAtlas* atlas : atlasList) {
+		ImGui::Text("atlas of %d images: %ux%u, %.1f%% used",
+			atlas->GetImageCount(), atlas->GetWidth(), atlas->GetHeight(), atlas->GetEfficiency() * 100.0f);
+	}
+	if (assetLoader->GetPendingCount() > 0) {
+		ImGui::Text("assets loading: %d", assetLoader->GetPendingCount());
 	}
 
 	ImGui::End();
@@ -911,27 +1115,22 @@ void Game::RenderShadowMap()
 	// Turn on our shadow map Vertex Shader
 	// and turn OFF the pixel shader entirely
 
-	vertexShaderShadow->SetShader();
 	vertexShaderShadow->SetMatrix4x4("view", shadowViewMatrix);
 	vertexShaderShadow->SetMatrix4x4("projection", shadowProjectionMatrix);
+	vertexShaderShadowPacked->SetMatrix4x4("view", shadowViewMatrix);
+	vertexShaderShadowPacked->SetMatrix4x4("projection", shadowProjectionMatrix);
 	context->PSSetShader(0, 0, 0); // No PS
 
 	// Loop and draw all entities
 	for (auto& e : entityList)
 	{
-		vertexShaderShadow->SetMatrix4x4("world", e->GetTransform()->GetWorldMatrix());
-		vertexShaderShadow->CopyAllBufferData();
-		// Draw the mesh
-		e->GetMesh()->Draw(context);
+		RenderShadowCaster(e);
 	}
 	
 	for (Exhibit* exhibit : exhibits) {
 		const std::vector<GameEntity*>* surfaces = exhibit->GetEntities();
 		for (GameEntity* surface : *surfaces) {
-			vertexShaderShadow->SetMatrix4x4("world", surface->GetTransform()->GetWorldMatrix());
-			vertexShaderShadow->CopyAllBufferData();
-			// Draw the mesh
-			surface->GetMesh()->Draw(context);
+			RenderShadowCaster(surface);
 		}
 	}
 
@@ -943,13 +1142,32 @@ void Game::RenderShadowMap()
 	context->RSSetState(0);
 }
 
+// Draws one entity into the shadow map, with the shadow
+// shader that matches its mesh's vertex format
+void Game::RenderShadowCaster(GameEntity* entity)
+{
+	Mesh* mesh = entity->GetMesh();
+	SimpleVertexShader* vs = mesh->HasPackedVertices() ? vertexShaderShadowPacked : vertexShaderShadow;
+	vs->SetShader();
+	vs->SetMatrix4x4("world", entity->GetTransform()->GetWorldMatrix());
+	if (mesh->HasPackedVertices())
+	{
+		vs->SetFloat3("positionCenter", mesh->GetBoundingBox().Center);
+		vs->SetFloat3("positionExtents", mesh->GetBoundingBox().Extents);
+	}
+	vs->CopyAllBufferData();
+
+	// Draw the mesh - positions are all the shadow shaders need
+	mesh->DrawPositionOnly(context);
+}
+
 void Game::DrawParticles() {
 	// Particle states
 	context->OMSetBlendState(particleBlendState.Get(), 0, 0xffffffff);	// Additive blending
 	context->OMSetDepthStencilState(particleDepthState.Get(), 0);		// No depth WRITING
 	
 	particleManager->CopyParticlesToGPU(context, camera);
-	particleManager->DrawParticlesInternal(context, camera, pixelShaderParticle,vertexShaderParticle);
+	particleManager->DrawParticlesInternal(context, camera, pixelShaderParticle, vertexShaderParticle, vertexShaderParticleCPU);
 
 	// Reset states
 	context->OMSetBlendState(0, 0, 0xffffffff);
@@ -1075,15 +1293,23 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Game::CreateCubemap(
 {
 	// Load the 6 textures into an array.
 	// - We need references to the TEXTURES, not the SHADER RESOURCE VIEWS!
-	// - Specifically NOT generating mipmaps, as we usually don't need them for the sky!
+	// - They come from the compressed texture cache, mips and all, but
+	//   we only copy the top level, as we usually don't need mips for the sky!
 	// - Order matters here!  +X, -X, +Y, -Y, +Z, -Z
+	const wchar_t* faces[6] = { right, left, up, down, front, back };
 	ID3D11Texture2D* textures[6] = {};
-	CreateWICTextureFromFile(device.Get(), right, (ID3D11Resource**)&textures[0], 0);
-	CreateWICTextureFromFile(device.Get(), left, (ID3D11Resource**)&textures[1], 0);
-	CreateWICTextureFromFile(device.Get(), up, (ID3D11Resource**)&textures[2], 0);
-	CreateWICTextureFromFile(device.Get(), down, (ID3D11Resource**)&textures[3], 0);
-	CreateWICTextureFromFile(device.Get(), front, (ID3D11Resource**)&textures[4], 0);
-	CreateWICTextureFromFile(device.Get(), back, (ID3D11Resource**)&textures[5], 0);
+	for (int i = 0; i < 6; i++)
+	{
+		// A face that won't load leaves no cube map - the sky just draws black
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> faceSRV = assetLoader->LoadTextureNow(faces[i], ColorTexture);
+		if (!faceSRV)
+		{
+			for (int j = 0; j < i; j++)
+				textures[j]->Release();
+			return nullptr;
+		}
+		faceSRV->GetResource((ID3D11Resource**)&textures[i]);
+	}
 
 	// We'll assume all of the textures are the same color format and resolution,
 	// so get the description of the first shader resource view
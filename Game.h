@@ -12,6 +12,9 @@
 #include "Lights.h"
 #include "Sky.h"
 #include "Exhibit.h"
+#include "AssetLoader.h"
+#include "ResidencyManager.h"
+#include <unordered_map>
 #include <stdlib.h>
 #include <optional>
 #include "SpriteBatch.h"
@@ -51,14 +54,25 @@ private:
 
 	// Initialization helper methods - feel free to customize, combine, etc.
 	void LoadShaders(); 
+	SimpleVertexShader* LoadPackedVertexShader(const wchar_t* shaderFile, bool positionOnly);
 	void CreateBasicGeometry();
 	void CreateParticleStates();
 	void DrawParticles();
 	void ResizePostProcessResources();
 	void CreateShadowMapResources();
 	void RenderShadowMap();
-	Material* CreateMaterial(const wchar_t* albedoPath, const wchar_t* normalsPath, const wchar_t* roughnessPath, const wchar_t* metalPath); // use nullptr for defaults
+	void RenderShadowCaster(GameEntity* entity);
+	Material* CreateMaterial(const wchar_t* albedoPath, const wchar_t* normalsPath, const wchar_t* roughnessPath, const wchar_t* metalPath,
+		const wchar_t* ambientOcclusionPath = nullptr); // use nullptr for defaults
 	Material* CreateColorMaterial(XMFLOAT3 color);
+	void StreamTexture(Material* material, const std::string& textureName, const wchar_t* path, TextureKind kind, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> placeholder);
+	void StreamSurfaceTexture(Material* material, const wchar_t* roughnessPath, const wchar_t* metalPath);
+	void StreamTexture(Material* material, const std::string& textureName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> placeholder,
+		std::function<void(std::function<void(unsigned long long)>)> load);
+	TextureAtlas* CreateAtlas(const std::vector<const wchar_t*>& paths);
+	Material* CreateAtlasMaterial(TextureAtlas* atlas);
+	void UseAtlasImage(GameEntity* entity, TextureAtlas* atlas, const wchar_t* path);
+	void CreateExhibitResidency();
 
 	bool firstPerson;
 
@@ -77,18 +91,26 @@ private:
 	SimplePixelShader* pixelShader;
 	SimpleVertexShader* vertexShader;
 	SimpleVertexShader* vertexShaderShadow;
+	SimpleVertexShader* vertexShaderPacked; // Versions of the two above for
+	SimpleVertexShader* vertexShaderShadowPacked; // meshes with PackedVertex data
 	SimplePixelShader* pixelShaderSky;
 	SimpleVertexShader* vertexShaderSky;
 	SimplePixelShader* pixelShaderSobel;
 	SimpleVertexShader* vertexShaderFull;
 	SimplePixelShader* pixelShaderBloomE;
 	SimpleVertexShader* vertexShaderParticle;
+	SimpleVertexShader* vertexShaderParticleCPU;
 	SimplePixelShader* pixelShaderParticle;
 	SimplePixelShader* pixelShaderNoPostProcess;
 
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> defaultBlackSRV; // default for metal and roughness
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> defaultBlackSRV; // default for the surface map (smooth, not metal, not occluded)
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> defaultNormalSRV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> pureWhiteSRV;
+	AssetLoader* assetLoader; // textures and models still loading swap in as they arrive
+	ResidencyManager* residency; // keeps the textures near the camera's exhibit loaded
+	std::unordered_map<Material*, std::vector<int>> materialTextures; // residency assets of each material
+	std::vector<TextureAtlas*> atlasList; // images sharing one texture (signs, paintings...)
+	int textureBudgetMB;
 
 	int exhibitIndex;
 
@@ -129,8 +151,8 @@ private:
 	GameEntity* moon;
 
 	//my models
-	Mesh* cube;
-	Mesh* sphere;
+	std::shared_ptr<Mesh> cube;
+	std::shared_ptr<Mesh> sphere;
 
 	//my game entities
 	std::vector<GameEntity*> entityList = {};
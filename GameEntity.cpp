@@ -1,10 +1,11 @@
 #include "GameEntity.h"
 
-GameEntity::GameEntity(Mesh* mesh, Material* material)
+GameEntity::GameEntity(std::shared_ptr<Mesh> mesh, Material* material)
 {
 	entityMesh = mesh;
 	entityMaterial = material;
-
+	uvScale = XMFLOAT2(1, 1);
+	uvOffset = XMFLOAT2(0, 0);
 }
 
 GameEntity::~GameEntity()
@@ -13,7 +14,7 @@ GameEntity::~GameEntity()
 
 Mesh* GameEntity::GetMesh()
 {
-	return entityMesh;
+	return entityMesh.get();
 }
 
 Material* GameEntity::GetMaterial()
@@ -21,29 +22,67 @@ Material* GameEntity::GetMaterial()
 	return entityMaterial;
 }
 
+SimpleVertexShader* GameEntity::GetVertexShader()
+{
+	if (entityMesh->HasPackedVertices())
+		return entityMaterial->GetPackedVertexShader();
+
+	return entityMaterial->GetVertexShader();
+}
+
 Transform* GameEntity::GetTransform()
 {
 	return &entityTransform;
 }
 
+// How big the mesh looks from the camera - 1 when its bounding
+// sphere reaches the top and bottom of the screen
+float GameEntity::GetScreenSize(Camera* camera)
+{
+	BoundingSphere sphere = entityTransform.GetWorldBounds(entityMesh->GetBoundingSphere());
+	XMFLOAT3 cameraPosition = camera->GetTransform()->GetPosition();
+	float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&sphere.Center) - XMLoadFloat3(&cameraPosition)));
+
+	// Inside the sphere it may as well fill the screen
+	if (distance <= sphere.Radius)
+		return 1.0f;
+
+	return sphere.Radius / (distance * tanf(camera->GetFoV() * 0.5f));
+}
+
+void GameEntity::SetUVTransform(XMFLOAT2 scale, XMFLOAT2 offset)
+{
+	uvScale = scale;
+	uvOffset = offset;
+}
+
 void GameEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,Camera* camera)
 {
-	entityMaterial->GetVertexShader()->SetShader(); 
+	GetVertexShader()->SetShader(); 
 	entityMaterial->GetPixelShader()->SetShader();
 
-	SimpleVertexShader* vs = entityMaterial->GetVertexShader(); //   Simplifies next few lines 
+	SimpleVertexShader* vs = GetVertexShader(); //   Simplifies next few lines 
 	SimplePixelShader* ps = entityMaterial->GetPixelShader(); //   Simplifies next few lines 
 	ps->SetFloat3("colorTint", entityMaterial->GetColorTint());
 	ps->SetFloat("roughness", entityMaterial->GetRoughness());
+	ps->SetFloat2("uvScale", uvScale);
+	ps->SetFloat2("uvOffset", uvOffset);
+	ps->SetFloat2("textureUVScale", entityMaterial->GetTextureUVScale());
+	ps->SetInt("hasOcclusionMap", entityMaterial->HasOcclusionMap());
 	ps->SetFloat3("cameraPosition", camera->GetTransform()->GetPosition());
 	vs->SetMatrix4x4("world", entityTransform.GetWorldMatrix());
 	vs->SetMatrix4x4("view", camera->GetView());
 	vs->SetMatrix4x4("projection", camera->GetProjection());
 	vs->SetMatrix4x4("worldInvTrans", entityTransform.GetWorldInverseTranspose());
+	if (entityMesh->HasPackedVertices())
+	{
+		vs->SetFloat3("positionCenter", entityMesh->GetBoundingBox().Center);
+		vs->SetFloat3("positionExtents", entityMesh->GetBoundingBox().Extents);
+	}
 	vs->CopyAllBufferData();
 	ps->CopyAllBufferData();
 	//bind texture related resources
 	entityMaterial->BindResources();
-	entityMesh->Draw(context);
+	entityMesh->Draw(context, entityMesh->SelectLod(GetScreenSize(camera)));
 }
 
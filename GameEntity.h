@@ -2,6 +2,7 @@
 #include "DXCore.h"
 #include <DirectXMath.h>
 #include <wrl/client.h> 
+#include <memory>
 #include "Transform.h"
 #include "Mesh.h"
 #include "BufferStructs.h"
@@ -10,15 +11,20 @@
 using namespace DirectX;
 class GameEntity {
 public:
-	GameEntity(Mesh* mesh, Material* material);
+	GameEntity(std::shared_ptr<Mesh> mesh, Material* material);
 	~GameEntity();
 	Transform* GetTransform();
 	Mesh* GetMesh();
 	Material* GetMaterial();
+	SimpleVertexShader* GetVertexShader(); // The material's shader that matches the mesh's vertices
+	float GetScreenSize(Camera* camera); // Bounding sphere radius over half the screen height
+	void SetUVTransform(XMFLOAT2 scale, XMFLOAT2 offset); // Picks its image out of an atlas
 	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Camera* camera);
 
 private:
 	Transform entityTransform;
-	Mesh* entityMesh;
+	std::shared_ptr<Mesh> entityMesh; // Shared with every other entity using the same model
 	Material* entityMaterial;
+	XMFLOAT2 uvScale;
+	XMFLOAT2 uvOffset;
 };
\ No newline at end of file
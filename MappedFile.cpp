@@ -0,0 +1,50 @@
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const char* path)
+{
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = 0;
+	data = 0;
+	size = 0;
+
+	fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+		return; // empty files can't be mapped, so treat them as not open
+
+	mappingHandle = CreateFileMappingA(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+	if (mappingHandle == 0)
+		return;
+
+	data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (data != 0)
+		size = (size_t)fileSize.QuadPart;
+}
+
+MappedFile::~MappedFile()
+{
+	if (data != 0)
+		UnmapViewOfFile(data);
+	if (mappingHandle != 0)
+		CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+}
+
+bool MappedFile::IsOpen()
+{
+	return data != 0;
+}
+
+const char* MappedFile::GetData()
+{
+	return data;
+}
+
+size_t MappedFile::GetSize()
+{
+	return size;
+}
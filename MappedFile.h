@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Windows.h>
+
+// --------------------------------------------------------
+// A read-only view of an entire file on disk
+//
+// The file is memory mapped rather than copied, so parsers
+// can walk the bytes in place. The view is released when
+// this object is destroyed.
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile(const char* path);
+	~MappedFile();
+
+	// No copies - the handles belong to one object
+	MappedFile(MappedFile const&) = delete;
+	void operator=(MappedFile const&) = delete;
+
+	bool IsOpen();
+	const char* GetData();
+	size_t GetSize();
+
+private:
+	HANDLE fileHandle;
+	HANDLE mappingHandle;
+	const char* data;
+	size_t size;
+};
@@ -6,7 +6,10 @@ Material::Material(DirectX::XMFLOAT3 ct, float r, SimplePixelShader* ps, SimpleV
 	roughness = r;
 	pixelShader = ps;
 	vertexShader = vs;
+	packedVertexShader = nullptr;
 	transparency = 0.0f;
+	textureUVScale = DirectX::XMFLOAT2(1.0f, 1.0f);
+	hasOcclusionMap = false;
 }
 
 Material::~Material()
@@ -33,6 +36,11 @@ SimpleVertexShader* Material::GetVertexShader()
 	return vertexShader;
 }
 
+SimpleVertexShader* Material::GetPackedVertexShader()
+{
+	return packedVertexShader;
+}
+
 void Material::SetMaterialColorTint(DirectX::XMFLOAT3 input)
 {
 	colorTint = input;
@@ -43,6 +51,11 @@ void Material::SetPixelShader(SimplePixelShader* ps)
 	pixelShader = ps;
 }
 
+void Material::SetPackedVertexShader(SimpleVertexShader* vs)
+{
+	packedVertexShader = vs;
+}
+
 void Material::SetTransparency(float transparency)
 {
 	this->transparency = transparency;
@@ -53,11 +66,36 @@ float Material::GetTransparency()
 	return transparency;
 }
 
+void Material::SetTextureUVScale(DirectX::XMFLOAT2 scale)
+{
+	textureUVScale = scale;
+}
+
+DirectX::XMFLOAT2 Material::GetTextureUVScale()
+{
+	return textureUVScale;
+}
+
+void Material::SetHasOcclusionMap(bool hasOcclusionMap)
+{
+	this->hasOcclusionMap = hasOcclusionMap;
+}
+
+bool Material::HasOcclusionMap()
+{
+	return hasOcclusionMap;
+}
+
 void Material::AddTextureSRV(std::string s, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	textureSRVs.insert({s,srv});
 }
 
+void Material::SetTextureSRV(std::string s, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	textureSRVs[s] = srv;
+}
+
 void Material::AddSamplerState(std::string s, Microsoft::WRL::ComPtr<ID3D11SamplerState> ss)
 {
 	samplerStates.insert({ s,ss });
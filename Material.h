@@ -16,22 +16,35 @@ public:
 	float GetRoughness();
 	SimplePixelShader* GetPixelShader();
 	SimpleVertexShader* GetVertexShader();
+	SimpleVertexShader* GetPackedVertexShader(); // For meshes with packed vertices
 	// Setters not necessary for shaders because they are loaded once
 	void SetMaterialColorTint(DirectX::XMFLOAT3 input);
 	void SetPixelShader(SimplePixelShader* ps);
+	void SetPackedVertexShader(SimpleVertexShader* vs);
 	void SetTransparency(float transparency);
 	float GetTransparency();
+	// The share of its textures the images fill (under 1 when they
+	// were padded out to whole compressed blocks)
+	void SetTextureUVScale(DirectX::XMFLOAT2 scale);
+	DirectX::XMFLOAT2 GetTextureUVScale();
+	// Only materials with an AO map sample (and bind) one
+	void SetHasOcclusionMap(bool hasOcclusionMap);
+	bool HasOcclusionMap();
 
 	//texture functions
 	void AddTextureSRV(std::string s, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	void SetTextureSRV(std::string s, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv); // replaces one already added
 	void AddSamplerState(std::string s, Microsoft::WRL::ComPtr<ID3D11SamplerState> ss);
 	void BindResources();
 private:
 	DirectX::XMFLOAT3 colorTint;
 	float roughness;
 	float transparency;
+	DirectX::XMFLOAT2 textureUVScale;
+	bool hasOcclusionMap;
 	SimplePixelShader* pixelShader;
 	SimpleVertexShader* vertexShader;
+	SimpleVertexShader* packedVertexShader;
 	
 	//textuer related data
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs;
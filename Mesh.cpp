@@ -1,6 +1,187 @@
 #include "Mesh.h"
+#include "MeshFile.h"
+#include "ThreadPool.h"
+#include "MeshOptimizer.h"
+#include "VertexPacking.h"
 using namespace DirectX;
 
+// Triangles (or vertices) per job when tangents are split across the pool
+static const int TANGENT_CHUNK_SIZE = 1 << 14;
+
+// UV triangles with less area than this can't define a tangent direction
+static const float DEGENERATE_UV_AREA = 1e-12f;
+
+// Screen size (see SelectLod) below which each level of detail takes over
+static const float LOD_SCREEN_SIZE[MESH_MAX_LODS] = { 0.0f, 0.25f, 0.12f, 0.06f };
+
+// --------------------------------------------------------
+// One value (at byte offset within a Vertex) from the same
+// corner of four triangles, one triangle per lane
+// --------------------------------------------------------
+static inline XMVECTOR GatherLanes(const Vertex* const* corners, int corner, size_t offset)
+{
+	const char* a = (const char*)corners[corner] + offset;
+	const char* b = (const char*)corners[3 + corner] + offset;
+	const char* c = (const char*)corners[6 + corner] + offset;
+	const char* d = (const char*)corners[9 + corner] + offset;
+	return XMVectorSet(*(const float*)a, *(const float*)b, *(const float*)c, *(const float*)d);
+}
+
+// --------------------------------------------------------
+// Adds the tangent of every triangle in [first, last) to
+// its three corners in tangents[].  Triangles with (close
+// to) zero UV area, or non-finite data, add nothing.
+// --------------------------------------------------------
+static void AccumulateTangents(const Vertex* verts, const int* indices, int first, int last, XMFLOAT3* tangents)
+{
+	for (int t = first; t < last; t += 4)
+	{
+		const int* tri = &indices[t * 3];
+		int laneCount = last - t < 4 ? last - t : 4;
+
+		// Gather the corners of up to four triangles into lanes.
+		// Unused lanes repeat the last triangle and are never added.
+		const Vertex* corners[12];
+		for (int lane = 0; lane < 4; lane++)
+		{
+			int source = lane < laneCount ? lane : laneCount - 1;
+			corners[lane * 3 + 0] = &verts[tri[source * 3 + 0]];
+			corners[lane * 3 + 1] = &verts[tri[source * 3 + 1]];
+			corners[lane * 3 + 2] = &verts[tri[source * 3 + 2]];
+		}
+
+		// Calculate vectors relative to triangle positions
+		XMVECTOR p1x = GatherLanes(corners, 0, offsetof(Vertex, Position.x));
+		XMVECTOR p1y = GatherLanes(corners, 0, offsetof(Vertex, Position.y));
+		XMVECTOR p1z = GatherLanes(corners, 0, offsetof(Vertex, Position.z));
+		XMVECTOR x1 = GatherLanes(corners, 1, offsetof(Vertex, Position.x)) - p1x;
+		XMVECTOR y1 = GatherLanes(corners, 1, offsetof(Vertex, Position.y)) - p1y;
+		XMVECTOR z1 = GatherLanes(corners, 1, offsetof(Vertex, Position.z)) - p1z;
+		XMVECTOR x2 = GatherLanes(corners, 2, offsetof(Vertex, Position.x)) - p1x;
+		XMVECTOR y2 = GatherLanes(corners, 2, offsetof(Vertex, Position.y)) - p1y;
+		XMVECTOR z2 = GatherLanes(corners, 2, offsetof(Vertex, Position.z)) - p1z;
+
+		// Do the same for vectors relative to triangle uv's
+		XMVECTOR u1 = GatherLanes(corners, 0, offsetof(Vertex, UV.x));
+		XMVECTOR v1 = GatherLanes(corners, 0, offsetof(Vertex, UV.y));
+		XMVECTOR s1 = GatherLanes(corners, 1, offsetof(Vertex, UV.x)) - u1;
+		XMVECTOR t1 = GatherLanes(corners, 1, offsetof(Vertex, UV.y)) - v1;
+		XMVECTOR s2 = GatherLanes(corners, 2, offsetof(Vertex, UV.x)) - u1;
+		XMVECTOR t2 = GatherLanes(corners, 2, offsetof(Vertex, UV.y)) - v1;
+
+		// Create vectors for tangent calculation, skipping any triangle
+		// whose uvs are collapsed to a line or point (r would be inf)
+		XMVECTOR det = s1 * t2 - s2 * t1;
+		XMVECTOR degenerate = XMVectorLess(XMVectorAbs(det), XMVectorReplicate(DEGENERATE_UV_AREA));
+		XMVECTOR r = XMVectorSelect(XMVectorReciprocal(det), XMVectorZero(), degenerate);
+
+		XMVECTOR tx = (t2 * x1 - t1 * x2) * r;
+		XMVECTOR ty = (t2 * y1 - t1 * y2) * r;
+		XMVECTOR tz = (t2 * z1 - t1 * z2) * r;
+
+		// Bad input (NaN or huge positions) shouldn't poison the neighbors
+		XMVECTOR bad = XMVectorOrInt(
+			XMVectorOrInt(XMVectorIsNaN(tx), XMVectorIsInfinite(tx)),
+			XMVectorOrInt(
+				XMVectorOrInt(XMVectorIsNaN(ty), XMVectorIsInfinite(ty)),
+				XMVectorOrInt(XMVectorIsNaN(tz), XMVectorIsInfinite(tz))));
+
+		XMFLOAT4A txLanes, tyLanes, tzLanes;
+		XMStoreFloat4A(&txLanes, XMVectorSelect(tx, XMVectorZero(), bad));
+		XMStoreFloat4A(&tyLanes, XMVectorSelect(ty, XMVectorZero(), bad));
+		XMStoreFloat4A(&tzLanes, XMVectorSelect(tz, XMVectorZero(), bad));
+
+		// Adjust tangents of each vert of each triangle - this part
+		// has to be scalar since triangles can share vertices
+		for (int lane = 0; lane < laneCount; lane++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				XMFLOAT3& tangent = tangents[tri[lane * 3 + corner]];
+				tangent.x += (&txLanes.x)[lane];
+				tangent.y += (&tyLanes.x)[lane];
+				tangent.z += (&tzLanes.x)[lane];
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Sums the accumulated tangents of vertices [first, last)
+// and makes them orthonormal to the normals.  Vertices that
+// ended up with no usable tangent (every triangle around
+// them was degenerate) get one built from the normal instead.
+// --------------------------------------------------------
+static void FinishTangents(Vertex* verts, int first, int last, const std::vector<std::vector<XMFLOAT3>>& accumulators)
+{
+	for (int i = first; i < last; i += 4)
+	{
+		int laneCount = last - i < 4 ? last - i : 4;
+
+		// Transpose the normals and summed tangents into lanes.
+		// Unused lanes repeat the last vertex and are never stored.
+		int lane0 = i;
+		int lane1 = i + (laneCount > 1 ? 1 : 0);
+		int lane2 = i + (laneCount > 2 ? 2 : 0);
+		int lane3 = i + laneCount - 1;
+		XMVECTOR normalX = XMVectorSet(verts[lane0].Normal.x, verts[lane1].Normal.x, verts[lane2].Normal.x, verts[lane3].Normal.x);
+		XMVECTOR normalY = XMVectorSet(verts[lane0].Normal.y, verts[lane1].Normal.y, verts[lane2].Normal.y, verts[lane3].Normal.y);
+		XMVECTOR normalZ = XMVectorSet(verts[lane0].Normal.z, verts[lane1].Normal.z, verts[lane2].Normal.z, verts[lane3].Normal.z);
+		XMVECTOR tangentX = XMVectorZero();
+		XMVECTOR tangentY = XMVectorZero();
+		XMVECTOR tangentZ = XMVectorZero();
+		for (const std::vector<XMFLOAT3>& tangents : accumulators)
+		{
+			tangentX += XMVectorSet(tangents[lane0].x, tangents[lane1].x, tangents[lane2].x, tangents[lane3].x);
+			tangentY += XMVectorSet(tangents[lane0].y, tangents[lane1].y, tangents[lane2].y, tangents[lane3].y);
+			tangentZ += XMVectorSet(tangents[lane0].z, tangents[lane1].z, tangents[lane2].z, tangents[lane3].z);
+		}
+
+		// Gram-Schmidt: remove the part of the tangent along the normal
+		XMVECTOR dot = normalX * tangentX + normalY * tangentY + normalZ * tangentZ;
+		tangentX = tangentX - normalX * dot;
+		tangentY = tangentY - normalY * dot;
+		tangentZ = tangentZ - normalZ * dot;
+		XMVECTOR length = XMVectorSqrt(tangentX * tangentX + tangentY * tangentY + tangentZ * tangentZ);
+
+		// Fallback: project whichever of X or Y is further from the normal
+		XMVECTOR useX = XMVectorLess(XMVectorAbs(normalX), XMVectorReplicate(0.9f));
+		XMVECTOR axisX = XMVectorSelect(XMVectorZero(), XMVectorSplatOne(), useX);
+		XMVECTOR axisY = XMVectorSelect(XMVectorSplatOne(), XMVectorZero(), useX);
+		XMVECTOR axisDot = normalX * axisX + normalY * axisY;
+		XMVECTOR fallbackX = axisX - normalX * axisDot;
+		XMVECTOR fallbackY = axisY - normalY * axisDot;
+		XMVECTOR fallbackZ = -normalZ * axisDot;
+		XMVECTOR fallbackLength = XMVectorSqrt(fallbackX * fallbackX + fallbackY * fallbackY + fallbackZ * fallbackZ);
+
+		XMVECTOR useFallback = XMVectorOrInt(
+			XMVectorLess(length, XMVectorReplicate(1e-6f)),
+			XMVectorOrInt(XMVectorIsNaN(length), XMVectorIsInfinite(length)));
+		tangentX = XMVectorSelect(tangentX, fallbackX, useFallback);
+		tangentY = XMVectorSelect(tangentY, fallbackY, useFallback);
+		tangentZ = XMVectorSelect(tangentZ, fallbackZ, useFallback);
+		length = XMVectorSelect(length, fallbackLength, useFallback);
+
+		// A broken normal breaks the fallback too, so use plain +X
+		XMVECTOR broken = XMVectorOrInt(
+			XMVectorLess(length, XMVectorReplicate(1e-6f)),
+			XMVectorOrInt(XMVectorIsNaN(length), XMVectorIsInfinite(length)));
+		tangentX = XMVectorSelect(tangentX, XMVectorSplatOne(), broken);
+		tangentY = XMVectorSelect(tangentY, XMVectorZero(), broken);
+		tangentZ = XMVectorSelect(tangentZ, XMVectorZero(), broken);
+		length = XMVectorSelect(length, XMVectorSplatOne(), broken);
+
+		XMFLOAT4A tx, ty, tz;
+		XMStoreFloat4A(&tx, tangentX / length);
+		XMStoreFloat4A(&ty, tangentY / length);
+		XMStoreFloat4A(&tz, tangentZ / length);
+		for (int lane = 0; lane < laneCount; lane++)
+		{
+			verts[i + lane].Tangent = XMFLOAT3((&tx.x)[lane], (&ty.x)[lane], (&tz.x)[lane]);
+		}
+	}
+}
+
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer()
 {
 	return vertexBuffer;
@@ -11,254 +192,159 @@ Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer()
 	return indexBuffer;
 }
 
+// Null unless the mesh was loaded with a position stream
+Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetPositionBuffer()
+{
+	return positionBuffer;
+}
+
 int Mesh::GetIndexCount()
 {
 	return index;
 }
 
+DXGI_FORMAT Mesh::GetIndexFormat()
+{
+	return indexFormat;
+}
+
+const DirectX::BoundingBox& Mesh::GetBoundingBox()
+{
+	return boundingBox;
+}
+
+const DirectX::BoundingSphere& Mesh::GetBoundingSphere()
+{
+	return boundingSphere;
+}
+
+bool Mesh::HasPackedVertices()
+{
+	return packedVertices;
+}
+
+
+size_t Mesh::GetMemorySize()
+{
+	return memorySize;
+}
+
+int Mesh::GetLodCount()
+{
+	return (int)lods.size();
+}
+
+// Picks the level of detail for a mesh whose bounding sphere covers
+// screenSize of half the screen's height (1 fills the screen)
+int Mesh::SelectLod(float screenSize)
+{
+	int lod = 0;
+	while (lod + 1 < (int)lods.size() && screenSize < LOD_SCREEN_SIZE[lod + 1])
+	{
+		lod++;
+	}
+	return lod;
+}
 
 //draw method
-void Mesh::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+void Mesh::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, int lod)
 {
-	UINT stride = sizeof(Vertex);
+	if (lods.empty())
+		return;
+	if (lod < 0 || lod >= (int)lods.size())
+		lod = (int)lods.size() - 1;
+
+	UINT stride = packedVertices ? sizeof(PackedVertex) : sizeof(Vertex);
 	UINT offset = 0;
 	context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-	context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	context->IASetIndexBuffer(indexBuffer.Get(), indexFormat, 0);
 	context->DrawIndexed(
-		index,     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
+		lods[lod].indexCount,     // The number of indices to use (just this level of detail)
+		lods[lod].indexStart,     // Offset to the first index we want to use
 		0);    // Offset to add to each index when looking up vertices
 }
 
+// Draws with only positions bound, for the shadow (depth-only) shaders.
+// Without a position stream the full vertices are used instead - position
+// is the first thing in both Vertex and PackedVertex, so that still works.
+// Always full detail, so shadows don't pop as the levels change.
+void Mesh::DrawPositionOnly(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+{
+	if (lods.empty())
+		return;
+	if (!positionBuffer)
+	{
+		Draw(context);
+		return;
+	}
+
+	UINT stride = packedVertices ? sizeof(PackedPosition) : sizeof(XMFLOAT3);
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, positionBuffer.GetAddressOf(), &stride, &offset);
+	context->IASetIndexBuffer(indexBuffer.Get(), indexFormat, 0);
+	context->DrawIndexed(lods[0].indexCount, lods[0].indexStart, 0);
+}
+
 //constructor
 //it should create two buffers from the vertex and index arrays
 //this is based on CreateBasicGeometry() method
 Mesh::Mesh(Vertex* vertexArray, int vertexNum, int* indexArray, int indexNum, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
 {
 	this->myContext = context;
-	//index = indexNum;
+	index = 0;
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	packedVertices = false;
+	buildPositionStream = true;
+	memorySize = 0;
+	CalculateTangents(vertexArray, vertexNum, indexArray, indexNum);
 	CreateBuffers(vertexArray, vertexNum, indexArray,indexNum, device);
 	
 }
 
 //second constructor that accepts name of file to load
-Mesh::Mesh(const char* file, Microsoft::WRL::ComPtr<ID3D11Device> device)
+//optimize reorders the triangles and vertices for the GPU (see MeshOptimizer)
+//packVertices uploads PackedVertex data, which needs the *Packed vertex shaders
+//positionStream adds a position-only buffer for DrawPositionOnly
+//generateLods adds simpler versions for Draw to use far away (see MeshSimplifier)
+Mesh::Mesh(const char* file, Microsoft::WRL::ComPtr<ID3D11Device> device, bool optimize, bool packVertices, bool positionStream, bool generateLods)
 {
-	// Author: Chris Cascioli
-// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
-// 
-// - You are allowed to directly copy/paste this into your code base
-//   for assignments, given that you clearly cite that this is not
-//   code of your own design.
-//
-// - NOTE: You'll need to #include <fstream>
-
-
-// File input object
-std::ifstream obj(file);
-
-// Check for successful open
-if (!obj.is_open())
-	return;
-
-// Variables used while reading the file
-std::vector<XMFLOAT3> positions;	// Positions from the file
-std::vector<XMFLOAT3> normals;		// Normals from the file
-std::vector<XMFLOAT2> uvs;		// UVs from the file
-std::vector<Vertex> verts;		// Verts we're assembling
-std::vector<int> indices;		// Indices of these verts
-int vertCounter = 0;			// Count of vertices
-int indexCounter = 0;			// Count of indices
-char chars[100];			// String for line reading
-
-// Still have data left?
-while (obj.good())
-{
-	// Get the line (100 characters should be more than enough)
-	obj.getline(chars, 100);
-
-	// Check the type of line
-	if (chars[0] == 'v' && chars[1] == 'n')
-	{
-		// Read the 3 numbers directly into an XMFLOAT3
-		XMFLOAT3 norm;
-		sscanf_s(
-			chars,
-			"vn %f %f %f",
-			&norm.x, &norm.y, &norm.z);
-
-		// Add to the list of normals
-		normals.push_back(norm);
-	}
-	else if (chars[0] == 'v' && chars[1] == 't')
+	index = 0;
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	packedVertices = packVertices;
+	buildPositionStream = positionStream;
+	memorySize = 0;
+	unsigned int cacheFlags = (optimize ? MESH_FILE_OPTIMIZED : 0) | (generateLods ? MESH_FILE_LODS : 0);
+
+	// Use the binary cache next to the file when it's still valid -
+	// the mapped vertices and indices go straight to the GPU
 	{
-		// Read the 2 numbers directly into an XMFLOAT2
-		XMFLOAT2 uv;
-		sscanf_s(
-			chars,
-			"vt %f %f",
-			&uv.x, &uv.y);
-
-		// Add to the list of uv's
-		uvs.push_back(uv);
-	}
-	else if (chars[0] == 'v')
-	{
-		// Read the 3 numbers directly into an XMFLOAT3
-		XMFLOAT3 pos;
-		sscanf_s(
-			chars,
-			"v %f %f %f",
-			&pos.x, &pos.y, &pos.z);
-
-		// Add to the positions
-		positions.push_back(pos);
-	}
-	else if (chars[0] == 'f')
-	{
-		// Read the face indices into an array
-		// NOTE: This assumes the given obj file contains
-		//  vertex positions, uv coordinates AND normals.
-		unsigned int i[12];
-		int numbersRead = sscanf_s(
-			chars,
-			"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-			&i[0], &i[1], &i[2],
-			&i[3], &i[4], &i[5],
-			&i[6], &i[7], &i[8],
-			&i[9], &i[10], &i[11]);
-
-		// If we only got the first number, chances are the OBJ
-		// file has no UV coordinates.  This isn't great, but we
-		// still want to load the model without crashing, so we
-		// need to re-read a different pattern (in which we assume
-		// there are no UVs denoted for any of the vertices)
-		if (numbersRead == 1)
+		MappedFile cache(MeshFile::GetCachePath(file, cacheFlags).c_str());
+		const MeshFileHeader* header = MeshFile::Validate(cache, file, cacheFlags);
+		if (header)
 		{
-			// Re-read with a different pattern
-			numbersRead = sscanf_s(
-				chars,
-				"f %d//%d %d//%d %d//%d %d//%d",
-				&i[0], &i[2],
-				&i[3], &i[5],
-				&i[6], &i[8],
-				&i[9], &i[11]);
-
-			// The following indices are where the UVs should 
-			// have been, so give them a valid value
-			i[1] = 1;
-			i[4] = 1;
-			i[7] = 1;
-			i[10] = 1;
-
-			// If we have no UVs, create a single UV coordinate
-			// that will be used for all vertices
-			if (uvs.size() == 0)
-				uvs.push_back(XMFLOAT2(0, 0));
-		}
-
-		// - Create the verts by looking up
-		//    corresponding data from vectors
-		// - OBJ File indices are 1-based, so
-		//    they need to be adusted
-		Vertex v1;
-		v1.Position = positions[i[0] - 1];
-		v1.UV = uvs[i[1] - 1];
-		v1.Normal = normals[i[2] - 1];
-
-		Vertex v2;
-		v2.Position = positions[i[3] - 1];
-		v2.UV = uvs[i[4] - 1];
-		v2.Normal = normals[i[5] - 1];
-
-		Vertex v3;
-		v3.Position = positions[i[6] - 1];
-		v3.UV = uvs[i[7] - 1];
-		v3.Normal = normals[i[8] - 1];
-
-		// The model is most likely in a right-handed space,
-		// especially if it came from Maya.  We want to convert
-		// to a left-handed space for DirectX.  This means we 
-		// need to:
-		//  - Invert the Z position
-		//  - Invert the normal's Z
-		//  - Flip the winding order
-		// We also need to flip the UV coordinate since DirectX
-		// defines (0,0) as the top left of the texture, and many
-		// 3D modeling packages use the bottom left as (0,0)
-
-		// Flip the UV's since they're probably "upside down"
-		v1.UV.y = 1.0f - v1.UV.y;
-		v2.UV.y = 1.0f - v2.UV.y;
-		v3.UV.y = 1.0f - v3.UV.y;
-
-		// Flip Z (LH vs. RH)
-		v1.Position.z *= -1.0f;
-		v2.Position.z *= -1.0f;
-		v3.Position.z *= -1.0f;
-
-		// Flip normal's Z
-		v1.Normal.z *= -1.0f;
-		v2.Normal.z *= -1.0f;
-		v3.Normal.z *= -1.0f;
-
-		// Add the verts to the vector (flipping the winding order)
-		verts.push_back(v1);
-		verts.push_back(v3);
-		verts.push_back(v2);
-		vertCounter += 3;
-
-		// Add three more indices
-		indices.push_back(indexCounter); indexCounter += 1;
-		indices.push_back(indexCounter); indexCounter += 1;
-		indices.push_back(indexCounter); indexCounter += 1;
-
-		// Was there a 4th face?
-		// - 12 numbers read means 4 faces WITH uv's
-		// - 8 numbers read means 4 faces WITHOUT uv's
-		if (numbersRead == 12 || numbersRead == 8)
-		{
-			// Make the last vertex
-			Vertex v4;
-			v4.Position = positions[i[9] - 1];
-			v4.UV = uvs[i[10] - 1];
-			v4.Normal = normals[i[11] - 1];
-
-			// Flip the UV, Z pos and normal's Z
-			v4.UV.y = 1.0f - v4.UV.y;
-			v4.Position.z *= -1.0f;
-			v4.Normal.z *= -1.0f;
-
-			// Add a whole triangle (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v4);
-			verts.push_back(v3);
-			vertCounter += 3;
-
-			// Add three more indices
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
+			CreateBuffers(MeshFile::GetVertices(header), header->vertexCount, MeshFile::GetIndices(header), header->indexCount, device,
+				header->lodIndexCounts, header->lodCount);
+			return;
 		}
 	}
-}
 
-// Close the file and create the actual buffers
-obj.close();
+	// Otherwise parse the whole file - see ObjLoader for the details
+	MeshData meshData;
+	if (!ObjLoader::Load(file, meshData) || meshData.indices.empty())
+		return;
 
-// - At this point, "verts" is a vector of Vertex structs, and can be used
-//    directly to create a vertex buffer:  &verts[0] is the address of the first vert
-//
-// - The vector "indices" is similar. It's a vector of unsigned ints and
-//    can be used directly for the index buffer: &indices[0] is the address of the first int
-//
-// - "vertCounter" is the number of vertices
-// - "indexCounter" is the number of indices
-// - Yes, these are effectively the same since OBJs do not index entire vertices!  This means
-//    an index buffer isn't doing much for us.  We could try to optimize the mesh ourselves
-//    and detect duplicate vertices, but at that point it would be better to use a more
-//    sophisticated model loading library like TinyOBJLoader or AssImp (yes, that's its name)
-CreateBuffers(&verts[0], vertCounter, &indices[0], indexCounter, device);
+	if (optimize)
+		MeshOptimizer::Optimize(meshData);
+
+	CalculateTangents(&meshData.vertices[0], (int)meshData.vertices.size(), &meshData.indices[0], (int)meshData.indices.size());
+
+	// The simpler levels reuse the vertices (and their tangents)
+	if (generateLods)
+		MeshSimplifier::GenerateLods(meshData, MESH_MAX_LODS, optimize);
+
+	MeshFile::Write(file, meshData, cacheFlags);
+	CreateBuffers(&meshData.vertices[0], (int)meshData.vertices.size(), &meshData.indices[0], (int)meshData.indices.size(), device,
+		meshData.lodIndexCounts.empty() ? nullptr : &meshData.lodIndexCounts[0], (int)meshData.lodIndexCounts.size());
 }
 
 Mesh::~Mesh()
@@ -266,12 +352,24 @@ Mesh::~Mesh()
 	//can't think of anything to put here because all objects are smart pointers
 }
 
-void Mesh::CreateBuffers(Vertex* vertexArray, int vertexNum, int* indexArray, int indexNum, Microsoft::WRL::ComPtr<ID3D11Device> device)
+// Uploads the vertex and index data.  Tangents must already be calculated.
+// lodIndexCounts splits the indices into levels of detail - without it
+// they're all one level.
+void Mesh::CreateBuffers(const Vertex* vertexArray, int vertexNum, const int* indexArray, int indexNum, Microsoft::WRL::ComPtr<ID3D11Device> device, const int* lodIndexCounts, int lodCount)
 {
-	CalculateTangents(vertexArray, vertexNum, indexArray, indexNum);
+	CalculateBounds(vertexArray, vertexNum, boundingBox, boundingSphere);
+
+	// Packed positions are relative to the bounds, so these come second
+	std::vector<PackedVertex> packed;
+	if (packedVertices)
+	{
+		packed.resize(vertexNum);
+		VertexPacker::Pack(vertexArray, vertexNum, boundingBox.Center, boundingBox.Extents, &packed[0]);
+	}
+
 	D3D11_BUFFER_DESC vbd;
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * vertexNum;       // size of vertex array times number of vertices in the buffer
+	vbd.ByteWidth = (packedVertices ? sizeof(PackedVertex) : sizeof(Vertex)) * vertexNum;       // size of vertex array times number of vertices in the buffer
 	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Tells DirectX this is a vertex buffer
 	vbd.CPUAccessFlags = 0;
 	vbd.MiscFlags = 0;
@@ -280,20 +378,46 @@ void Mesh::CreateBuffers(Vertex* vertexArray, int vertexNum, int* indexArray, in
 	// Create the proper struct to hold the initial vertex data
 	// - This is how we put the initial data into the buffer
 	D3D11_SUBRESOURCE_DATA initialVertexData;
-	initialVertexData.pSysMem = vertexArray;
+	initialVertexData.pSysMem = packedVertices ? (const void*)&packed[0] : (const void*)vertexArray;
 
 	// Actually create the buffer with the initial data
 	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
 	device->CreateBuffer(&vbd, &initialVertexData, vertexBuffer.GetAddressOf());
+	memorySize = vbd.ByteWidth;
+
+	// The same positions again, tightly packed
+	if (buildPositionStream)
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<PackedPosition> packedPositions;
+		if (packedVertices)
+		{
+			VertexPacker::ExtractPositions(&packed[0], vertexNum, packedPositions);
+			vbd.ByteWidth = sizeof(PackedPosition) * vertexNum;
+			initialVertexData.pSysMem = &packedPositions[0];
+		}
+		else
+		{
+			VertexPacker::ExtractPositions(vertexArray, vertexNum, positions);
+			vbd.ByteWidth = sizeof(XMFLOAT3) * vertexNum;
+			initialVertexData.pSysMem = &positions[0];
+		}
+		device->CreateBuffer(&vbd, &initialVertexData, positionBuffer.GetAddressOf());
+		memorySize += vbd.ByteWidth;
+	}
 
 
 
+	// Small meshes get 16-bit indices, which halves the index buffer
+	std::vector<unsigned short> packed16;
+	indexFormat = PackIndices(indexArray, indexNum, vertexNum, packed16);
+
 	// Create the INDEX BUFFER description ------------------------------------
 	// - The description is created on the stack because we only need
 	//    it to create the buffer.  The description is then useless.
 	D3D11_BUFFER_DESC ibd;
 	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(int) * indexNum;
+	ibd.ByteWidth = (indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(int)) * indexNum;
 	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;	// Tells DirectX this is an index buffer
 	ibd.CPUAccessFlags = 0;
 	ibd.MiscFlags = 0;
@@ -302,12 +426,123 @@ void Mesh::CreateBuffers(Vertex* vertexArray, int vertexNum, int* indexArray, in
 	// Create the proper struct to hold the initial index data
 	// - This is how we put the initial data into the buffer
 	D3D11_SUBRESOURCE_DATA initialIndexData;
-	initialIndexData.pSysMem = indexArray;
+	initialIndexData.pSysMem = indexFormat == DXGI_FORMAT_R16_UINT ? (const void*)&packed16[0] : (const void*)indexArray;
 
 	// Actually create the buffer with the initial data
 	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
 	device->CreateBuffer(&ibd, &initialIndexData, indexBuffer.GetAddressOf());
-	index = indexNum;
+	memorySize += ibd.ByteWidth;
+
+	lods.clear();
+	int indexStart = 0;
+	for (int i = 0; i < lodCount; i++)
+	{
+		lods.push_back({ indexStart, lodIndexCounts[i] });
+		indexStart += lodIndexCounts[i];
+	}
+	if (lods.empty())
+		lods.push_back({ 0, indexNum });
+	index = lods[0].indexCount;
+}
+
+// --------------------------------------------------------
+// Finds the axis-aligned box around every vertex and a
+// sphere centered on that box.  The sphere's radius is the
+// distance to the furthest vertex, which is usually much
+// tighter than the box's corner.
+// --------------------------------------------------------
+void Mesh::CalculateBounds(const Vertex* vertexArray, int vertexNum, DirectX::BoundingBox& box, DirectX::BoundingSphere& sphere)
+{
+	if (vertexNum <= 0)
+	{
+		box = BoundingBox(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0));
+		sphere = BoundingSphere(XMFLOAT3(0, 0, 0), 0);
+		return;
+	}
+
+	// Two sets of min/max so neighboring vertices don't wait on each other
+	XMVECTOR min0 = XMLoadFloat3(&vertexArray[0].Position);
+	XMVECTOR max0 = min0;
+	XMVECTOR min1 = min0;
+	XMVECTOR max1 = min0;
+	int i = 1;
+	for (; i + 1 < vertexNum; i += 2)
+	{
+		XMVECTOR a = XMLoadFloat3(&vertexArray[i].Position);
+		XMVECTOR b = XMLoadFloat3(&vertexArray[i + 1].Position);
+		min0 = XMVectorMin(min0, a);
+		max0 = XMVectorMax(max0, a);
+		min1 = XMVectorMin(min1, b);
+		max1 = XMVectorMax(max1, b);
+	}
+	if (i < vertexNum)
+	{
+		XMVECTOR a = XMLoadFloat3(&vertexArray[i].Position);
+		min0 = XMVectorMin(min0, a);
+		max0 = XMVectorMax(max0, a);
+	}
+	XMVECTOR boundsMin = XMVectorMin(min0, min1);
+	XMVECTOR boundsMax = XMVectorMax(max0, max1);
+	BoundingBox::CreateFromPoints(box, boundsMin, boundsMax);
+
+	// Furthest vertex from the center of the box
+	XMVECTOR center = XMLoadFloat3(&box.Center);
+	XMVECTOR radiusSq = XMVectorZero();
+	for (int v = 0; v < vertexNum; v++)
+	{
+		XMVECTOR offset = XMLoadFloat3(&vertexArray[v].Position) - center;
+		radiusSq = XMVectorMax(radiusSq, XMVector3LengthSq(offset));
+	}
+	sphere.Center = box.Center;
+	sphere.Radius = XMVectorGetX(XMVectorSqrt(radiusSq));
+}
+
+// --------------------------------------------------------
+// Input layout for PackedVertex, checked against the given
+// compiled vertex shader (one of the *Packed shaders).
+// positionOnly matches the stream used by DrawPositionOnly.
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11InputLayout> Mesh::CreatePackedInputLayout(Microsoft::WRL::ComPtr<ID3D11Device> device, const void* shaderCode, size_t shaderSize, bool positionOnly)
+{
+	D3D11_INPUT_ELEMENT_DESC layout[4] = {};
+	layout[0].SemanticName = "POSITION";
+	layout[0].Format = DXGI_FORMAT_R16G16B16A16_SNORM;
+	layout[1].SemanticName = "NORMAL";
+	layout[1].Format = DXGI_FORMAT_R16G16_SNORM;
+	layout[2].SemanticName = "TEXCOORD";
+	layout[2].Format = DXGI_FORMAT_R16G16_FLOAT;
+	layout[3].SemanticName = "TANGENT";
+	layout[3].Format = DXGI_FORMAT_R16G16_SNORM;
+	for (D3D11_INPUT_ELEMENT_DESC& element : layout)
+	{
+		element.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+		element.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+	device->CreateInputLayout(layout, positionOnly ? 1 : 4, shaderCode, shaderSize, inputLayout.GetAddressOf());
+	return inputLayout;
+}
+
+// --------------------------------------------------------
+// Picks the smallest index format that can address every
+// vertex.  When 16 bits are enough, the indices are copied
+// into packed16 and DXGI_FORMAT_R16_UINT is returned;
+// otherwise packed16 is left empty and the original 32-bit
+// array should be uploaded as-is.
+// --------------------------------------------------------
+DXGI_FORMAT Mesh::PackIndices(const int* indexArray, int indexNum, int vertexNum, std::vector<unsigned short>& packed16)
+{
+	packed16.clear();
+	if (vertexNum > 65536 || indexNum == 0)
+		return DXGI_FORMAT_R32_UINT;
+
+	packed16.resize(indexNum);
+	for (int i = 0; i < indexNum; i++)
+	{
+		packed16[i] = (unsigned short)indexArray[i];
+	}
+	return DXGI_FORMAT_R16_UINT;
 }
 
 // --------------------------------------------------------
@@ -326,76 +561,113 @@ void Mesh::CreateBuffers(Vertex* vertexArray, int vertexNum, int* indexArray, in
 //         contain an XMFLOAT3 called Tangent
 //
 // - Be sure to call this BEFORE creating your D3D vertex/index buffers
+//
+// - Triangles and vertices are processed four at a time in
+//   SoA form (each XMVECTOR holds one component of four
+//   different triangles) and big meshes are split across the
+//   ThreadPool.  See AccumulateTangents and FinishTangents.
 // --------------------------------------------------------
 void Mesh::CalculateTangents(Vertex* verts, int numVerts, int* indices, int numIndices)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
+	ThreadPool& pool = ThreadPool::GetInstance();
+	int numTriangles = numIndices / 3;
+
+	// Big meshes split their triangles across the pool.  Each job
+	// adds into its own copy of the tangents (triangles in different
+	// jobs can share a vertex), and the copies are summed afterwards.
+	int jobCount = numTriangles / TANGENT_CHUNK_SIZE;
+	if (jobCount > pool.GetThreadCount())
+		jobCount = pool.GetThreadCount();
+	if (jobCount < 1)
+		jobCount = 1;
+
+	std::vector<std::vector<XMFLOAT3>> accumulators(jobCount);
+	pool.ParallelFor(jobCount, [&](int job)
 	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
-	}
-
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
+		accumulators[job].assign(numVerts, XMFLOAT3(0, 0, 0));
+		int first = (int)((long long)numTriangles * job / jobCount);
+		int last = (int)((long long)numTriangles * (job + 1) / jobCount);
+		AccumulateTangents(verts, indices, first, last, &accumulators[job][0]);
+	});
+
+	// Sum them up and make them orthonormal, again in parallel
+	int vertexJobs = (numVerts + TANGENT_CHUNK_SIZE - 1) / TANGENT_CHUNK_SIZE;
+	pool.ParallelFor(vertexJobs, [&](int job)
 	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
+		int first = job * TANGENT_CHUNK_SIZE;
+		int last = first + TANGENT_CHUNK_SIZE < numVerts ? first + TANGENT_CHUNK_SIZE : numVerts;
+		FinishTangents(verts, first, last, accumulators);
+	});
+}
 
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
+// --------------------------------------------------------
+// Plain C++ version of CalculateTangents, one triangle and
+// one vertex at a time, for checking (and timing) the fast
+// one.  Skips the same degenerate triangles and uses the
+// same fallback, so the two agree to within rounding.
+// --------------------------------------------------------
+void Mesh::CalculateTangentsReference(Vertex* verts, int numVerts, int* indices, int numIndices)
+{
+	std::vector<XMFLOAT3> tangents(numVerts, XMFLOAT3(0, 0, 0));
+	for (int i = 0; i + 2 < numIndices; i += 3)
+	{
+		const Vertex& v1 = verts[indices[i]];
+		const Vertex& v2 = verts[indices[i + 1]];
+		const Vertex& v3 = verts[indices[i + 2]];
+
+		float x1 = v2.Position.x - v1.Position.x;
+		float y1 = v2.Position.y - v1.Position.y;
+		float z1 = v2.Position.z - v1.Position.z;
+		float x2 = v3.Position.x - v1.Position.x;
+		float y2 = v3.Position.y - v1.Position.y;
+		float z2 = v3.Position.z - v1.Position.z;
+
+		float s1 = v2.UV.x - v1.UV.x;
+		float t1 = v2.UV.y - v1.UV.y;
+		float s2 = v3.UV.x - v1.UV.x;
+		float t2 = v3.UV.y - v1.UV.y;
+
+		float det = s1 * t2 - s2 * t1;
+		if (fabsf(det) < DEGENERATE_UV_AREA)
+			continue;
+		float r = 1.0f / det;
 
 		float tx = (t2 * x1 - t1 * x2) * r;
 		float ty = (t2 * y1 - t1 * y2) * r;
 		float tz = (t2 * z1 - t1 * z2) * r;
+		if (!isfinite(tx) || !isfinite(ty) || !isfinite(tz))
+			continue;
 
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx;
-		v1->Tangent.y += ty;
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx;
-		v2->Tangent.y += ty;
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx;
-		v3->Tangent.y += ty;
-		v3->Tangent.z += tz;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			XMFLOAT3& tangent = tangents[indices[i + corner]];
+			tangent.x += tx;
+			tangent.y += ty;
+			tangent.z += tz;
+		}
 	}
 
-	// Ensure all of the tangents are orthogonal to the normals
 	for (int i = 0; i < numVerts; i++)
 	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
-
-		// Use Gram-Schmidt orthonormalize to ensure
-		// the normal and tangent are exactly 90 degrees apart
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
-
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
+		XMFLOAT3 n = verts[i].Normal;
+		XMFLOAT3 t = tangents[i];
+
+		// Gram-Schmidt, falling back to X or Y (then plain +X) like FinishTangents
+		float dot = n.x * t.x + n.y * t.y + n.z * t.z;
+		t = XMFLOAT3(t.x - n.x * dot, t.y - n.y * dot, t.z - n.z * dot);
+		float length = sqrtf(t.x * t.x + t.y * t.y + t.z * t.z);
+		if (!(length >= 1e-6f) || !isfinite(length))
+		{
+			XMFLOAT3 axis = fabsf(n.x) < 0.9f ? XMFLOAT3(1, 0, 0) : XMFLOAT3(0, 1, 0);
+			float axisDot = n.x * axis.x + n.y * axis.y;
+			t = XMFLOAT3(axis.x - n.x * axisDot, axis.y - n.y * axisDot, -n.z * axisDot);
+			length = sqrtf(t.x * t.x + t.y * t.y + t.z * t.z);
+		}
+		if (!(length >= 1e-6f) || !isfinite(length))
+		{
+			t = XMFLOAT3(1, 0, 0);
+			length = 1.0f;
+		}
+		verts[i].Tangent = XMFLOAT3(t.x / length, t.y / length, t.z / length);
 	}
-}
\ No newline at end of file
+}
@@ -1,27 +1,59 @@
 #pragma once
 
-#include "DXCore.h"
+#include <d3d11.h>
 #include "Vertex.h"
+#include "ObjLoader.h"
+#include "MeshSimplifier.h"
+#include <DirectXCollision.h>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
-#include <fstream>
 #include <vector>
 
+	// One level of detail - a range of the shared index buffer
+	struct MeshLod
+	{
+		int indexStart;
+		int indexCount;
+	};
+
 	class Mesh {
 	public:
 		Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
 		Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
+		Microsoft::WRL::ComPtr<ID3D11Buffer> GetPositionBuffer();
 		int GetIndexCount();
-		void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+		DXGI_FORMAT GetIndexFormat();
+		const DirectX::BoundingBox& GetBoundingBox();
+		const DirectX::BoundingSphere& GetBoundingSphere();
+		bool HasPackedVertices();
+		size_t GetMemorySize();
+		int GetLodCount();
+		int SelectLod(float screenSize);
+		void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, int lod = 0);
+		void DrawPositionOnly(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
 		Mesh(Vertex* vertexArray, int vertexNum, int* indexArray, int indexNum, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
-		Mesh(const char* file, Microsoft::WRL::ComPtr<ID3D11Device> device);
+		Mesh(const char* file, Microsoft::WRL::ComPtr<ID3D11Device> device, bool optimize = true, bool packVertices = false, bool positionStream = true, bool generateLods = true);
 		~Mesh();
-		void CreateBuffers(Vertex* vertexArray, int vertexNum, int* indexArray, int indexNum, Microsoft::WRL::ComPtr<ID3D11Device> device);
-		void CalculateTangents(Vertex* verts, int numVerts, int* indices, int numIndices);
+		void CreateBuffers(const Vertex* vertexArray, int vertexNum, const int* indexArray, int indexNum, Microsoft::WRL::ComPtr<ID3D11Device> device, const int* lodIndexCounts = nullptr, int lodCount = 0);
+		static void CalculateTangents(Vertex* verts, int numVerts, int* indices, int numIndices);
+		static void CalculateTangentsReference(Vertex* verts, int numVerts, int* indices, int numIndices);
+		static void CalculateBounds(const Vertex* vertexArray, int vertexNum, DirectX::BoundingBox& box, DirectX::BoundingSphere& sphere);
+		static DXGI_FORMAT PackIndices(const int* indexArray, int indexNum, int vertexNum, std::vector<unsigned short>& packed16);
+		static Microsoft::WRL::ComPtr<ID3D11InputLayout> CreatePackedInputLayout(Microsoft::WRL::ComPtr<ID3D11Device> device, const void* shaderCode, size_t shaderSize, bool positionOnly);
 	private:
 		// Buffers to hold actual geometry data
 		Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
 		Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> positionBuffer; // Optional copy of just the positions, for depth-only passes
 		Microsoft::WRL::ComPtr<ID3D11DeviceContext> myContext;
-		int index;
+		int index; // Index count of the full detail mesh
+		std::vector<MeshLod> lods; // Full detail first, then simpler and simpler
+		DXGI_FORMAT indexFormat; // R16_UINT when every index fits, R32_UINT otherwise
+		bool packedVertices; // PackedVertex instead of Vertex in the vertex buffer
+		bool buildPositionStream;
+		size_t memorySize; // Bytes in all the buffers above
+
+		// Local space bounds, worked out in CreateBuffers
+		DirectX::BoundingBox boundingBox;
+		DirectX::BoundingSphere boundingSphere;
 
 	};
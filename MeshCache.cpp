@@ -0,0 +1,109 @@
+#include "MeshCache.h"
+#include <algorithm>
+
+// Singleton requirement
+MeshCache* MeshCache::instance;
+
+MeshCache::~MeshCache()
+{
+	// Meshes still out there just delete themselves from now on
+	instance = nullptr;
+}
+
+std::shared_ptr<Mesh> MeshCache::Load(const char* file, Microsoft::WRL::ComPtr<ID3D11Device> device, bool optimize, bool packVertices)
+{
+	std::string key = GetKey(file, optimize, packVertices);
+	std::shared_ptr<std::mutex> loadMutex;
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+		std::shared_ptr<Mesh> mesh = FindResident(key);
+		if (mesh)
+			return mesh;
+
+		MeshCacheEntry& entry = meshes[key];
+		if (!entry.loadMutex)
+			entry.loadMutex = std::make_shared<std::mutex>();
+		loadMutex = entry.loadMutex;
+	}
+
+	// Only one thread builds a given file - the rest wait for it here,
+	// while loads of other files carry on
+	std::lock_guard<std::mutex> loadLock(*loadMutex);
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+		std::shared_ptr<Mesh> mesh = FindResident(key);
+		if (mesh)
+			return mesh;
+		stats.misses++;
+	}
+
+	Mesh* loaded = new Mesh(file, device, optimize, packVertices);
+	std::shared_ptr<Mesh> mesh(loaded, [key](Mesh* m)
+	{
+		if (instance)
+			instance->Release(key, m);
+		else
+			delete m;
+	});
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	meshes[key].mesh = mesh;
+	stats.residentMeshes++;
+	stats.residentBytes += loaded->GetMemorySize();
+	return mesh;
+}
+
+// Counts a hit if the mesh is loaded.  cacheMutex must be held.
+std::shared_ptr<Mesh> MeshCache::FindResident(const std::string& key)
+{
+	auto found = meshes.find(key);
+	if (found == meshes.end())
+		return nullptr;
+
+	std::shared_ptr<Mesh> mesh = found->second.mesh.lock();
+	if (mesh)
+		stats.hits++;
+	return mesh;
+}
+
+MeshCacheStats MeshCache::GetStats()
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	return stats;
+}
+
+// The full path (so "a/../b.obj" and "b.obj" match), lower case
+// since Windows paths aren't case sensitive, plus the options
+std::string MeshCache::GetKey(const char* file, bool optimize, bool packVertices)
+{
+	char fullPath[MAX_PATH];
+	DWORD length = GetFullPathNameA(file, MAX_PATH, fullPath, nullptr);
+	std::string key = length > 0 && length < MAX_PATH ? std::string(fullPath, length) : std::string(file);
+
+	std::transform(key.begin(), key.end(), key.begin(), [](char c)
+	{
+		return c == '/' ? '\\' : (char)tolower((unsigned char)c);
+	});
+	key += optimize ? "|optimized" : "";
+	key += packVertices ? "|packed" : "";
+	return key;
+}
+
+// Called when the last handle to a mesh goes away
+void MeshCache::Release(const std::string& key, Mesh* mesh)
+{
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		// The entry (and its load lock) stays, as another thread may
+		// already be waiting on that lock to load the file again.  It
+		// may also already hold a newer load of the same file.
+		auto found = meshes.find(key);
+		if (found != meshes.end() && found->second.mesh.expired())
+			found->second.mesh.reset();
+
+		stats.residentMeshes--;
+		stats.residentBytes -= mesh->GetMemorySize();
+	}
+	delete mesh;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Mesh.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Counters for MeshCache::GetStats
+struct MeshCacheStats
+{
+	unsigned int hits;		// Loads that found the mesh already resident
+	unsigned int misses;		// Loads that had to build the mesh
+	unsigned int residentMeshes;
+	unsigned long long residentBytes;	// GPU buffer memory of the resident meshes
+};
+
+// A cached mesh, and the lock held while it's being built
+struct MeshCacheEntry
+{
+	std::weak_ptr<Mesh> mesh;
+	std::shared_ptr<std::mutex> loadMutex;
+};
+
+// --------------------------------------------------------
+// Shares meshes loaded from files
+//
+// Every file (with the same load options) is loaded once,
+// however many times it's asked for.  Callers get shared
+// handles, and the mesh is freed as soon as the last one
+// lets go, so nothing has to remember to delete it.  Safe to
+// call from any thread.
+// --------------------------------------------------------
+class MeshCache
+{
+#pragma region Singleton
+public:
+	// Gets the one and only instance of this class
+	static MeshCache& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new MeshCache();
+		}
+
+		return *instance;
+	}
+
+	// Remove these functions (C++ 11 version)
+	MeshCache(MeshCache const&) = delete;
+	void operator=(MeshCache const&) = delete;
+
+private:
+	static MeshCache* instance;
+	MeshCache() {};
+#pragma endregion
+
+public:
+	~MeshCache();
+
+	// Same options as the Mesh file constructor
+	std::shared_ptr<Mesh> Load(const char* file, Microsoft::WRL::ComPtr<ID3D11Device> device, bool optimize = true, bool packVertices = false);
+
+	MeshCacheStats GetStats();
+
+private:
+	static std::string GetKey(const char* file, bool optimize, bool packVertices);
+	std::shared_ptr<Mesh> FindResident(const std::string& key);
+	void Release(const std::string& key, Mesh* mesh);
+
+	std::mutex cacheMutex;
+	std::unordered_map<std::string, MeshCacheEntry> meshes;
+	MeshCacheStats stats = {};
+};
@@ -0,0 +1,172 @@
+#include "MeshFile.h"
+#include <fstream>
+using namespace DirectX;
+
+static const unsigned int MESH_FILE_MAGIC = 0x4853454D; // "MESH"
+
+// Each set of flags gets its own file, so loading the same source two
+// ways doesn't keep rebuilding one cache back and forth
+std::string MeshFile::GetCachePath(const char* sourceFile, unsigned int flags)
+{
+	return std::string(sourceFile) + "." + std::to_string(flags) + ".mesh";
+}
+
+const MeshFileHeader* MeshFile::Validate(MappedFile& cache, const char* sourceFile, unsigned int flags)
+{
+	if (!cache.IsOpen() || cache.GetSize() < sizeof(MeshFileHeader))
+		return nullptr;
+
+	const MeshFileHeader* header = (const MeshFileHeader*)cache.GetData();
+	if (header->magic != MESH_FILE_MAGIC || header->version != MESH_FILE_VERSION || header->flags != flags)
+		return nullptr;
+
+	// Make sure the file isn't truncated (e.g. from an interrupted write)
+	size_t expectedSize = sizeof(MeshFileHeader)
+		+ sizeof(Vertex) * (size_t)header->vertexCount
+		+ sizeof(int) * (size_t)header->indexCount;
+	if (cache.GetSize() != expectedSize)
+		return nullptr;
+
+	// The levels of detail have to add up to the whole index list
+	if (header->lodCount < 1 || header->lodCount > MESH_MAX_LODS)
+		return nullptr;
+	size_t lodIndices = 0;
+	for (unsigned int i = 0; i < header->lodCount; i++)
+	{
+		lodIndices += header->lodIndexCounts[i];
+	}
+	if (lodIndices != header->indexCount)
+		return nullptr;
+
+	// Every index has to land on a vertex - the buffers go straight to the GPU
+	const int* indices = GetIndices(header);
+	for (unsigned int i = 0; i < header->indexCount; i++)
+	{
+		if ((unsigned int)indices[i] >= header->vertexCount)
+			return nullptr;
+	}
+
+	// No source at all?  Then the cache is all we have
+	unsigned long long sourceSize = 0;
+	unsigned long long sourceTime = 0;
+	if (!GetSourceInfo(sourceFile, sourceSize, sourceTime))
+		return header;
+
+	if (sourceSize != header->sourceSize)
+		return nullptr;
+
+	// Same size and write time is the fast path.  Otherwise the
+	// file was touched (or copied), so fall back to the contents.
+	if (sourceTime == header->sourceTime || HashFile(sourceFile) == header->sourceHash)
+		return header;
+
+	return nullptr;
+}
+
+bool MeshFile::Write(const char* sourceFile, MeshData& meshData, unsigned int flags)
+{
+	if (meshData.vertices.empty() || meshData.indices.empty())
+		return false;
+
+	MeshFileHeader header = {};
+	header.magic = MESH_FILE_MAGIC;
+	header.version = MESH_FILE_VERSION;
+	header.flags = flags;
+	header.vertexCount = (unsigned int)meshData.vertices.size();
+	header.indexCount = (unsigned int)meshData.indices.size();
+	if (meshData.lodIndexCounts.empty())
+	{
+		header.lodCount = 1;
+		header.lodIndexCounts[0] = (int)meshData.indices.size();
+	}
+	else
+	{
+		if (meshData.lodIndexCounts.size() > MESH_MAX_LODS)
+			return false;
+		header.lodCount = (unsigned int)meshData.lodIndexCounts.size();
+		for (unsigned int i = 0; i < header.lodCount; i++)
+		{
+			header.lodIndexCounts[i] = meshData.lodIndexCounts[i];
+		}
+	}
+	header.sourceHash = HashFile(sourceFile);
+	if (!GetSourceInfo(sourceFile, header.sourceSize, header.sourceTime))
+		return false;
+
+	// Bounds of the whole mesh
+	XMVECTOR boundsMin = XMLoadFloat3(&meshData.vertices[0].Position);
+	XMVECTOR boundsMax = boundsMin;
+	for (Vertex& v : meshData.vertices)
+	{
+		XMVECTOR pos = XMLoadFloat3(&v.Position);
+		boundsMin = XMVectorMin(boundsMin, pos);
+		boundsMax = XMVectorMax(boundsMax, pos);
+	}
+	XMStoreFloat3(&header.boundsMin, boundsMin);
+	XMStoreFloat3(&header.boundsMax, boundsMax);
+
+	// Written to a temporary file first and then moved into place, so a
+	// crash or another thread loading the same mesh never sees half a file
+	std::string cachePath = GetCachePath(sourceFile, flags);
+	std::string tempPath = cachePath + "." + std::to_string(GetCurrentThreadId()) + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return false;
+
+		out.write((const char*)&header, sizeof(MeshFileHeader));
+		out.write((const char*)&meshData.vertices[0], sizeof(Vertex) * meshData.vertices.size());
+		out.write((const char*)&meshData.indices[0], sizeof(int) * meshData.indices.size());
+		if (!out.good())
+		{
+			out.close();
+			DeleteFileA(tempPath.c_str());
+			return false;
+		}
+	}
+
+	if (!MoveFileExA(tempPath.c_str(), cachePath.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFileA(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+const Vertex* MeshFile::GetVertices(const MeshFileHeader* header)
+{
+	return (const Vertex*)(header + 1);
+}
+
+const int* MeshFile::GetIndices(const MeshFileHeader* header)
+{
+	return (const int*)(GetVertices(header) + header->vertexCount);
+}
+
+bool MeshFile::GetSourceInfo(const char* sourceFile, unsigned long long& size, unsigned long long& time)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes = {};
+	if (!GetFileAttributesExA(sourceFile, GetFileExInfoStandard, &attributes))
+		return false;
+
+	size = ((unsigned long long)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+	time = ((unsigned long long)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+// 64-bit FNV-1a over the whole file
+unsigned long long MeshFile::HashFile(const char* sourceFile)
+{
+	MappedFile source(sourceFile);
+	if (!source.IsOpen())
+		return 0;
+
+	unsigned long long hash = 14695981039346656037ull;
+	const unsigned char* bytes = (const unsigned char*)source.GetData();
+	for (size_t i = 0; i < source.GetSize(); i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <string>
+#include "ObjLoader.h"
+#include "MeshSimplifier.h"
+#include "MappedFile.h"
+
+// Bump this whenever the layout or the loader output changes,
+// so stale caches are rebuilt instead of being trusted
+const unsigned int MESH_FILE_VERSION = 4;
+
+// Bits for MeshFileHeader::flags, recording how the mesh was processed
+const unsigned int MESH_FILE_OPTIMIZED = 1 << 0;	// Ran through MeshOptimizer
+const unsigned int MESH_FILE_LODS = 1 << 1;		// Has MeshSimplifier levels of detail
+
+// --------------------------------------------------------
+// Header at the start of every cached mesh file.  It is
+// followed directly by vertexCount Vertex structs and then
+// indexCount 32-bit indices (every level of detail in turn).
+// --------------------------------------------------------
+struct MeshFileHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned long long sourceSize;	// Size in bytes of the .obj this was built from
+	unsigned long long sourceTime;	// Last write time of that .obj
+	unsigned long long sourceHash;	// FNV-1a hash of that .obj's bytes
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	DirectX::XMFLOAT3 boundsMin;
+	DirectX::XMFLOAT3 boundsMax;
+	unsigned int flags;			// MESH_FILE_ bits above
+	unsigned int lodCount;
+	int lodIndexCounts[MESH_MAX_LODS];
+};
+
+// --------------------------------------------------------
+// Binary cache of ready-to-upload mesh data
+//
+// The cache lives next to the source file, one per set of
+// flags (sphere.obj -> sphere.obj.1.mesh when optimized), and
+// is validated against the source's size, write time and
+// contents before being used.
+// --------------------------------------------------------
+class MeshFile
+{
+public:
+	static std::string GetCachePath(const char* sourceFile, unsigned int flags);
+
+	// Returns the header inside the mapped cache if it is usable
+	// for this source file and was built with the same flags,
+	// or nullptr if it must be rebuilt
+	static const MeshFileHeader* Validate(MappedFile& cache, const char* sourceFile, unsigned int flags);
+
+	// Writes the (already tangent-calculated) mesh next to the source
+	static bool Write(const char* sourceFile, MeshData& meshData, unsigned int flags);
+
+	static const Vertex* GetVertices(const MeshFileHeader* header);
+	static const int* GetIndices(const MeshFileHeader* header);
+
+private:
+	static bool GetSourceInfo(const char* sourceFile, unsigned long long& size, unsigned long long& time);
+	static unsigned long long HashFile(const char* sourceFile);
+};
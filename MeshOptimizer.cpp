@@ -0,0 +1,381 @@
+#include "MeshOptimizer.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+using namespace DirectX;
+
+// Size of the LRU cache the vertex cache optimizer aims for
+static const int MODELED_CACHE_SIZE = 32;
+
+// Size of the FIFO cache used when reporting ACMR (and by overdraw clustering)
+static const int REPORTED_CACHE_SIZE = 16;
+
+// Scoring constants from Forsyth's article
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+// Scores above this many remaining triangles are all the same
+static const int MAX_SCORED_VALENCE = 32;
+
+// A run of triangles is ended once it starts missing the cache
+// this much more than its best, so each run stays cache friendly
+static const float OVERDRAW_ACMR_THRESHOLD = 1.05f;
+
+// --------------------------------------------------------
+// How much we want to draw a triangle using this vertex next.
+// Recently used vertices score high (they're still in the
+// cache), as do vertices with few triangles left (finishing
+// them off keeps them from being needed again later).
+// --------------------------------------------------------
+static float VertexScore(int cachePosition, int remainingTriangles)
+{
+	// Nothing left to draw with this vertex
+	if (remainingTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// The last triangle's three vertices all get the same score,
+		// so there's no preference for which way the strip goes
+		if (cachePosition < 3)
+		{
+			score = LAST_TRIANGLE_SCORE;
+		}
+		else
+		{
+			float scaler = 1.0f / (MODELED_CACHE_SIZE - 3);
+			score = powf(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+		}
+	}
+
+	if (remainingTriangles > MAX_SCORED_VALENCE)
+		remainingTriangles = MAX_SCORED_VALENCE;
+	score += VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -VALENCE_BOOST_POWER);
+	return score;
+}
+
+void MeshOptimizer::Optimize(MeshData& meshData, MeshOptimizerStats* stats)
+{
+	if (meshData.indices.empty())
+	{
+		if (stats)
+			*stats = MeshOptimizerStats();
+		return;
+	}
+
+	int indexCount = (int)meshData.indices.size();
+	int vertexCount = (int)meshData.vertices.size();
+	if (stats)
+		stats->acmrBefore = CalculateACMR(&meshData.indices[0], indexCount, vertexCount, REPORTED_CACHE_SIZE);
+
+	OptimizeVertexCache(&meshData.indices[0], indexCount, vertexCount);
+	if (stats)
+		stats->acmrAfterCache = CalculateACMR(&meshData.indices[0], indexCount, vertexCount, REPORTED_CACHE_SIZE);
+
+	OptimizeOverdraw(&meshData.vertices[0], &meshData.indices[0], indexCount);
+	OptimizeVertexFetch(meshData.vertices, meshData.indices);
+	if (stats)
+		stats->acmrAfter = CalculateACMR(&meshData.indices[0], indexCount, (int)meshData.vertices.size(), REPORTED_CACHE_SIZE);
+}
+
+void MeshOptimizer::OptimizeVertexCache(int* indices, int indexCount, int vertexCount)
+{
+	int triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles that use each vertex, packed into one array
+	// (vertex v's are at vertexTriangles[firstTriangle[v]...])
+	std::vector<int> remaining(vertexCount, 0);
+	for (int i = 0; i < triangleCount * 3; i++)
+	{
+		remaining[indices[i]]++;
+	}
+
+	std::vector<int> firstTriangle(vertexCount, 0);
+	for (int v = 1; v < vertexCount; v++)
+	{
+		firstTriangle[v] = firstTriangle[v - 1] + remaining[v - 1];
+	}
+
+	std::vector<int> vertexTriangles(triangleCount * 3);
+	{
+		std::vector<int> cursor = firstTriangle;
+		for (int i = 0; i < triangleCount * 3; i++)
+		{
+			vertexTriangles[cursor[indices[i]]++] = i / 3;
+		}
+	}
+
+	// Starting scores
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (int v = 0; v < vertexCount; v++)
+	{
+		vertexScores[v] = VertexScore(-1, remaining[v]);
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	int bestTriangle = 0;
+	float bestScore = -1.0f;
+	for (int t = 0; t < triangleCount; t++)
+	{
+		float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+		if (score > bestScore)
+		{
+			bestScore = score;
+			bestTriangle = t;
+		}
+	}
+
+	// The simulated cache, plus room for the triangle being added
+	int cache[MODELED_CACHE_SIZE + 3];
+	int cacheCount = 0;
+
+	std::vector<int> output;
+	output.reserve(triangleCount * 3);
+	int nextUnemitted = 0;
+
+	while ((int)output.size() < triangleCount * 3)
+	{
+		// Nothing in the cache is any use, so start somewhere new
+		if (bestTriangle < 0)
+		{
+			while (emitted[nextUnemitted])
+				nextUnemitted++;
+			bestTriangle = nextUnemitted;
+		}
+
+		const int* tri = &indices[bestTriangle * 3];
+		output.push_back(tri[0]);
+		output.push_back(tri[1]);
+		output.push_back(tri[2]);
+		emitted[bestTriangle] = true;
+
+		// This triangle no longer counts against its vertices
+		for (int corner = 0; corner < 3; corner++)
+		{
+			int v = tri[corner];
+			int* list = &vertexTriangles[firstTriangle[v]];
+			for (int i = 0; i < remaining[v]; i++)
+			{
+				if (list[i] == bestTriangle)
+				{
+					list[i] = list[remaining[v] - 1];
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// Move the triangle's vertices to the front of the cache
+		int newCache[MODELED_CACHE_SIZE + 3];
+		int newCount = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			newCache[newCount++] = tri[corner];
+		}
+		for (int i = 0; i < cacheCount; i++)
+		{
+			int v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCount++] = v;
+		}
+
+		// Anything pushed off the end leaves the cache
+		for (int i = MODELED_CACHE_SIZE; i < newCount; i++)
+		{
+			cachePosition[newCache[i]] = -1;
+			vertexScores[newCache[i]] = VertexScore(-1, remaining[newCache[i]]);
+		}
+		cacheCount = newCount < MODELED_CACHE_SIZE ? newCount : MODELED_CACHE_SIZE;
+		for (int i = 0; i < cacheCount; i++)
+		{
+			cache[i] = newCache[i];
+			cachePosition[cache[i]] = i;
+			vertexScores[cache[i]] = VertexScore(i, remaining[cache[i]]);
+		}
+
+		// Rescore the triangles touching anything that changed and
+		// pick the best of them to go next
+		bestTriangle = -1;
+		bestScore = -1.0f;
+		for (int i = 0; i < newCount; i++)
+		{
+			int v = newCache[i];
+			const int* list = &vertexTriangles[firstTriangle[v]];
+			for (int j = 0; j < remaining[v]; j++)
+			{
+				int t = list[j];
+				float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+	}
+
+	memcpy(indices, &output[0], sizeof(int) * triangleCount * 3);
+}
+
+// --------------------------------------------------------
+// Based on "Fast Triangle Reordering for Vertex Locality
+// and Reduced Overdraw" (Sander, Nehab & Barczak).  The
+// cache-ordered triangles are cut into clusters wherever the
+// cache efficiency drops off, and the clusters are drawn in
+// order of how much they face away from the mesh's center.
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeOverdraw(const Vertex* vertices, int* indices, int indexCount)
+{
+	int triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Split into clusters using a running FIFO cache simulation
+	std::vector<int> clusterStarts;
+	{
+		std::vector<int> cache(REPORTED_CACHE_SIZE, -1);
+		int cacheHead = 0;
+		int runStart = 0;
+		int runMisses = 0;
+		float bestRunACMR = 3.0f;
+
+		for (int t = 0; t < triangleCount; t++)
+		{
+			int misses = 0;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				int v = indices[t * 3 + corner];
+				if (std::find(cache.begin(), cache.end(), v) == cache.end())
+				{
+					cache[cacheHead] = v;
+					cacheHead = (cacheHead + 1) % REPORTED_CACHE_SIZE;
+					misses++;
+				}
+			}
+
+			// A triangle that misses completely means the cache was
+			// effectively flushed, which is a free place to cut
+			int runLength = t - runStart;
+			float runACMR = runLength > 0 ? (float)runMisses / runLength : 3.0f;
+			if (t == 0 || misses == 3 || (runLength > 0 && runACMR > bestRunACMR * OVERDRAW_ACMR_THRESHOLD))
+			{
+				clusterStarts.push_back(t);
+				runStart = t;
+				runMisses = 0;
+				bestRunACMR = 3.0f;
+			}
+
+			runMisses += misses;
+			runLength = t - runStart + 1;
+			runACMR = (float)runMisses / runLength;
+			if (runLength > 16 && runACMR < bestRunACMR)
+				bestRunACMR = runACMR;
+		}
+	}
+	int clusterCount = (int)clusterStarts.size();
+	clusterStarts.push_back(triangleCount);
+
+	// Center of the whole mesh, weighted by area
+	XMVECTOR meshCenter = XMVectorZero();
+	float meshArea = 0.0f;
+	for (int t = 0; t < triangleCount; t++)
+	{
+		XMVECTOR a = XMLoadFloat3(&vertices[indices[t * 3]].Position);
+		XMVECTOR b = XMLoadFloat3(&vertices[indices[t * 3 + 1]].Position);
+		XMVECTOR c = XMLoadFloat3(&vertices[indices[t * 3 + 2]].Position);
+		float area = XMVectorGetX(XMVector3Length(XMVector3Cross(b - a, c - a)));
+		meshCenter += (a + b + c) * (area / 3.0f);
+		meshArea += area;
+	}
+	if (meshArea > 0.0f)
+		meshCenter = meshCenter / XMVectorReplicate(meshArea);
+
+	// How much each cluster faces outward
+	std::vector<float> sortKeys(clusterCount);
+	for (int cluster = 0; cluster < clusterCount; cluster++)
+	{
+		XMVECTOR center = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+		for (int t = clusterStarts[cluster]; t < clusterStarts[cluster + 1]; t++)
+		{
+			XMVECTOR a = XMLoadFloat3(&vertices[indices[t * 3]].Position);
+			XMVECTOR b = XMLoadFloat3(&vertices[indices[t * 3 + 1]].Position);
+			XMVECTOR c = XMLoadFloat3(&vertices[indices[t * 3 + 2]].Position);
+			XMVECTOR cross = XMVector3Cross(b - a, c - a);
+			float triangleArea = XMVectorGetX(XMVector3Length(cross));
+			center += (a + b + c) * (triangleArea / 3.0f);
+			normal += cross;
+			area += triangleArea;
+		}
+		if (area > 0.0f)
+			center = center / XMVectorReplicate(area);
+
+		// Front faces wind so this cross product points outward
+		sortKeys[cluster] = XMVectorGetX(XMVector3Dot(center - meshCenter, XMVector3Normalize(normal)));
+	}
+
+	// Most outward facing first
+	std::vector<int> order(clusterCount);
+	for (int i = 0; i < clusterCount; i++)
+	{
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<int> output;
+	output.reserve(triangleCount * 3);
+	for (int cluster : order)
+	{
+		output.insert(output.end(), indices + clusterStarts[cluster] * 3, indices + clusterStarts[cluster + 1] * 3);
+	}
+	memcpy(indices, &output[0], sizeof(int) * triangleCount * 3);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<int>& indices)
+{
+	// Number the vertices in the order the triangles first use them
+	std::vector<int> remap(vertices.size(), -1);
+	std::vector<Vertex> ordered;
+	ordered.reserve(vertices.size());
+	for (int& index : indices)
+	{
+		if (remap[index] < 0)
+		{
+			remap[index] = (int)ordered.size();
+			ordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	// Anything no triangle used is simply dropped
+	vertices.swap(ordered);
+}
+
+float MeshOptimizer::CalculateACMR(const int* indices, int indexCount, int vertexCount, int cacheSize)
+{
+	int triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return 0.0f;
+
+	// Each vertex remembers when it was last loaded, so a lookup is
+	// "was it loaded within the last cacheSize misses"
+	std::vector<int> loadedAt(vertexCount, -cacheSize - 1);
+	int misses = 0;
+	for (int i = 0; i < triangleCount * 3; i++)
+	{
+		int v = indices[i];
+		if (misses - loadedAt[v] > cacheSize)
+		{
+			loadedAt[v] = misses;
+			misses++;
+		}
+	}
+	return (float)misses / triangleCount;
+}
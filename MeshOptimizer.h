@@ -0,0 +1,43 @@
+#pragma once
+
+#include "ObjLoader.h"
+
+// --------------------------------------------------------
+// Average cache miss ratio (see CalculateACMR) before and
+// after MeshOptimizer::Optimize, on a 16 entry FIFO cache
+// --------------------------------------------------------
+struct MeshOptimizerStats
+{
+	float acmrBefore;		// As loaded
+	float acmrAfterCache;		// After OptimizeVertexCache
+	float acmrAfter;		// After OptimizeOverdraw (what's drawn)
+};
+
+// --------------------------------------------------------
+// Reorders mesh data so the GPU does less work drawing it
+//
+// - Triangles are sorted for the post-transform vertex cache
+//   (Tom Forsyth's "Linear-Speed Vertex Cache Optimisation")
+// - Runs of those triangles are then sorted outside-in, so
+//   the outer surface tends to be drawn first (less overdraw)
+// - Finally vertices are renumbered in the order they're
+//   first used, so vertex fetches walk through memory
+//
+// None of this changes what the mesh looks like.
+// --------------------------------------------------------
+class MeshOptimizer
+{
+public:
+	// Runs every step below, in order.  Measuring the ACMR
+	// costs three extra passes, so it's only done when asked.
+	static void Optimize(MeshData& meshData, MeshOptimizerStats* stats = nullptr);
+
+	static void OptimizeVertexCache(int* indices, int indexCount, int vertexCount);
+	static void OptimizeOverdraw(const Vertex* vertices, int* indices, int indexCount);
+	static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<int>& indices);
+
+	// Average cache miss ratio: vertex shader runs per triangle
+	// on a FIFO cache of the given size.  1.0 means every vertex
+	// is shared perfectly, 3.0 means nothing is ever reused.
+	static float CalculateACMR(const int* indices, int indexCount, int vertexCount, int cacheSize);
+};
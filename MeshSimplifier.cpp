@@ -0,0 +1,349 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+using namespace DirectX;
+
+// How far (relative to the mesh size) a level of detail may stray
+static const float MAX_LOD_ERROR = 0.05f;
+
+// A level of detail must lose at least this much to be kept
+static const float MIN_LOD_REDUCTION = 0.9f;
+
+// --------------------------------------------------------
+// Sum of squared distances to a set of planes, stored as
+// the upper half of a symmetric 4x4 matrix, plus the total
+// weight of the planes so the error comes out as a distance
+// --------------------------------------------------------
+struct Quadric
+{
+	double a2, ab, ac, ad;
+	double b2, bc, bd;
+	double c2, cd;
+	double d2;
+	double weight;
+
+	void AddPlane(double a, double b, double c, double d, double planeWeight)
+	{
+		a2 += a * a * planeWeight; ab += a * b * planeWeight; ac += a * c * planeWeight; ad += a * d * planeWeight;
+		b2 += b * b * planeWeight; bc += b * c * planeWeight; bd += b * d * planeWeight;
+		c2 += c * c * planeWeight; cd += c * d * planeWeight;
+		d2 += d * d * planeWeight;
+		weight += planeWeight;
+	}
+
+	void Add(const Quadric& q)
+	{
+		a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+		b2 += q.b2; bc += q.bc; bd += q.bd;
+		c2 += q.c2; cd += q.cd;
+		d2 += q.d2;
+		weight += q.weight;
+	}
+
+	// Weighted mean squared distance from p to the planes
+	double Evaluate(const XMFLOAT3& p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double error =
+			a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+			b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+			c2 * z * z + 2 * cd * z +
+			d2;
+		if (error <= 0 || weight <= 0)
+			return 0;
+		return error / weight;
+	}
+};
+
+// A possible edge collapse: "from" moves onto "to"
+struct Collapse
+{
+	int from;
+	int to;
+	double cost;
+};
+
+// Hash for finding vertices that share a position.  -0 and 0
+// are equal (see PositionEqual), so they have to hash the same.
+struct PositionHash
+{
+	size_t operator()(const XMFLOAT3& p) const
+	{
+		float values[3] = { p.x == 0.0f ? 0.0f : p.x, p.y == 0.0f ? 0.0f : p.y, p.z == 0.0f ? 0.0f : p.z };
+		unsigned int bits[3];
+		memcpy(bits, values, sizeof(bits));
+		return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+	}
+};
+
+struct PositionEqual
+{
+	bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+};
+
+static XMVECTOR TriangleNormal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+{
+	XMVECTOR pa = XMLoadFloat3(&a);
+	return XMVector3Cross(XMLoadFloat3(&b) - pa, XMLoadFloat3(&c) - pa);
+}
+
+void MeshSimplifier::GenerateLods(MeshData& meshData, int maxLods, bool optimize)
+{
+	meshData.lodIndexCounts.clear();
+	if (meshData.indices.empty())
+		return;
+
+	// Each level is simplified from the full mesh, so the errors
+	// don't pile up from one level to the next
+	std::vector<int> fullIndices = meshData.indices;
+	int fullCount = (int)fullIndices.size();
+	int previousCount = fullCount;
+	meshData.lodIndexCounts.push_back(fullCount);
+
+	if (maxLods > MESH_MAX_LODS)
+		maxLods = MESH_MAX_LODS;
+
+	for (int lod = 1; lod < maxLods; lod++)
+	{
+		int target = (fullCount >> lod) / 3 * 3;
+		std::vector<int> lodIndices;
+		Simplify(&meshData.vertices[0], (int)meshData.vertices.size(), &fullIndices[0], fullCount,
+			target, MAX_LOD_ERROR, lodIndices);
+
+		// Couldn't get much simpler without breaking something
+		if (lodIndices.empty() || lodIndices.size() > previousCount * MIN_LOD_REDUCTION)
+			break;
+
+		if (optimize)
+			MeshOptimizer::OptimizeVertexCache(&lodIndices[0], (int)lodIndices.size(), (int)meshData.vertices.size());
+
+		meshData.indices.insert(meshData.indices.end(), lodIndices.begin(), lodIndices.end());
+		meshData.lodIndexCounts.push_back((int)lodIndices.size());
+		previousCount = (int)lodIndices.size();
+	}
+}
+
+float MeshSimplifier::Simplify(const Vertex* vertices, int vertexCount, const int* indices, int indexCount,
+	int targetIndexCount, float maxError, std::vector<int>& result)
+{
+	result.assign(indices, indices + indexCount / 3 * 3);
+	if (result.empty() || vertexCount == 0)
+		return 0.0f;
+
+	// Work in a unit-sized space so errors are relative to the mesh
+	XMVECTOR boundsMin = XMLoadFloat3(&vertices[0].Position);
+	XMVECTOR boundsMax = boundsMin;
+	for (int v = 0; v < vertexCount; v++)
+	{
+		boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&vertices[v].Position));
+		boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&vertices[v].Position));
+	}
+	XMFLOAT3 size;
+	XMStoreFloat3(&size, boundsMax - boundsMin);
+	float extent = size.x > size.y ? (size.x > size.z ? size.x : size.z) : (size.y > size.z ? size.y : size.z);
+	float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+	std::vector<XMFLOAT3> positions(vertexCount);
+	for (int v = 0; v < vertexCount; v++)
+	{
+		XMStoreFloat3(&positions[v], (XMLoadFloat3(&vertices[v].Position) - boundsMin) * scale);
+	}
+
+	// Vertices split by a seam (same position, different uv or
+	// normal) have to stay put, or the seam would tear open
+	std::vector<bool> locked(vertexCount, false);
+	std::vector<int> canonical(vertexCount);
+	{
+		std::unordered_map<XMFLOAT3, int, PositionHash, PositionEqual> firstAtPosition;
+		for (int v = 0; v < vertexCount; v++)
+		{
+			auto found = firstAtPosition.insert({ positions[v], v });
+			canonical[v] = found.first->second;
+			if (!found.second)
+			{
+				locked[v] = true;
+				locked[found.first->second] = true;
+			}
+		}
+	}
+
+	// So do vertices on an open border (an edge with one triangle)
+	{
+		std::unordered_map<unsigned long long, int> edgeUses;
+		for (size_t i = 0; i < result.size(); i++)
+		{
+			unsigned long long a = canonical[result[i]];
+			unsigned long long b = canonical[result[i - i % 3 + (i + 1) % 3]];
+			edgeUses[a < b ? (a << 32) | b : (b << 32) | a]++;
+		}
+		for (size_t i = 0; i < result.size(); i++)
+		{
+			int a = canonical[result[i]];
+			int b = canonical[result[i - i % 3 + (i + 1) % 3]];
+			unsigned long long key = a < b ? ((unsigned long long)a << 32) | b : ((unsigned long long)b << 32) | a;
+			if (edgeUses[key] == 1)
+			{
+				locked[result[i]] = true;
+				locked[result[i - i % 3 + (i + 1) % 3]] = true;
+			}
+		}
+	}
+
+	// Each vertex starts with the planes of the triangles around it
+	std::vector<Quadric> quadrics(vertexCount, Quadric());
+	for (size_t t = 0; t < result.size(); t += 3)
+	{
+		XMVECTOR normal = TriangleNormal(positions[result[t]], positions[result[t + 1]], positions[result[t + 2]]);
+		float area = XMVectorGetX(XMVector3Length(normal));
+		if (area <= 0.0f)
+			continue;
+
+		XMFLOAT3 n;
+		XMStoreFloat3(&n, normal / XMVectorReplicate(area));
+		const XMFLOAT3& p = positions[result[t]];
+		double d = -(n.x * p.x + n.y * p.y + n.z * p.z);
+		for (int corner = 0; corner < 3; corner++)
+		{
+			quadrics[result[t + corner]].AddPlane(n.x, n.y, n.z, d, area);
+		}
+	}
+
+	double maxCost = (double)maxError * maxError;
+	double largestCost = 0.0;
+	std::vector<int> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::vector<int> firstTriangle(vertexCount + 1);
+	std::vector<int> vertexTriangles;
+	std::vector<Collapse> collapses;
+
+	// Collapse in passes.  Within a pass a vertex is only involved
+	// in one collapse, so all the costs and neighbors stay valid.
+	while ((int)result.size() > targetIndexCount)
+	{
+		int triangleCount = (int)result.size() / 3;
+
+		// Triangles around each vertex
+		std::fill(firstTriangle.begin(), firstTriangle.end(), 0);
+		for (int index : result)
+		{
+			firstTriangle[index + 1]++;
+		}
+		for (int v = 0; v < vertexCount; v++)
+		{
+			firstTriangle[v + 1] += firstTriangle[v];
+		}
+		vertexTriangles.resize(result.size());
+		{
+			std::vector<int> cursor(firstTriangle.begin(), firstTriangle.end() - 1);
+			for (size_t i = 0; i < result.size(); i++)
+			{
+				vertexTriangles[cursor[result[i]]++] = (int)i / 3;
+			}
+		}
+
+		// Cheapest way to collapse each edge.  Every inside edge shows
+		// up twice (once per triangle), so only look at it once.
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i++)
+		{
+			int a = result[i];
+			int b = result[i - i % 3 + (i + 1) % 3];
+			if (a > b || (locked[a] && locked[b]))
+				continue;
+
+			Quadric q = quadrics[a];
+			q.Add(quadrics[b]);
+			double costAToB = locked[a] ? DBL_MAX : q.Evaluate(positions[b]);
+			double costBToA = locked[b] ? DBL_MAX : q.Evaluate(positions[a]);
+			if (costAToB <= costBToA)
+				collapses.push_back({ a, b, costAToB });
+			else
+				collapses.push_back({ b, a, costBToA });
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+		for (int v = 0; v < vertexCount; v++)
+		{
+			remap[v] = v;
+			touched[v] = false;
+		}
+
+		// Each collapse removes about two triangles
+		int trianglesToRemove = triangleCount - targetIndexCount / 3;
+		int removed = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (removed >= trianglesToRemove || collapse.cost > maxCost)
+				break;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+
+			// Don't let any triangle that stays flip over
+			bool flips = false;
+			int sharedTriangles = 0;
+			for (int j = firstTriangle[collapse.from]; j < firstTriangle[collapse.from + 1] && !flips; j++)
+			{
+				const int* tri = &result[vertexTriangles[j] * 3];
+				if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+				{
+					sharedTriangles++;
+					continue;
+				}
+
+				XMFLOAT3 moved[3];
+				for (int corner = 0; corner < 3; corner++)
+				{
+					moved[corner] = positions[tri[corner] == collapse.from ? collapse.to : tri[corner]];
+				}
+				XMVECTOR before = TriangleNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+				XMVECTOR after = TriangleNormal(moved[0], moved[1], moved[2]);
+				flips = XMVectorGetX(XMVector3Dot(before, after)) <= 0.0f;
+			}
+			if (flips)
+				continue;
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].Add(quadrics[collapse.from]);
+			if (collapse.cost > largestCost)
+				largestCost = collapse.cost;
+			removed += sharedTriangles;
+
+			// Everything around the collapse has changed shape
+			for (int j = firstTriangle[collapse.from]; j < firstTriangle[collapse.from + 1]; j++)
+			{
+				const int* tri = &result[vertexTriangles[j] * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+			}
+			touched[collapse.to] = true;
+		}
+
+		// Nothing left that's cheap enough
+		if (removed == 0)
+			break;
+
+		// Apply the collapses and drop triangles that fell flat
+		size_t kept = 0;
+		for (size_t t = 0; t < result.size(); t += 3)
+		{
+			int a = remap[result[t]];
+			int b = remap[result[t + 1]];
+			int c = remap[result[t + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+
+			result[kept++] = a;
+			result[kept++] = b;
+			result[kept++] = c;
+		}
+		result.resize(kept);
+	}
+
+	return (float)sqrt(largestCost);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ObjLoader.h"
+
+// Most levels of detail a mesh can have, including the full one
+const int MESH_MAX_LODS = 4;
+
+// --------------------------------------------------------
+// Builds lower detail versions of a mesh
+//
+// Edges are collapsed cheapest-first using quadric error
+// metrics (Garland & Heckbert), always moving one vertex onto
+// the other.  No new vertices are made, so every level of
+// detail shares the original vertex buffer and only needs its
+// own indices.  Vertices on UV/normal seams and open borders
+// never move, so the silhouette and texturing hold together.
+// --------------------------------------------------------
+class MeshSimplifier
+{
+public:
+	// Appends up to maxLods - 1 simpler index lists after the
+	// full one, each about half the triangles of the last, and
+	// fills in meshData.lodIndexCounts
+	static void GenerateLods(MeshData& meshData, int maxLods, bool optimize);
+
+	// Collapses edges until there are at most targetIndexCount
+	// indices left, or until the next collapse would put a vertex
+	// more than maxError (relative to the size of the mesh, as an
+	// area-weighted RMS) from the original triangles around it.
+	// Returns the largest error of any collapse made.
+	static float Simplify(const Vertex* vertices, int vertexCount, const int* indices, int indexCount,
+		int targetIndexCount, float maxError, std::vector<int>& result);
+};
@@ -0,0 +1,118 @@
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+#include <emmintrin.h>
+
+// Rows per job when a level is split across the pool
+static const unsigned int MIP_ROWS_PER_JOB = 64;
+
+void MipGenerator::GenerateMips(std::vector<MipLevel>& levels)
+{
+	if (levels.empty())
+		return;
+
+	levels.resize(1);
+	while (levels.back().width > 1 || levels.back().height > 1)
+	{
+		MipLevel next;
+		Downsample(levels.back(), next);
+		levels.push_back(std::move(next));
+	}
+}
+
+void MipGenerator::Downsample(const MipLevel& source, MipLevel& destination)
+{
+	destination.width = source.width > 1 ? source.width / 2 : 1;
+	destination.height = source.height > 1 ? source.height / 2 : 1;
+	destination.pixels.resize((size_t)destination.width * destination.height * 4);
+
+	// Small levels aren't worth handing out
+	unsigned int jobs = (destination.height + MIP_ROWS_PER_JOB - 1) / MIP_ROWS_PER_JOB;
+	if (jobs <= 1)
+	{
+		DownsampleRows(source, destination, 0, destination.height);
+		return;
+	}
+
+	ThreadPool::GetInstance().ParallelFor((int)jobs, [&](int job)
+	{
+		unsigned int first = job * MIP_ROWS_PER_JOB;
+		unsigned int last = first + MIP_ROWS_PER_JOB < destination.height ? first + MIP_ROWS_PER_JOB : destination.height;
+		DownsampleRows(source, destination, first, last);
+	});
+}
+
+void MipGenerator::DownsampleReference(const MipLevel& source, MipLevel& destination)
+{
+	destination.width = source.width > 1 ? source.width / 2 : 1;
+	destination.height = source.height > 1 ? source.height / 2 : 1;
+	destination.pixels.resize((size_t)destination.width * destination.height * 4);
+
+	for (unsigned int y = 0; y < destination.height; y++)
+	{
+		unsigned int y0 = y * 2;
+		unsigned int y1 = source.height > 1 ? y0 + 1 : y0;
+		for (unsigned int x = 0; x < destination.width; x++)
+		{
+			unsigned int x0 = x * 2;
+			unsigned int x1 = source.width > 1 ? x0 + 1 : x0;
+			for (unsigned int c = 0; c < 4; c++)
+			{
+				unsigned int sum =
+					source.pixels[((size_t)y0 * source.width + x0) * 4 + c] +
+					source.pixels[((size_t)y0 * source.width + x1) * 4 + c] +
+					source.pixels[((size_t)y1 * source.width + x0) * 4 + c] +
+					source.pixels[((size_t)y1 * source.width + x1) * 4 + c];
+				destination.pixels[((size_t)y * destination.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+void MipGenerator::DownsampleRows(const MipLevel& source, MipLevel& destination, unsigned int firstRow, unsigned int lastRow)
+{
+	// A one pixel wide source has no neighbor to pair with
+	unsigned int right = source.width > 1 ? 4 : 0;
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i two = _mm_set1_epi16(2);
+
+	for (unsigned int y = firstRow; y < lastRow; y++)
+	{
+		unsigned int y0 = y * 2;
+		unsigned int y1 = source.height > 1 ? y0 + 1 : y0;
+		const unsigned char* top = &source.pixels[(size_t)y0 * source.width * 4];
+		const unsigned char* bottom = &source.pixels[(size_t)y1 * source.width * 4];
+		unsigned char* out = &destination.pixels[(size_t)y * destination.width * 4];
+
+		// Four output pixels from two rows of eight input pixels
+		unsigned int x = 0;
+		for (; x + 4 <= destination.width; x += 4)
+		{
+			__m128i result[2];
+			for (int half = 0; half < 2; half++)
+			{
+				__m128i a = _mm_loadu_si128((const __m128i*)(top + x * 8 + half * 16));
+				__m128i b = _mm_loadu_si128((const __m128i*)(bottom + x * 8 + half * 16));
+
+				// Sum the rows as 16-bit: pixels 0-1 and 2-3
+				__m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+				__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+				// Then neighboring pixels: (0 + 1), (2 + 3)
+				__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+				result[half] = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+			}
+			_mm_storeu_si128((__m128i*)(out + x * 4), _mm_packus_epi16(result[0], result[1]));
+		}
+
+		// Leftovers (and narrow levels) one at a time
+		for (; x < destination.width; x++)
+		{
+			for (unsigned int c = 0; c < 4; c++)
+			{
+				unsigned int sum = top[x * 8 + c] + top[x * 8 + right + c] + bottom[x * 8 + c] + bottom[x * 8 + right + c];
+				out[x * 4 + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+// One level of an RGBA8 image, rows tightly packed
+struct MipLevel
+{
+	unsigned int width;
+	unsigned int height;
+	std::vector<unsigned char> pixels;
+};
+
+// --------------------------------------------------------
+// Builds mip chains on the CPU
+//
+// Each level is a 2x2 box filter of the one above, rounded
+// to nearest, so the results are exact and the same on every
+// platform.  Sizes round down like D3D's mip sizes (odd rows
+// and columns drop their last one), and a level that's only
+// one pixel wide or tall averages in that one direction.
+// Rows are done four pixels at a time with SSE2, and big
+// levels are split across the ThreadPool.
+// --------------------------------------------------------
+class MipGenerator
+{
+public:
+	// Adds every level below levels[0], down to 1x1
+	static void GenerateMips(std::vector<MipLevel>& levels);
+
+	// Halves source (rounding down, minimum 1) into destination
+	static void Downsample(const MipLevel& source, MipLevel& destination);
+
+	// Plain C++ version of Downsample, for checking the fast one
+	static void DownsampleReference(const MipLevel& source, MipLevel& destination);
+
+private:
+	static void DownsampleRows(const MipLevel& source, MipLevel& destination, unsigned int firstRow, unsigned int lastRow);
+};
@@ -0,0 +1,445 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <math.h>
+#include <stdio.h>
+#include <unordered_map>
+using namespace DirectX;
+
+// One "v/vt/vn" group from a face line (1-based, 0 means missing)
+struct ObjCorner
+{
+	int position;
+	int uv;
+	int normal;
+
+	bool operator==(const ObjCorner& other) const
+	{
+		return position == other.position && uv == other.uv && normal == other.normal;
+	}
+};
+
+// Hashes a whole index triple so identical corners share one Vertex
+struct ObjCornerHash
+{
+	size_t operator()(const ObjCorner& corner) const
+	{
+		size_t hash = (size_t)(unsigned int)corner.position * 73856093u;
+		hash ^= (size_t)(unsigned int)corner.uv * 19349663u;
+		hash ^= (size_t)(unsigned int)corner.normal * 83492791u;
+		return hash;
+	}
+};
+
+static bool IsDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static const char* SkipSpaces(const char* p, const char* end)
+{
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+	return p;
+}
+
+static const char* SkipLine(const char* p, const char* end)
+{
+	while (p < end && *p != '\n')
+		p++;
+	return p < end ? p + 1 : end;
+}
+
+static bool IsEndOfLine(const char* p, const char* end)
+{
+	return p >= end || *p == '\n' || *p == '\r' || *p == '#';
+}
+
+static const char* ParseInt(const char* p, const char* end, int& out)
+{
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	int value = 0;
+	while (p < end && IsDigit(*p))
+	{
+		value = value * 10 + (*p - '0');
+		p++;
+	}
+
+	out = negative ? -value : value;
+	return p;
+}
+
+static const char* ParseFloat(const char* p, const char* end, float& out)
+{
+	static const double powersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+	p = SkipSpaces(p, end);
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	// Whole part
+	double value = 0.0;
+	while (p < end && IsDigit(*p))
+	{
+		value = value * 10.0 + (*p - '0');
+		p++;
+	}
+
+	// Fractional part, gathered as an integer and scaled once at the end
+	if (p < end && *p == '.')
+	{
+		p++;
+		double fraction = 0.0;
+		int digits = 0;
+		while (p < end && IsDigit(*p))
+		{
+			if (digits < 18)
+			{
+				fraction = fraction * 10.0 + (*p - '0');
+				digits++;
+			}
+			p++;
+		}
+		value += fraction / powersOfTen[digits];
+	}
+
+	// Optional exponent (some exporters write 1.5e-05)
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		int exponent = 0;
+		p = ParseInt(p + 1, end, exponent);
+		value *= pow(10.0, exponent);
+	}
+
+	out = (float)(negative ? -value : value);
+	return p;
+}
+
+// Reads one "v", "v/vt", "v//vn" or "v/vt/vn" group
+static const char* ParseCorner(const char* p, const char* end, ObjCorner& corner)
+{
+	corner = {};
+	p = ParseInt(p, end, corner.position);
+	if (p < end && *p == '/')
+	{
+		p++;
+		if (p < end && *p != '/')
+			p = ParseInt(p, end, corner.uv);
+		if (p < end && *p == '/')
+			p = ParseInt(p + 1, end, corner.normal);
+	}
+	return p;
+}
+
+// Everything parsed out of one newline-aligned slice of the file
+struct ObjChunk
+{
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT3> normals;
+	std::vector<XMFLOAT2> uvs;
+	std::vector<ObjCorner> corners;		// Every face's corners, back to back
+	std::vector<unsigned char> relative;	// Per corner: which indices (1 = v, 2 = vt, 4 = vn) are chunk-relative
+	std::vector<int> faceSizes;		// Number of corners in each face
+};
+
+// Files smaller than this aren't worth splitting up
+static const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+// Resolves a negative (relative) OBJ index against the number of
+// elements this chunk has seen so far.  The result is still local
+// to the chunk, so it is flagged to be offset during the merge.
+static void ResolveRelative(int& index, int localCount, unsigned char bit, unsigned char& relative)
+{
+	if (index < 0)
+	{
+		index = localCount + index + 1;
+		relative |= bit;
+	}
+}
+
+static void ParseChunk(const char* p, const char* end, ObjChunk& chunk)
+{
+	// Rough guess at the final sizes so the vectors don't regrow constantly
+	size_t estimatedLines = (end - p) / 32;
+	chunk.positions.reserve(estimatedLines / 2);
+	chunk.corners.reserve(estimatedLines);
+	chunk.relative.reserve(estimatedLines);
+	chunk.faceSizes.reserve(estimatedLines / 2);
+
+	while (p < end)
+	{
+		p = SkipSpaces(p, end);
+		if (p + 1 >= end)
+			break;
+
+		// Check the type of line
+		if (p[0] == 'v' && p[1] == 'n')
+		{
+			XMFLOAT3 norm;
+			p = ParseFloat(p + 2, end, norm.x);
+			p = ParseFloat(p, end, norm.y);
+			p = ParseFloat(p, end, norm.z);
+			chunk.normals.push_back(norm);
+		}
+		else if (p[0] == 'v' && p[1] == 't')
+		{
+			XMFLOAT2 uv;
+			p = ParseFloat(p + 2, end, uv.x);
+			p = ParseFloat(p, end, uv.y);
+			chunk.uvs.push_back(uv);
+		}
+		else if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			XMFLOAT3 pos;
+			p = ParseFloat(p + 1, end, pos.x);
+			p = ParseFloat(p, end, pos.y);
+			p = ParseFloat(p, end, pos.z);
+			chunk.positions.push_back(pos);
+		}
+		else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			// Read every corner - faces can have any number of them,
+			// and each corner can be v, v/vt, v//vn or v/vt/vn
+			int cornerCount = 0;
+			p++;
+			while (true)
+			{
+				p = SkipSpaces(p, end);
+				if (IsEndOfLine(p, end))
+					break;
+
+				ObjCorner corner;
+				const char* next = ParseCorner(p, end, corner);
+				if (next == p)
+					break; // not a number, ignore the rest of the line
+				p = next;
+
+				unsigned char relative = 0;
+				ResolveRelative(corner.position, (int)chunk.positions.size(), 1, relative);
+				ResolveRelative(corner.uv, (int)chunk.uvs.size(), 2, relative);
+				ResolveRelative(corner.normal, (int)chunk.normals.size(), 4, relative);
+				chunk.corners.push_back(corner);
+				chunk.relative.push_back(relative);
+				cornerCount++;
+			}
+
+			if (cornerCount > 0)
+				chunk.faceSizes.push_back(cornerCount);
+		}
+
+		p = SkipLine(p, end);
+	}
+}
+
+// --------------------------------------------------------
+// Author: Chris Cascioli (original getline/sscanf_s version)
+// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
+//
+// - Faces may be n-gons (fan triangulated), use negative indices
+//   and leave out uvs and/or normals (flat normals are generated)
+// - Rewritten to walk a memory mapped copy of the file with
+//   hand written number parsing instead of sscanf_s
+// - Large files are split at line breaks and each slice is
+//   parsed on its own thread, then the results are stitched
+//   back together in file order
+// --------------------------------------------------------
+bool ObjLoader::Load(const char* file, MeshData& meshData, ObjLoadStats* stats)
+{
+	MappedFile obj(file);
+
+	// Check for successful open
+	if (!obj.IsOpen())
+		return false;
+
+	const char* data = obj.GetData();
+	const char* end = data + obj.GetSize();
+
+	// Split into roughly equal chunks, each ending just after a newline
+	int chunkCount = (int)(obj.GetSize() / MIN_CHUNK_SIZE);
+	int threadCount = ThreadPool::GetInstance().GetThreadCount();
+	if (chunkCount > threadCount)
+		chunkCount = threadCount;
+	if (chunkCount < 1)
+		chunkCount = 1;
+
+	std::vector<const char*> chunkStarts;
+	chunkStarts.push_back(data);
+	for (int i = 1; i < chunkCount; i++)
+	{
+		const char* split = data + obj.GetSize() * i / chunkCount;
+		if (split < chunkStarts.back())
+			split = chunkStarts.back();
+		chunkStarts.push_back(SkipLine(split, end));
+	}
+	chunkStarts.push_back(end);
+
+	std::vector<ObjChunk> chunks(chunkCount);
+	ThreadPool::GetInstance().ParallelFor(chunkCount, [&](int i)
+	{
+		ParseChunk(chunkStarts[i], chunkStarts[i + 1], chunks[i]);
+	});
+
+	// Stitch the attribute arrays back together, remembering where
+	// each chunk's elements start so relative indices can be fixed up
+	std::vector<XMFLOAT3> positions;	// Positions from the file
+	std::vector<XMFLOAT3> normals;		// Normals from the file
+	std::vector<XMFLOAT2> uvs;		// UVs from the file
+	std::vector<ObjCorner> chunkBases(chunkCount);
+	size_t cornerTotal = 0;
+	for (int i = 0; i < chunkCount; i++)
+	{
+		chunkBases[i] = { (int)positions.size(), (int)uvs.size(), (int)normals.size() };
+		positions.insert(positions.end(), chunks[i].positions.begin(), chunks[i].positions.end());
+		uvs.insert(uvs.end(), chunks[i].uvs.begin(), chunks[i].uvs.end());
+		normals.insert(normals.end(), chunks[i].normals.begin(), chunks[i].normals.end());
+		cornerTotal += chunks[i].corners.size();
+	}
+
+	std::vector<Vertex>& verts = meshData.vertices;	// Verts we're assembling
+	std::vector<int>& indices = meshData.indices;	// Indices of these verts
+	std::unordered_map<ObjCorner, int, ObjCornerHash> vertexLookup; // Corner -> index into verts
+	verts.reserve(cornerTotal / 2);
+	indices.reserve(cornerTotal * 3 / 2);
+	vertexLookup.reserve(cornerTotal / 2);
+
+	std::vector<ObjCorner> faceCorners;	// The current face's corners, fully resolved
+	std::vector<int> faceIndices;		// The current face's vertex indices
+	int fileNormalCount = (int)normals.size(); // Generated flat normals go after these
+	int skippedFaces = 0;
+	for (int i = 0; i < chunkCount; i++)
+	{
+		ObjChunk& chunk = chunks[i];
+		size_t firstCorner = 0;
+		for (int cornerCount : chunk.faceSizes)
+		{
+			// Resolve every corner to global 1-based indices, dropping
+			// anything that points outside the arrays
+			faceCorners.clear();
+			bool validFace = true;
+			bool needsFlatNormal = false;
+			for (int c = 0; c < cornerCount; c++)
+			{
+				ObjCorner corner = chunk.corners[firstCorner + c];
+				unsigned char relative = chunk.relative[firstCorner + c];
+				if (relative & 1) corner.position += chunkBases[i].position;
+				if (relative & 2) corner.uv += chunkBases[i].uv;
+				if (relative & 4) corner.normal += chunkBases[i].normal;
+
+				if (corner.position < 1 || corner.position > (int)positions.size())
+					validFace = false;
+				if (corner.uv < 1 || corner.uv > (int)uvs.size())
+					corner.uv = 0;
+				if (corner.normal < 1 || corner.normal > fileNormalCount)
+				{
+					corner.normal = 0;
+					needsFlatNormal = true;
+				}
+				faceCorners.push_back(corner);
+			}
+			firstCorner += cornerCount;
+
+			if (!validFace || cornerCount < 3)
+			{
+				skippedFaces++;
+				continue;
+			}
+
+			// No normals given, so make one for the whole face (Newell's
+			// method, which copes with non-planar n-gons).  It's added to
+			// the normal list so the face's corners can still share verts.
+			if (needsFlatNormal)
+			{
+				XMVECTOR faceNormal = XMVectorZero();
+				for (int c = 0; c < cornerCount; c++)
+				{
+					XMVECTOR current = XMLoadFloat3(&positions[faceCorners[c].position - 1]);
+					XMVECTOR next = XMLoadFloat3(&positions[faceCorners[(c + 1) % cornerCount].position - 1]);
+					faceNormal += XMVector3Cross(current, next);
+				}
+
+				XMFLOAT3 flatNormal;
+				XMStoreFloat3(&flatNormal, XMVector3Normalize(faceNormal));
+				normals.push_back(flatNormal);
+				for (ObjCorner& corner : faceCorners)
+				{
+					if (corner.normal == 0)
+						corner.normal = (int)normals.size();
+				}
+			}
+
+			// Look up (or create) one shared vertex per unique corner
+			faceIndices.clear();
+			for (ObjCorner& corner : faceCorners)
+			{
+				auto found = vertexLookup.find(corner);
+				if (found != vertexLookup.end())
+				{
+					faceIndices.push_back(found->second);
+					continue;
+				}
+
+				// - Create the vert by looking up
+				//    corresponding data from vectors
+				// - OBJ File indices are 1-based, so
+				//    they need to be adusted
+				Vertex v;
+				v.Position = positions[corner.position - 1];
+				v.UV = corner.uv > 0 ? uvs[corner.uv - 1] : XMFLOAT2(0, 0);
+				v.Normal = normals[corner.normal - 1];
+				v.Tangent = XMFLOAT3(0, 0, 0);
+
+				// The model is most likely in a right-handed space,
+				// especially if it came from Maya.  We want to convert
+				// to a left-handed space for DirectX.  This means we
+				// need to:
+				//  - Invert the Z position
+				//  - Invert the normal's Z
+				//  - Flip the winding order (done below)
+				// We also need to flip the UV coordinate since DirectX
+				// defines (0,0) as the top left of the texture, and many
+				// 3D modeling packages use the bottom left as (0,0)
+				v.UV.y = 1.0f - v.UV.y;
+				v.Position.z *= -1.0f;
+				v.Normal.z *= -1.0f;
+
+				faceIndices.push_back((int)verts.size());
+				vertexLookup.insert({ corner, (int)verts.size() });
+				verts.push_back(v);
+			}
+
+			// Fan out whole triangles (flipping the winding order)
+			for (int c = 2; c < cornerCount; c++)
+			{
+				indices.push_back(faceIndices[0]);
+				indices.push_back(faceIndices[c]);
+				indices.push_back(faceIndices[c - 1]);
+			}
+		}
+	}
+
+#if defined(DEBUG) || defined(_DEBUG)
+	if (skippedFaces > 0)
+		printf("%s: skipped %d faces with missing or out of range positions\n", file, skippedFaces);
+#endif
+
+	if (stats)
+	{
+		stats->unsharedVertices = indices.size();
+		stats->sharedVertices = verts.size();
+		stats->chunkCount = chunkCount;
+		stats->skippedFaces = skippedFaces;
+	}
+
+	return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Vertex.h"
+#include <vector>
+
+// --------------------------------------------------------
+// CPU-side geometry, ready to be handed to Mesh::CreateBuffers
+// --------------------------------------------------------
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<int> indices;
+
+	// Index count of each level of detail, stored one after another
+	// in indices (see MeshSimplifier).  Empty means just the one.
+	std::vector<int> lodIndexCounts;
+};
+
+// --------------------------------------------------------
+// What ObjLoader::Load found, for working out how much the
+// shared vertices save (each Vertex is sizeof(Vertex) bytes)
+// --------------------------------------------------------
+struct ObjLoadStats
+{
+	size_t unsharedVertices;	// One per triangle corner, like the old loader made
+	size_t sharedVertices;		// What's actually in MeshData::vertices
+	int chunkCount;			// Slices of the file parsed in parallel
+	int skippedFaces;		// Missing or out of range positions
+};
+
+// --------------------------------------------------------
+// Loads Wavefront .OBJ files (positions, uvs and normals)
+//
+// The whole file is memory mapped and tokenized in place in
+// a single pass, so there is no per-line copying and no limit
+// on line length.  Corners with the same position/uv/normal
+// indices share a single Vertex, so the index list is real.
+// --------------------------------------------------------
+class ObjLoader
+{
+public:
+	// Returns false if the file could not be opened.  stats, if
+	// given, is filled in on success.
+	static bool Load(const char* file, MeshData& meshData, ObjLoadStats* stats = nullptr);
+};
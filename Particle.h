@@ -2,16 +2,19 @@
 
 #include <DirectXMath.h>
 
-struct Particle
+struct ParticleVertex
 {
 	DirectX::XMFLOAT3 Position;
-	DirectX::XMFLOAT3 StartVelocity;
-	float Age;
+	DirectX::XMFLOAT2 UV;
+	DirectX::XMFLOAT4 Color;
 };
 
-struct ParticleVertex
+// One particle for the vertex shader to build a quad around
+// - must match ParticleRecord in ShaderIncludes.hlsli
+struct ParticleRecord
 {
 	DirectX::XMFLOAT3 Position;
-	DirectX::XMFLOAT2 UV;
-	DirectX::XMFLOAT4 Color;
+	float Age;
+	float Size;
+	unsigned int Color; // RGBA, 8 bits each with red lowest
 };
\ No newline at end of file
@@ -1,21 +1,15 @@
 #include "ParticleManager.h"
+#include "ThreadPool.h"
 
 
 ParticleManager::ParticleManager(Microsoft::WRL::ComPtr<ID3D11Device> device, XMFLOAT3 startPos)
 {
 	particlesStartPos = startPos;
+	uploadedBytes = 0;
 	emitterTransform.SetPosition(particlesStartPos.x, particlesStartPos.y, particlesStartPos.z);
 	
-	//create c++ data structure of particle structs
-	particles = new Particle[particleNum];
-	//assign random velocities
-	for (int i = 0; i < particleNum; i++) {
-		XMFLOAT3 newStartVelocity = XMFLOAT3(0, 0, 0);
-		newStartVelocity.x += (((float)rand() / RAND_MAX) * 2 - 1) * velocityRange;
-		newStartVelocity.y += (((float)rand() / RAND_MAX) * 2 - 1) * velocityRange;
-		newStartVelocity.z += (((float)rand() / RAND_MAX) * 2 - 1) * velocityRange;
-		particles[i] = { particlesStartPos, newStartVelocity, 0 };
-	}
+	//particles are spawned into the pool as time goes on
+	particles = new ParticlePool(particleNum);
 
 	//default uv array are used to create vertex buffers with c++ data structure
 	DefaultUVs[0] = XMFLOAT2(0, 0);
@@ -39,6 +33,24 @@ ParticleManager::ParticleManager(Microsoft::WRL::ComPtr<ID3D11Device> device, XM
 	vbDesc.ByteWidth = sizeof(ParticleVertex) * 4 * particleNum;
 	device->CreateBuffer(&vbDesc, 0, particleVertexBuffer.GetAddressOf());
 
+	// Or one record per particle, which the vertex shader reads by SV_VertexID
+	particleRecords = new ParticleRecord[particleNum];
+	D3D11_BUFFER_DESC recordDesc = {};
+	recordDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	recordDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	recordDesc.Usage = D3D11_USAGE_DYNAMIC;
+	recordDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	recordDesc.StructureByteStride = sizeof(ParticleRecord);
+	recordDesc.ByteWidth = sizeof(ParticleRecord) * particleNum;
+	device->CreateBuffer(&recordDesc, 0, particleRecordBuffer.GetAddressOf());
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = particleNum;
+	device->CreateShaderResourceView(particleRecordBuffer.Get(), &srvDesc, particleRecordSRV.GetAddressOf());
+
 	// Index buffer data
 	unsigned int* indices = new unsigned int[particleNum * 6];
 	int indexCount = 0;
@@ -66,100 +78,91 @@ ParticleManager::ParticleManager(Microsoft::WRL::ComPtr<ID3D11Device> device, XM
 
 ParticleManager::~ParticleManager()
 {
-	delete[] particles;
+	delete particles;
 	delete[] particleVertices;
+	delete[] particleRecords;
 }
 
-void ParticleManager::UpdateSingleParticle(float dt, int index)
+void ParticleManager::CopyParticlesToGPU(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Camera* camera)
 {
-	// Check for valid particle age before doing anything
-	if (particles[index].Age >= lifeSpan)
-		return;
-
-	// Update and check for death
-	particles[index].Age += dt;
-	if (particles[index].Age >= lifeSpan)
+	// Each chunk of live particles fills in its own slice of the records or vertices
+	std::vector<int> start;
+	std::vector<int> count;
+	int chunks = particles->GetLiveChunks(PARTICLE_CHUNK_SIZE, start, count);
+	if (expandOnGPU)
 	{
-		// Recent death, so retire by moving alive count
-		firstLiveParticle++;
-		firstLiveParticle %= particleNum;
-		livingParticleNum--;
+		unsigned int color = ParticlePool::PackColor(particleColor);
+		ThreadPool::GetInstance().ParallelFor(chunks, [this, &start, &count, color](int chunk)
+		{
+			particles->WriteRecords(start[chunk], count[chunk], particleSize, color, particleRecords);
+		}, FramePriority);
+
+		uploadedBytes = UploadLiveRuns(context, particleRecordBuffer.Get(), particleRecords, sizeof(ParticleRecord));
 		return;
 	}
 
-	// Adjust the position
-	XMVECTOR startPos = XMLoadFloat3(&particles[index].Position);
-	XMVECTOR startVel = XMLoadFloat3(&particles[index].StartVelocity);
-
-	float t = particles[index].Age;
+	// The camera's right and up vectors, read out of the view matrix once
+	// for every corner, already scaled to the particle size
+	XMFLOAT4X4 view = camera->GetView();
+	XMFLOAT3 camRight(view._11 * particleSize, view._21 * particleSize, view._31 * particleSize);
+	XMFLOAT3 camUp(view._12 * particleSize, view._22 * particleSize, view._32 * particleSize);
+	ThreadPool::GetInstance().ParallelFor(chunks, [this, &start, &count, camRight, camUp](int chunk)
+	{
+		XMVECTOR right = XMLoadFloat3(&camRight);
+		XMVECTOR up = XMLoadFloat3(&camUp);
+		for (int i = start[chunk]; i < start[chunk] + count[chunk]; i++)
+			CopyOneParticle(i, right, up);
+	}, FramePriority);
 
-	// Use constant acceleration function
-	XMStoreFloat3(&particles[index].Position, startVel * t + startPos);
+	uploadedBytes = UploadLiveRuns(context, particleVertexBuffer.Get(), particleVertices, sizeof(ParticleVertex) * 4);
 }
 
-void ParticleManager::CopyParticlesToGPU(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Camera* camera)
+unsigned int ParticleManager::UploadLiveRuns(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ID3D11Buffer* buffer, const void* source, unsigned int particleBytes)
 {
-	if (firstLiveParticle < firstDeadParticle)
+	int start[2];
+	int count[2];
+	int runs = particles->GetLiveRuns(start, count);
+	if (runs == 0)
+		return 0; // Nothing gets drawn, so the buffer can keep whatever it had
+
+	// Each live run goes to the same spot in the buffer it has in the ring, so the
+	// draws don't change.  Everything else is left as the discard finds it - the
+	// draws never reach the dead particles.
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	unsigned int bytes = 0;
+	for (int run = 0; run < runs; run++)
 	{
-		for (int i = firstLiveParticle; i < firstDeadParticle; i++)
-			CopyOneParticle(i, camera);
+		size_t offset = (size_t)start[run] * particleBytes;
+		size_t size = (size_t)count[run] * particleBytes;
+		memcpy((char*)mapped.pData + offset, (const char*)source + offset, size);
+		bytes += (unsigned int)size;
 	}
-	else
-	{
-		// Update first half (from firstAlive to max particles)
-		for (int i = firstLiveParticle; i < particleNum; i++)
-			CopyOneParticle(i, camera);
-
-		// Update second half (from 0 to first dead)
-		for (int i = 0; i < firstDeadParticle; i++)
-			CopyOneParticle(i, camera);
-	}
-
-	D3D11_MAPPED_SUBRESOURCE mapped = {};
-	context->Map(particleVertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	context->Unmap(buffer, 0);
+	return bytes;
+}
 
-	memcpy(mapped.pData, particleVertices, sizeof(ParticleVertex) * 4 * particleNum);
-	context->Unmap(particleVertexBuffer.Get(), 0);
+unsigned int ParticleManager::GetUploadedBytes()
+{
+	return uploadedBytes;
 }
 
 void ParticleManager::SpawnParticles()
 {
-	if (livingParticleNum == particleNum)
+	if (particles->GetLivingCount() == particleNum)
 		return;
 
-	particles[firstDeadParticle].Age = 0;
-	particles[firstDeadParticle].Position = particlesStartPos;
 	//generate new velocity
 	XMFLOAT3 newStartVelocity = XMFLOAT3(0, 0, 0);
 	newStartVelocity.x += (((float)rand() / RAND_MAX) * 2 - 1) * velocityRange;
 	newStartVelocity.y += (((float)rand() / RAND_MAX) * 2 - 1) * velocityRange;
 	newStartVelocity.z += (((float)rand() / RAND_MAX) * 2 - 1) * velocityRange;
-	particles[firstDeadParticle].StartVelocity = newStartVelocity;
-
-	firstDeadParticle++;
-	firstDeadParticle %= particleNum;
-
-	livingParticleNum++;
+	particles->Spawn(particlesStartPos, newStartVelocity);
 }
 
 void ParticleManager::UpdateParticles(float dt)
 {
-	if (firstLiveParticle < firstDeadParticle)
-	{
-		for (int i = firstLiveParticle; i < firstDeadParticle; i++) {
-			UpdateSingleParticle(dt, i);
-		}
-	}
-	else {
-		for (int i = firstLiveParticle; i < particleNum; i++) {
-			UpdateSingleParticle(dt, i);
-		}
-
-		// Update second half (from 0 to first dead)
-		for (int i = 0; i < firstDeadParticle; i++) {
-			UpdateSingleParticle(dt, i);
-		}
-	}
+	particles->Update(dt, lifeSpan);
 	timeSinceEmit += dt;
 
 	// Enough time to emit?
@@ -170,11 +173,23 @@ void ParticleManager::UpdateParticles(float dt)
 	}
 }
 
-void ParticleManager::DrawParticlesInternal(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Camera* camera, SimplePixelShader* ps, SimpleVertexShader* vs)
+void ParticleManager::DrawParticlesInternal(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Camera* camera, SimplePixelShader* ps, SimpleVertexShader* vs, SimpleVertexShader* cpuVS)
 {
+	// The same index buffer works both ways - its indices are
+	// particle * 4 + corner, which is what SV_VertexID gets too
 	UINT stride = sizeof(ParticleVertex);
 	UINT offset = 0;
-	context->IASetVertexBuffers(0, 1, particleVertexBuffer.GetAddressOf(), &stride, &offset);
+	if (expandOnGPU)
+	{
+		ID3D11Buffer* noBuffer = 0;
+		context->IASetVertexBuffers(0, 1, &noBuffer, &stride, &offset);
+		vs->SetShaderResourceView("Particles", particleRecordSRV);
+	}
+	else
+	{
+		context->IASetVertexBuffers(0, 1, particleVertexBuffer.GetAddressOf(), &stride, &offset);
+		vs = cpuVS;
+	}
 	context->IASetIndexBuffer(particleIndexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
 	vs->SetShader();
 	ps->SetShader();
@@ -183,28 +198,23 @@ void ParticleManager::DrawParticlesInternal(Microsoft::WRL::ComPtr<ID3D11DeviceC
 	vs->SetMatrix4x4("projection", camera->GetProjection());
 	vs->CopyAllBufferData();
 
-	if (firstLiveParticle < firstDeadParticle)
+	int start[2];
+	int count[2];
+	int runs = particles->GetLiveRuns(start, count);
+	for (int run = 0; run < runs; run++)
 	{
-		context->DrawIndexed(livingParticleNum * 6, firstLiveParticle * 6, 0);
-	}
-	else
-	{
-		// Draw first half (0 -> dead)
-		context->DrawIndexed(firstDeadParticle * 6, 0, 0);
-
-		// Draw second half (alive -> max)
-		context->DrawIndexed((particleNum - firstLiveParticle) * 6, firstLiveParticle * 6, 0);
+		context->DrawIndexed(count[run] * 6, start[run] * 6, 0);
 	}
 }
 
-void ParticleManager::CopyOneParticle(int index, Camera* camera)
+void ParticleManager::CopyOneParticle(int index, FXMVECTOR camRight, FXMVECTOR camUp)
 {
 	int i = index * 4;
 
-	particleVertices[i + 0].Position = CalcParticleVertexPos(index, 0, camera);
-	particleVertices[i + 1].Position = CalcParticleVertexPos(index, 1, camera);
-	particleVertices[i + 2].Position = CalcParticleVertexPos(index, 2, camera);
-	particleVertices[i + 3].Position = CalcParticleVertexPos(index, 3, camera);
+	particleVertices[i + 0].Position = CalcParticleVertexPos(index, 0, camRight, camUp);
+	particleVertices[i + 1].Position = CalcParticleVertexPos(index, 1, camRight, camUp);
+	particleVertices[i + 2].Position = CalcParticleVertexPos(index, 2, camRight, camUp);
+	particleVertices[i + 3].Position = CalcParticleVertexPos(index, 3, camRight, camUp);
 
 	particleVertices[i + 0].Color = particleColor;
 	particleVertices[i + 1].Color = particleColor;
@@ -213,13 +223,9 @@ void ParticleManager::CopyOneParticle(int index, Camera* camera)
 }
 
 
-XMFLOAT3 ParticleManager::CalcParticleVertexPos(int particleIndex, int quadCornerIndex, Camera* camera)
+// camRight and camUp come from the view matrix, scaled by the particle size
+XMFLOAT3 ParticleManager::CalcParticleVertexPos(int particleIndex, int quadCornerIndex, FXMVECTOR camRight, FXMVECTOR camUp)
 {
-	// Get the right and up vectors out of the view matrix
-	XMFLOAT4X4 view = camera->GetView();
-	XMVECTOR camRight = XMVectorSet(view._11, view._21, view._31, 0);
-	XMVECTOR camUp = XMVectorSet(view._12, view._22, view._32, 0);
-
 	// Determine the offset of this corner of the quad
 	// Since the UV's are already set when the emitter is created, 
 	// we can alter that data to determine the general offset of this corner
@@ -227,16 +233,10 @@ XMFLOAT3 ParticleManager::CalcParticleVertexPos(int particleIndex, int quadCorne
 	offset.x = offset.x * 2 - 1;	// Convert from [0,1] to [-1,1]
 	offset.y = (offset.y * -2 + 1);	// Same, but flip the Y
 
-	// Load into a vector, which we'll assume is float3 with a Z of 0
-	// Create a Z rotation matrix and apply it to the offset
-	XMVECTOR offsetVec = XMLoadFloat2(&offset);
-	XMMATRIX rotMatrix = XMMatrixRotationZ(0);
-	offsetVec = XMVector3Transform(offsetVec, rotMatrix);
-
-	// Add and scale the camera up/right vectors to the position as necessary
-	XMVECTOR posVec = XMLoadFloat3(&particles[particleIndex].Position);
-	posVec += camRight * XMVectorGetX(offsetVec) * particleSize;
-	posVec += camUp * XMVectorGetY(offsetVec) * particleSize;
+	// Add the camera up/right vectors to the position as necessary
+	XMVECTOR posVec = XMVectorSet(particles->positionX[particleIndex], particles->positionY[particleIndex], particles->positionZ[particleIndex], 0);
+	posVec += camRight * offset.x;
+	posVec += camUp * offset.y;
 
 	// This position is all set
 	XMFLOAT3 pos;
@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <optional>
 #include "Particle.h"
+#include "ParticlePool.h"
 #include "Material.h"
 
 class ParticleManager
@@ -18,13 +19,14 @@ public:
 	~ParticleManager();
 	Microsoft::WRL::ComPtr<ID3D11Buffer> particleVertexBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> particleIndexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> particleRecordBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> particleRecordSRV;
 	void UpdateParticles(float dt);
-	void DrawParticlesInternal(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Camera* camera, SimplePixelShader* ps, SimpleVertexShader* vs);
+	// vs builds the quads from particle records, cpuVS just draws the vertices made here
+	void DrawParticlesInternal(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Camera* camera, SimplePixelShader* ps, SimpleVertexShader* vs, SimpleVertexShader* cpuVS);
 	void CopyParticlesToGPU(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Camera* camera);
-	int livingParticleNum = 0;
+	unsigned int GetUploadedBytes(); // By the last CopyParticlesToGPU - just the live particles
 	float lifeSpan = 3;
-	int firstDeadParticle = 0;
-	int firstLiveParticle = 0;
 	float particleSize = 0.1;
 	float velocityRange = 1;
 	float particlesPerSecond = 10.0f;
@@ -32,16 +34,20 @@ public:
 	float timeSinceEmit = 0;
 	DirectX::XMFLOAT4 particleColor = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	int particleNum = 1000;
+	bool expandOnGPU = true; // One record per particle up to the GPU, instead of four vertices
 
 private:
 	DirectX::XMFLOAT2 DefaultUVs[4];
 	XMFLOAT3 particlesStartPos = XMFLOAT3(0.0f, 1.0f, 0.0f);
 	Transform emitterTransform;	
-	Particle* particles;
+	ParticlePool* particles;
 	ParticleVertex* particleVertices;
-	XMFLOAT3 CalcParticleVertexPos(int particleInd, int cornerInd, Camera* camera);
-	void CopyOneParticle(int index, Camera* camera);
-	void UpdateSingleParticle(float dt, int index);
+	ParticleRecord* particleRecords;
+	XMFLOAT3 CalcParticleVertexPos(int particleInd, int cornerInd, FXMVECTOR camRight, FXMVECTOR camUp);
+	void CopyOneParticle(int index, FXMVECTOR camRight, FXMVECTOR camUp);
+	// Copies the live runs of source (particleBytes per particle) into buffer, returning the bytes copied
+	unsigned int UploadLiveRuns(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ID3D11Buffer* buffer, const void* source, unsigned int particleBytes);
+	unsigned int uploadedBytes;
 	void SpawnParticles();
 	
 	
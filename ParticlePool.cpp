@@ -0,0 +1,284 @@
+#include "ParticlePool.h"
+#include "ThreadPool.h"
+#include <malloc.h>
+#include <intrin.h>
+#include <immintrin.h>
+
+ParticlePool::ParticlePool(int capacity)
+{
+	this->capacity = capacity;
+	firstLiveParticle = 0;
+	firstDeadParticle = 0;
+	livingParticleNum = 0;
+
+	// Round each array up to whole 8 float vectors, so every one starts aligned
+	size_t stride = ((size_t)capacity + 7) & ~(size_t)7;
+	storage = (float*)_aligned_malloc(sizeof(float) * stride * 7, 32);
+	positionX = storage;
+	positionY = storage + stride;
+	positionZ = storage + stride * 2;
+	velocityX = storage + stride * 3;
+	velocityY = storage + stride * 4;
+	velocityZ = storage + stride * 5;
+	age = storage + stride * 6;
+
+	for (size_t i = 0; i < stride * 7; i++)
+		storage[i] = 0.0f;
+
+	kernel = GetBestKernel();
+}
+
+ParticlePool::~ParticlePool()
+{
+	_aligned_free(storage);
+}
+
+bool ParticlePool::Spawn(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 velocity)
+{
+	if (livingParticleNum == capacity)
+		return false;
+
+	int i = firstDeadParticle;
+	positionX[i] = position.x;
+	positionY[i] = position.y;
+	positionZ[i] = position.z;
+	velocityX[i] = velocity.x;
+	velocityY[i] = velocity.y;
+	velocityZ[i] = velocity.z;
+	age[i] = 0.0f;
+
+	firstDeadParticle = (firstDeadParticle + 1) % capacity;
+	livingParticleNum++;
+	return true;
+}
+
+void ParticlePool::Update(float dt, float lifeSpan)
+{
+	std::vector<int> start;
+	std::vector<int> count;
+	int chunks = GetLiveChunks(PARTICLE_CHUNK_SIZE, start, count);
+	std::vector<int> dead(chunks, 0);
+	ThreadPool::GetInstance().ParallelFor(chunks, [this, &start, &count, &dead, dt, lifeSpan](int chunk)
+	{
+		dead[chunk] = UpdateRun(start[chunk], count[chunk], dt, lifeSpan);
+	}, FramePriority);
+
+	// Everything ages together, so whatever died is at the front of the ring
+	int totalDead = 0;
+	for (int chunk = 0; chunk < chunks; chunk++)
+		totalDead += dead[chunk];
+	firstLiveParticle = (firstLiveParticle + totalDead) % capacity;
+	livingParticleNum -= totalDead;
+}
+
+int ParticlePool::UpdateRun(int first, int count, float dt, float lifeSpan)
+{
+	switch (kernel)
+	{
+	case AVX2Kernel:
+		return UpdateRunAVX2(first, count, dt, lifeSpan);
+	case SSE4Kernel:
+		return UpdateRunSSE4(first, count, dt, lifeSpan);
+	default:
+		return UpdateRunScalar(first, count, dt, lifeSpan);
+	}
+}
+
+// Position moves by velocity times age each update (so particles
+// speed up as they get older), unless that update killed them.
+// The SIMD versions below do exactly the same math, a multiply
+// then an add (no FMA), so they give the same bits.
+int ParticlePool::UpdateRunScalar(int first, int count, float dt, float lifeSpan)
+{
+	int dead = 0;
+	for (int i = first; i < first + count; i++)
+	{
+		float t = age[i] + dt;
+		age[i] = t;
+		if (t >= lifeSpan)
+		{
+			dead++;
+			continue;
+		}
+		positionX[i] += velocityX[i] * t;
+		positionY[i] += velocityY[i] * t;
+		positionZ[i] += velocityZ[i] * t;
+	}
+	return dead;
+}
+
+// Runs start anywhere in the ring, so loads are unaligned.  The
+// leftovers at the end of a run go through the scalar version - the
+// padding past them can belong to live particles of another run.
+int ParticlePool::UpdateRunSSE4(int first, int count, float dt, float lifeSpan)
+{
+	const __m128 step = _mm_set1_ps(dt);
+	const __m128 limit = _mm_set1_ps(lifeSpan);
+	__m128i dead = _mm_setzero_si128();
+
+	int i = first;
+	int end = first + count;
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 t = _mm_add_ps(_mm_loadu_ps(age + i), step);
+		_mm_storeu_ps(age + i, t);
+
+		// Dying lanes are all ones, which is -1 as an integer
+		__m128 dying = _mm_cmpge_ps(t, limit);
+		dead = _mm_sub_epi32(dead, _mm_castps_si128(dying));
+
+		__m128 x = _mm_loadu_ps(positionX + i);
+		__m128 y = _mm_loadu_ps(positionY + i);
+		__m128 z = _mm_loadu_ps(positionZ + i);
+		_mm_storeu_ps(positionX + i, _mm_blendv_ps(_mm_add_ps(x, _mm_mul_ps(_mm_loadu_ps(velocityX + i), t)), x, dying));
+		_mm_storeu_ps(positionY + i, _mm_blendv_ps(_mm_add_ps(y, _mm_mul_ps(_mm_loadu_ps(velocityY + i), t)), y, dying));
+		_mm_storeu_ps(positionZ + i, _mm_blendv_ps(_mm_add_ps(z, _mm_mul_ps(_mm_loadu_ps(velocityZ + i), t)), z, dying));
+	}
+
+	dead = _mm_add_epi32(dead, _mm_shuffle_epi32(dead, _MM_SHUFFLE(1, 0, 3, 2)));
+	dead = _mm_add_epi32(dead, _mm_shuffle_epi32(dead, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(dead) + UpdateRunScalar(i, end - i, dt, lifeSpan);
+}
+
+int ParticlePool::UpdateRunAVX2(int first, int count, float dt, float lifeSpan)
+{
+	const __m256 step = _mm256_set1_ps(dt);
+	const __m256 limit = _mm256_set1_ps(lifeSpan);
+	__m256i dead = _mm256_setzero_si256();
+
+	int i = first;
+	int end = first + count;
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 t = _mm256_add_ps(_mm256_loadu_ps(age + i), step);
+		_mm256_storeu_ps(age + i, t);
+
+		__m256 dying = _mm256_cmp_ps(t, limit, _CMP_GE_OQ);
+		dead = _mm256_sub_epi32(dead, _mm256_castps_si256(dying));
+
+		__m256 x = _mm256_loadu_ps(positionX + i);
+		__m256 y = _mm256_loadu_ps(positionY + i);
+		__m256 z = _mm256_loadu_ps(positionZ + i);
+		_mm256_storeu_ps(positionX + i, _mm256_blendv_ps(_mm256_add_ps(x, _mm256_mul_ps(_mm256_loadu_ps(velocityX + i), t)), x, dying));
+		_mm256_storeu_ps(positionY + i, _mm256_blendv_ps(_mm256_add_ps(y, _mm256_mul_ps(_mm256_loadu_ps(velocityY + i), t)), y, dying));
+		_mm256_storeu_ps(positionZ + i, _mm256_blendv_ps(_mm256_add_ps(z, _mm256_mul_ps(_mm256_loadu_ps(velocityZ + i), t)), z, dying));
+	}
+
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(dead), _mm256_extracti128_si256(dead, 1));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	int deadCount = _mm_cvtsi128_si32(sum);
+
+	// Back to 128 bit code without the AVX to SSE switching penalty
+	_mm256_zeroupper();
+	return deadCount + UpdateRunScalar(i, end - i, dt, lifeSpan);
+}
+
+int ParticlePool::GetLiveRuns(int start[2], int count[2])
+{
+	if (livingParticleNum == 0)
+		return 0;
+
+	start[0] = firstLiveParticle;
+	if (firstLiveParticle + livingParticleNum <= capacity)
+	{
+		count[0] = livingParticleNum;
+		return 1;
+	}
+
+	// Wrapped around the end of the ring
+	count[0] = capacity - firstLiveParticle;
+	start[1] = 0;
+	count[1] = livingParticleNum - count[0];
+	return 2;
+}
+
+int ParticlePool::GetLiveChunks(int maxCount, std::vector<int>& start, std::vector<int>& count)
+{
+	start.clear();
+	count.clear();
+
+	int runStart[2];
+	int runCount[2];
+	int runs = GetLiveRuns(runStart, runCount);
+	for (int run = 0; run < runs; run++)
+	{
+		for (int i = 0; i < runCount[run]; i += maxCount)
+		{
+			start.push_back(runStart[run] + i);
+			count.push_back(runCount[run] - i < maxCount ? runCount[run] - i : maxCount);
+		}
+	}
+	return (int)start.size();
+}
+
+void ParticlePool::WriteRecords(int first, int count, float size, unsigned int color, ParticleRecord* records)
+{
+	for (int i = first; i < first + count; i++)
+	{
+		records[i].Position = DirectX::XMFLOAT3(positionX[i], positionY[i], positionZ[i]);
+		records[i].Age = age[i];
+		records[i].Size = size;
+		records[i].Color = color;
+	}
+}
+
+unsigned int ParticlePool::PackColor(DirectX::XMFLOAT4 color)
+{
+	float channels[4] = { color.x, color.y, color.z, color.w };
+	unsigned int packed = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		float c = channels[i] < 0.0f ? 0.0f : (channels[i] > 1.0f ? 1.0f : channels[i]);
+		packed |= (unsigned int)(c * 255.0f + 0.5f) << (i * 8);
+	}
+	return packed;
+}
+
+int ParticlePool::GetCapacity()
+{
+	return capacity;
+}
+
+int ParticlePool::GetLivingCount()
+{
+	return livingParticleNum;
+}
+
+ParticleKernel ParticlePool::GetBestKernel()
+{
+	int info[4];
+	__cpuid(info, 0);
+	int highestLeaf = info[0];
+
+	__cpuid(info, 1);
+	bool sse4 = (info[2] & (1 << 19)) != 0;
+
+	// AVX needs the OS to save the upper halves of the registers too
+	// (OSXSAVE, then XCR0's SSE and AVX state bits)
+	bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0
+		&& (_xgetbv(0) & 6) == 6;
+	bool avx2 = false;
+	if (avx && highestLeaf >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+
+	if (avx2)
+		return AVX2Kernel;
+	if (sse4)
+		return SSE4Kernel;
+	return ScalarKernel;
+}
+
+ParticleKernel ParticlePool::GetKernel()
+{
+	return kernel;
+}
+
+void ParticlePool::SetKernel(ParticleKernel kernel)
+{
+	// Never one the CPU can't run
+	this->kernel = kernel <= GetBestKernel() ? kernel : GetBestKernel();
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Particle.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// Versions of the update loop, one per instruction set
+enum ParticleKernel
+{
+	ScalarKernel,	// One particle at a time
+	SSE4Kernel,		// Four at a time
+	AVX2Kernel		// Eight at a time
+};
+
+// Most particles one job works through (a multiple of 8, so
+// only the last chunk of a run has leftovers past the SIMD loop)
+static const int PARTICLE_CHUNK_SIZE = 16384;
+
+// --------------------------------------------------------
+// A fixed number of particles, kept as a ring
+//
+// New particles go in at firstDeadParticle and the oldest
+// live one is at firstLiveParticle, so the live particles
+// are one run of the ring, or two when it wraps around.
+// Everything ages at the same rate, so particles die in
+// the order they were born and retiring them just moves
+// firstLiveParticle along.
+//
+// Each attribute is its own array (structure of arrays),
+// aligned and padded out to whole 32 byte vectors, so an
+// update is a straight pass over a few streams of floats.
+// That pass runs with the widest SIMD the CPU has (picked
+// through CPUID), all versions giving identical results.
+// Particles that die during it keep their last position,
+// and are counted so they can be retired in one step.
+//
+// Big pools are cut into chunks that update in parallel on
+// the ThreadPool.  Each chunk counts its own dead and the
+// counts are added up in order afterwards, so the ring ends
+// up the same however the chunks were scheduled.
+// --------------------------------------------------------
+class ParticlePool
+{
+public:
+	ParticlePool(int capacity);
+	~ParticlePool();
+
+	// False (and nothing spawns) if every particle is already alive
+	bool Spawn(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 velocity);
+
+	// Ages the live particles, moves them along, then retires any past lifeSpan
+	void Update(float dt, float lifeSpan);
+
+	// Fills in the live runs (start index, particle count) oldest
+	// first, and returns how many there are: 0, 1 or 2
+	int GetLiveRuns(int start[2], int count[2]);
+
+	// The live runs cut into chunks of at most maxCount particles, oldest
+	// first, for splitting work across threads.  Returns how many.
+	int GetLiveChunks(int maxCount, std::vector<int>& start, std::vector<int>& count);
+
+	// Packs count particles from first on into records[first] onward,
+	// for the vertex shader to expand into quads
+	void WriteRecords(int first, int count, float size, unsigned int color, ParticleRecord* records);
+
+	// A color clamped to [0, 1] as the 8 bit RGBA in a ParticleRecord
+	static unsigned int PackColor(DirectX::XMFLOAT4 color);
+
+	int GetCapacity();
+	int GetLivingCount();
+
+	// The fastest kernel this CPU runs - pools start out using it
+	static ParticleKernel GetBestKernel();
+	ParticleKernel GetKernel();
+	void SetKernel(ParticleKernel kernel); // Mostly for comparing them
+
+	// capacity long each - read only outside of the pool
+	float* positionX;
+	float* positionY;
+	float* positionZ;
+	float* velocityX;
+	float* velocityY;
+	float* velocityZ;
+	float* age;
+
+private:
+	// Each updates count particles from first on, returning how many died
+	int UpdateRun(int first, int count, float dt, float lifeSpan); // With the current kernel
+	int UpdateRunScalar(int first, int count, float dt, float lifeSpan);
+	int UpdateRunSSE4(int first, int count, float dt, float lifeSpan);
+	int UpdateRunAVX2(int first, int count, float dt, float lifeSpan);
+
+	float* storage; // All seven arrays in one allocation
+	int capacity;
+	int firstLiveParticle;
+	int firstDeadParticle;
+	int livingParticleNum;
+	ParticleKernel kernel;
+};
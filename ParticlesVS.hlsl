@@ -6,13 +6,34 @@ cbuffer ExternalData : register(b0)
 	matrix projection;
 }
 
+// One record per particle - each gets four vertices, so
+// vertex id is particle * 4 + corner
+StructuredBuffer<ParticleRecord> Particles : register(t0);
 
-ParticlePSInput main(ParticleVSInput input)
+ParticlePSInput main(uint id : SV_VertexID)
 {
+	ParticleRecord particle = Particles[id / 4];
+
+	// Corners go (0,0) (1,0) (1,1) (0,1) around the quad
+	uint corner = id % 4;
+	float2 uv = float2(corner == 1 || corner == 2, corner >= 2);
+
+	// Same offset as the CPU version - UV from [0,1] to [-1,1], Y flipped
+	float2 offset = float2(uv.x * 2 - 1, uv.y * -2 + 1);
+
+	// The camera's right and up vectors are the first two rows of the view matrix here
+	float3 localPosition = particle.position;
+	localPosition += view[0].xyz * offset.x * particle.size;
+	localPosition += view[1].xyz * offset.y * particle.size;
+
 	ParticlePSInput output;
 	matrix wvp = mul(projection, mul(view, world));
-	output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
-	output.uv = input.uv;
-	output.color = input.color;
+	output.screenPosition = mul(wvp, float4(localPosition, 1.0f));
+	output.uv = uv;
+	output.color = float4(
+		particle.color & 0xFF,
+		(particle.color >> 8) & 0xFF,
+		(particle.color >> 16) & 0xFF,
+		particle.color >> 24) / 255.0f;
 	return output;
-}
\ No newline at end of file
+}
@@ -2,9 +2,9 @@
 
 Texture2D Albedo		 :  register(t0); 
 Texture2D NormalMap		 :  register(t1); 
-Texture2D RoughnessMap   :  register(t2); 
-Texture2D MetalnessMap   :  register(t3);
-Texture2D ShadowMap		 :  register(t4);
+Texture2D SurfaceMap	 :  register(t2); // roughness, metalness
+Texture2D ShadowMap		 :  register(t3);
+Texture2D OcclusionMap	 :  register(t4); // ambient occlusion, white = open
 SamplerState BasicSamplerState : register(s0); // "s" registers for samplers
 SamplerComparisonState ShadowSampler	: register(s1); // special sampler for shadows
 
@@ -21,19 +21,22 @@ cbuffer ExternalData : register(b0)
 
 	// Material related
 	float3 colorTint;
-	float2 uvScale;
-	float2 uvOffset;
+	float2 uvScale; // where the entity's image is, when its
+	float2 uvOffset; // material's textures are an atlas
+	float2 textureUVScale; // the images' share of their (padded) textures
 
 	float transparency; // for dithering
+	int hasOcclusionMap; // only then is OcclusionMap bound
 }
 
 float4 main(VertexToPixel input) : SV_TARGET
 {
 	input.normal = normalize(input.normal);
 	input.tangent = normalize(input.tangent);
+	float2 uv = (input.uv * uvScale + uvOffset) * textureUVScale;
 
 	//unpack normal
-	float3 unpackedNormal = NormalMap.Sample(BasicSamplerState, input.uv).rgb * 2 - 1;
+	float3 unpackedNormal = UnpackNormalMap(NormalMap.Sample(BasicSamplerState, uv).rg);
 	//form 3x3 rotation matrix
 	float3 N = normalize(input.normal);  
 	float3 T = normalize(input.tangent); 
@@ -47,15 +50,22 @@ float4 main(VertexToPixel input) : SV_TARGET
 	float3 totalLight = 0.0f;
 	
 	//surface color
-	float3 surfaceColor = pow( Albedo.Sample(BasicSamplerState, input.uv).rgb,2.2f);
+	float3 surfaceColor = pow( Albedo.Sample(BasicSamplerState, uv).rgb,2.2f);
 	surfaceColor *= colorTint;
-	float3 ambientTerm = ambientColor * surfaceColor;
 
-	//roughness map
-	float roughness = RoughnessMap.Sample(BasicSamplerState, input.uv).r;
-
-	//metalness map
-	float metalness = MetalnessMap.Sample(BasicSamplerState, input.uv).r;
+	//roughness and metalness share one map
+	float2 surface = SurfaceMap.Sample(BasicSamplerState, uv).rg;
+	float roughness = surface.r;
+	float metalness = surface.g;
+	// only materials with an AO map pay for the fetch (the gradients
+	// come from outside the branch, so it can really be skipped)
+	float occlusion = 1.0f;
+	float2 uvDx = ddx(uv);
+	float2 uvDy = ddy(uv);
+	[branch] if (hasOcclusionMap) {
+		occlusion = OcclusionMap.SampleGrad(BasicSamplerState, uv, uvDx, uvDy).r;
+	}
+	float3 ambientTerm = ambientColor * surfaceColor * occlusion;
 
 	//specular
 	float3 specularColor = lerp(F0_NON_METAL.rrr, surfaceColor.rgb, metalness);
@@ -0,0 +1,238 @@
+#include "ResidencyManager.h"
+#include <algorithm>
+#include <climits>
+#include <deque>
+
+ResidencyManager::ResidencyManager(unsigned long long budgetBytes, int prefetchDistance)
+{
+	budget = budgetBytes;
+	residentBytes = 0;
+	peakResidentBytes = 0;
+	this->prefetchDistance = prefetchDistance;
+	currentRoom = -1;
+	rebalanceCount = 0;
+	dirty = true;
+}
+
+int ResidencyManager::AddAsset(std::function<void(int)> load, std::function<void()> unload)
+{
+	Asset asset = {};
+	asset.load = load;
+	asset.unload = unload;
+	asset.state = Unloaded;
+	assets.push_back(asset);
+	dirty = true;
+	return (int)assets.size() - 1;
+}
+
+void ResidencyManager::AddRoomAsset(int room, int asset)
+{
+	EnsureRoom(room);
+	roomAssets[room].push_back(asset);
+	dirty = true;
+}
+
+void ResidencyManager::ConnectRooms(int a, int b)
+{
+	EnsureRoom(a > b ? a : b);
+	neighbors[a].push_back(b);
+	neighbors[b].push_back(a);
+	dirty = true;
+}
+
+void ResidencyManager::Update(int currentRoom)
+{
+	if (currentRoom != this->currentRoom)
+	{
+		this->currentRoom = currentRoom;
+		dirty = true;
+	}
+
+	if (dirty)
+		Rebalance();
+}
+
+void ResidencyManager::AssetLoaded(int asset, unsigned long long bytes)
+{
+	Asset& a = assets[asset];
+
+	// Cancelled by Evict() while it was still loading
+	if (a.state == Unloaded)
+	{
+		a.unload();
+		return;
+	}
+
+	if (a.state == Resident)
+		residentBytes -= a.bytes;
+	a.state = Resident;
+	a.bytes = bytes;
+	residentBytes += bytes;
+	if (residentBytes > peakResidentBytes)
+		peakResidentBytes = residentBytes;
+
+	if (residentBytes > budget)
+		Evict();
+}
+
+void ResidencyManager::SetBudget(unsigned long long budgetBytes)
+{
+	budget = budgetBytes;
+	dirty = true;
+}
+
+unsigned long long ResidencyManager::GetBudget()
+{
+	return budget;
+}
+
+unsigned long long ResidencyManager::GetResidentBytes()
+{
+	return residentBytes;
+}
+
+unsigned long long ResidencyManager::GetPeakResidentBytes()
+{
+	return peakResidentBytes;
+}
+
+int ResidencyManager::GetResidentCount()
+{
+	int count = 0;
+	for (Asset& a : assets)
+	{
+		count += a.state == Resident ? 1 : 0;
+	}
+	return count;
+}
+
+int ResidencyManager::GetLoadingCount()
+{
+	int count = 0;
+	for (Asset& a : assets)
+	{
+		count += a.state == Loading ? 1 : 0;
+	}
+	return count;
+}
+
+// Loads what's close, then trims what's far if over budget
+void ResidencyManager::Rebalance()
+{
+	dirty = false;
+	rebalanceCount++;
+
+	// How many doors away each room is
+	std::vector<int> roomDistance(roomAssets.size(), INT_MAX);
+	if (currentRoom >= 0 && currentRoom < (int)roomAssets.size())
+	{
+		std::deque<int> open;
+		roomDistance[currentRoom] = 0;
+		open.push_back(currentRoom);
+		while (!open.empty())
+		{
+			int room = open.front();
+			open.pop_front();
+			for (int next : neighbors[room])
+			{
+				if (roomDistance[next] == INT_MAX)
+				{
+					roomDistance[next] = roomDistance[room] + 1;
+					open.push_back(next);
+				}
+			}
+		}
+	}
+
+	// An asset is as close as the closest room using it, and assets
+	// that aren't in any room count as always close
+	std::vector<bool> inRoom(assets.size(), false);
+	for (Asset& a : assets)
+	{
+		a.distance = INT_MAX;
+	}
+	for (size_t room = 0; room < roomAssets.size(); room++)
+	{
+		for (int asset : roomAssets[room])
+		{
+			inRoom[asset] = true;
+			if (roomDistance[room] < assets[asset].distance)
+				assets[asset].distance = roomDistance[room];
+		}
+	}
+
+	// Closest first, so the current room's assets start loading first
+	std::vector<int> wanted;
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		if (!inRoom[i])
+			assets[i].distance = 0;
+		if (assets[i].distance <= prefetchDistance)
+			wanted.push_back((int)i);
+	}
+	std::stable_sort(wanted.begin(), wanted.end(), [&](int x, int y) { return assets[x].distance < assets[y].distance; });
+
+	for (int asset : wanted)
+	{
+		Asset& a = assets[asset];
+		a.lastWanted = rebalanceCount;
+		if (a.state == Unloaded)
+		{
+			a.state = Loading;
+			a.load(asset);
+		}
+	}
+
+	Evict();
+}
+
+// Drops resident assets that aren't wanted right now, furthest
+// and least recently wanted first, until back under budget
+void ResidencyManager::Evict()
+{
+	if (residentBytes <= budget)
+		return;
+
+	// Loads nothing close needs any more would only add to the overage,
+	// so they're cancelled - AssetLoaded unloads them when they finish
+	for (Asset& a : assets)
+	{
+		if (a.state == Loading && a.distance > prefetchDistance)
+			a.state = Unloaded;
+	}
+
+	while (residentBytes > budget)
+	{
+		int victim = -1;
+		for (size_t i = 0; i < assets.size(); i++)
+		{
+			Asset& a = assets[i];
+			if (a.state != Resident || a.distance <= prefetchDistance)
+				continue;
+
+			if (victim < 0
+				|| a.distance > assets[victim].distance
+				|| (a.distance == assets[victim].distance && a.lastWanted < assets[victim].lastWanted))
+				victim = (int)i;
+		}
+
+		// Everything left is needed - going over budget beats missing textures
+		if (victim < 0)
+			return;
+
+		Asset& a = assets[victim];
+		a.state = Unloaded;
+		residentBytes -= a.bytes;
+		a.bytes = 0;
+		a.unload();
+	}
+}
+
+void ResidencyManager::EnsureRoom(int room)
+{
+	if (room >= (int)roomAssets.size())
+	{
+		roomAssets.resize(room + 1);
+		neighbors.resize(room + 1);
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+// --------------------------------------------------------
+// Decides which assets should be in memory, room by room
+//
+// Rooms (exhibits) list the assets they use and which rooms
+// they connect to.  The current room and its neighbors are
+// kept loaded, so walking through a door never shows a
+// placeholder for long.  Everything else stays cached until
+// the total goes over the budget, then the assets furthest
+// away (and longest unused) are dropped first.
+//
+// There's nothing DirectX in here - assets are just load and
+// unload callbacks - so camera paths can be replayed without
+// a window.
+// --------------------------------------------------------
+class ResidencyManager
+{
+public:
+	ResidencyManager(unsigned long long budgetBytes, int prefetchDistance = 1);
+
+	// load(asset) starts loading and must lead to AssetLoaded(asset, ...),
+	// now or later.  unload() puts the placeholder back.  Assets no room
+	// uses are always kept loaded.
+	int AddAsset(std::function<void(int)> load, std::function<void()> unload);
+	void AddRoomAsset(int room, int asset);
+	void ConnectRooms(int a, int b);
+
+	// Call every frame with the room the camera is in
+	void Update(int currentRoom);
+
+	// Reports an asset as in memory and how big it turned out to be
+	void AssetLoaded(int asset, unsigned long long bytes);
+
+	void SetBudget(unsigned long long budgetBytes);
+	unsigned long long GetBudget();
+	unsigned long long GetResidentBytes();
+	unsigned long long GetPeakResidentBytes();
+	int GetResidentCount();
+	int GetLoadingCount();
+
+private:
+	enum AssetState { Unloaded, Loading, Resident };
+
+	struct Asset
+	{
+		std::function<void(int)> load;
+		std::function<void()> unload;
+		AssetState state;
+		unsigned long long bytes;
+		int distance;			// Rooms away from the camera, as of the last Rebalance
+		unsigned int lastWanted;	// Rebalance that last asked for it
+	};
+
+	void Rebalance();
+	void Evict();
+	void EnsureRoom(int room);
+
+	std::vector<Asset> assets;
+	std::vector<std::vector<int>> roomAssets;
+	std::vector<std::vector<int>> neighbors;
+
+	unsigned long long budget;
+	unsigned long long residentBytes;
+	unsigned long long peakResidentBytes;
+	int prefetchDistance;
+	int currentRoom;
+	unsigned int rebalanceCount;
+	bool dirty;
+};
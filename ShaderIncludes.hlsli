@@ -28,6 +28,26 @@ struct VertexShaderInput
 
 };
 
+// Compressed version of the above - see PackedVertex in VertexPacking.h
+struct VertexShaderInputPacked
+{
+	float4 position	: POSITION;	// -1 to 1 across the mesh bounds
+	float2 normal	: NORMAL;	// Octahedral
+	float2 uv	: TEXCOORD;
+	float2 tangent	: TANGENT;	// Octahedral
+};
+
+// Just the positions, for depth-only passes - see Mesh::DrawPositionOnly
+struct VertexShaderInputPosition
+{
+	float3 position	: POSITION;
+};
+
+struct VertexShaderInputPositionPacked
+{
+	float4 position	: POSITION;	// -1 to 1 across the mesh bounds
+};
+
 struct VertexToPixel
 {
 	// Data type
@@ -62,6 +82,15 @@ struct ParticleVSInput
 	float4 color			: COLOR;
 };
 
+// Must match ParticleRecord in Particle.h
+struct ParticleRecord
+{
+	float3 position;
+	float age;
+	float size;
+	uint color;				// RGBA, 8 bits each with red lowest
+};
+
 
 struct ParticlePSInput
 {
@@ -71,6 +100,40 @@ struct ParticlePSInput
 };
 
 
+// Turns a direction folded onto an octahedron back into a unit vector
+float3 OctahedronDecode(float2 encoded)
+{
+	float3 direction = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float t = saturate(-direction.z);
+	direction.xy += direction.xy >= 0.0f ? -t : t;
+	return normalize(direction);
+}
+
+// Normal maps are BC5, which only keeps X and Y - Z is whatever
+// makes the normal unit length (it always points out of the surface)
+float3 UnpackNormalMap(float2 sampled)
+{
+	float3 normal = float3(sampled * 2 - 1, 0);
+	normal.z = sqrt(saturate(1 - dot(normal.xy, normal.xy)));
+	return normal;
+}
+
+float3 UnpackPosition(float4 packedPosition, float3 positionCenter, float3 positionExtents)
+{
+	return positionCenter + packedPosition.xyz * positionExtents;
+}
+
+// Same math as VertexPacker::Unpack
+VertexShaderInput UnpackVertex(VertexShaderInputPacked packed, float3 positionCenter, float3 positionExtents)
+{
+	VertexShaderInput input;
+	input.position = UnpackPosition(packed.position, positionCenter, positionExtents);
+	input.normal = OctahedronDecode(packed.normal);
+	input.uv = packed.uv;
+	input.tangent = OctahedronDecode(packed.tangent);
+	return input;
+}
+
 struct Light {
 	int Type;
 	float3 Direction;
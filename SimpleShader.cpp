@@ -790,6 +790,10 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
 		refl->GetInputParameterDesc(i, &paramDesc);
 
+		// System values (like SV_VertexID) come from the GPU, not a vertex buffer
+		if (paramDesc.SystemValueType != D3D_NAME_UNDEFINED)
+			continue;
+
 		// Check the semantic name for "_PER_INSTANCE"
 		std::string perInstanceStr = "_PER_INSTANCE";
 		std::string sem = paramDesc.SemanticName;
@@ -847,6 +851,10 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 		inputLayoutDesc.push_back(elementDesc);
 	}
 
+	// Nothing to read from vertex buffers?  Then no layout is needed at all
+	if (inputLayoutDesc.empty())
+		return true;
+
 	// Try to create Input Layout
 	HRESULT hr = device->CreateInputLayout(
 		&inputLayoutDesc[0], 
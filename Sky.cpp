@@ -2,7 +2,7 @@
 
 Sky::Sky(Microsoft::WRL::ComPtr<ID3D11SamplerState> sso,
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> st,
-	Mesh* sm,
+	std::shared_ptr<Mesh> sm,
 	SimplePixelShader* sp,
 	SimpleVertexShader* sv,
 	Microsoft::WRL::ComPtr<ID3D11Device> device,
@@ -1,6 +1,7 @@
 #pragma once
 #include "DXCore.h"
 #include <wrl/client.h> 
+#include <memory>
 #include "Mesh.h"
 #include "SimpleShader.h"
 #include "Camera.h"
@@ -9,7 +10,7 @@ class Sky {
 public:
 	Sky(Microsoft::WRL::ComPtr<ID3D11SamplerState> sso,
 		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> st,
-		Mesh* sm,
+		std::shared_ptr<Mesh> sm,
 		SimplePixelShader* sp,
 		SimpleVertexShader* sv,
 		Microsoft::WRL::ComPtr<ID3D11Device> device,
@@ -22,7 +23,7 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> skyTextureSRV;
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> skyDSS;
 	Microsoft::WRL::ComPtr<ID3D11RasterizerState> skyRasterizerState;
-	Mesh* skyMesh;
+	std::shared_ptr<Mesh> skyMesh;
 	SimplePixelShader* skyPS;
 	SimpleVertexShader* skyVS;
 
@@ -0,0 +1,104 @@
+#include "TestFramework.h"
+#include "AtlasPacker.h"
+#include "TextureAtlas.h"
+#include <math.h>
+
+static bool Overlap(const AtlasRect& a, const AtlasRect& b)
+{
+	return a.x < b.x + b.width && b.x < a.x + a.width
+		&& a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+// Every rect inside the atlas and none on top of another
+static bool ValidPacking(const std::vector<AtlasRect>& rects, unsigned int width, unsigned int height)
+{
+	for (size_t i = 0; i < rects.size(); i++)
+	{
+		if (rects[i].x + rects[i].width > width || rects[i].y + rects[i].height > height)
+			return false;
+		for (size_t j = i + 1; j < rects.size(); j++)
+		{
+			if (Overlap(rects[i], rects[j]))
+				return false;
+		}
+	}
+	return true;
+}
+
+TEST(AtlasPacksEqualSquaresPerfectly)
+{
+	std::vector<AtlasRect> rects(16, { 0, 0, 64, 64 });
+	unsigned int width = 0;
+	unsigned int height = 0;
+	CHECK(AtlasPacker::Pack(rects, 1024, width, height));
+	CHECK(width * height == 16 * 64 * 64);
+	CHECK(width == height); // The squarer of the equal areas
+	CHECK(ValidPacking(rects, width, height));
+}
+
+TEST(AtlasPacksMixedSizes)
+{
+	std::vector<AtlasRect> rects;
+	unsigned long long area = 0;
+	unsigned int seed = 7;
+	for (int i = 0; i < 60; i++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		unsigned int w = 8 + (seed >> 8) % 120;
+		unsigned int h = 8 + (seed >> 20) % 120;
+		rects.push_back({ 0, 0, w, h });
+		area += (unsigned long long)w * h;
+	}
+
+	unsigned int width = 0;
+	unsigned int height = 0;
+	CHECK(AtlasPacker::Pack(rects, 2048, width, height));
+	CHECK(width <= 2048 && height <= 2048);
+	CHECK(ValidPacking(rects, width, height));
+
+	// Not a strict bound, just that it isn't wasting most of the space
+	CHECK((unsigned long long)width * height < area * 3 / 2);
+}
+
+TEST(AtlasRejectsWhatDoesNotFit)
+{
+	unsigned int width = 0;
+	unsigned int height = 0;
+
+	std::vector<AtlasRect> tooWide(1, { 0, 0, 300, 10 });
+	CHECK(!AtlasPacker::Pack(tooWide, 256, width, height));
+
+	// Four fill 128 x 128 exactly, a fifth has nowhere to go
+	std::vector<AtlasRect> tooMany(5, { 0, 0, 64, 64 });
+	CHECK(!AtlasPacker::Pack(tooMany, 128, width, height));
+	tooMany.pop_back();
+	CHECK(AtlasPacker::Pack(tooMany, 128, width, height));
+	CHECK(width == 128 && height == 128);
+}
+
+TEST(AtlasReportsItsEfficiency)
+{
+	// Four 56 x 56 images take 72 x 72 each with their gutters,
+	// which pack into 144 x 144 with no space left over
+	std::vector<std::wstring> files = { L"a.png", L"b.png", L"c.png", L"d.png" };
+	std::vector<unsigned int> sizes(4, 56);
+	TextureAtlas atlas;
+	CHECK(atlas.Plan(files, sizes, sizes, 1024));
+	CHECK(atlas.GetWidth() == 144 && atlas.GetHeight() == 144);
+	CHECK(fabsf(atlas.GetEfficiency() - 4.0f * 56 * 56 / (144 * 144)) < 1e-6f);
+
+	// Each image's UVs cover just the image, inside its gutter
+	DirectX::XMFLOAT2 scale = atlas.GetUVScale(atlas.Find(L"c.png"));
+	DirectX::XMFLOAT2 offset = atlas.GetUVOffset(atlas.Find(L"c.png"));
+	CHECK(scale.x == 56.0f / 144 && scale.y == 56.0f / 144);
+	CHECK(fmodf(offset.x * 144, 72) == ATLAS_GUTTER && fmodf(offset.y * 144, 72) == ATLAS_GUTTER);
+
+	// Small images are mostly gutter
+	std::vector<unsigned int> small(4, 8);
+	CHECK(atlas.Plan(files, small, small, 1024));
+	CHECK(atlas.GetEfficiency() < 0.25f);
+
+	// Nothing planned (or nothing that fit) reports nothing used
+	CHECK(!atlas.Plan(files, sizes, sizes, 128));
+	CHECK(atlas.GetEfficiency() == 0.0f);
+}
@@ -0,0 +1,22 @@
+#include "TestFramework.h"
+#include <string.h>
+
+// --------------------------------------------------------
+// Entry point for the console test runner
+//
+// Returns how many tests failed, so anything running this
+// (a build step, a CI job) sees zero as a pass.
+//
+// "Tests --bench [name]" runs the benchmarks instead - all
+// of them, or just those with name in theirs.
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+	{
+		TestRegistry::RunBenchmarks(argc > 2 ? argv[2] : nullptr);
+		return 0;
+	}
+
+	return TestRegistry::RunAll();
+}
@@ -0,0 +1,133 @@
+#include "TestFramework.h"
+#include "TestDevice.h"
+#include "MeshCache.h"
+#include "MeshFile.h"
+#include <stdio.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A quadsPerSide x quadsPerSide grid, big enough that loading
+// it takes a while when quadsPerSide is in the hundreds
+static void WriteGrid(const char* path, int quadsPerSide)
+{
+	std::string text;
+	char line[128];
+	int side = quadsPerSide + 1;
+	for (int y = 0; y < side; y++)
+	{
+		for (int x = 0; x < side; x++)
+		{
+			snprintf(line, sizeof(line), "v %d %d 0\nvt %f %f\n", x, y, (float)x / quadsPerSide, (float)y / quadsPerSide);
+			text += line;
+		}
+	}
+	text += "vn 0 0 -1\n";
+	for (int y = 0; y < quadsPerSide; y++)
+	{
+		for (int x = 0; x < quadsPerSide; x++)
+		{
+			int a = y * side + x + 1;
+			snprintf(line, sizeof(line), "f %d/%d/1 %d/%d/1 %d/%d/1 %d/%d/1\n", a, a, a + 1, a + 1, a + side + 1, a + side + 1, a + side, a + side);
+			text += line;
+		}
+	}
+	WriteTestFile(path, text);
+}
+
+// Deletes the file and every binary cache Mesh may have left next to it
+static void RemoveWithCaches(const char* path)
+{
+	unsigned int flags[] = { 0, MESH_FILE_OPTIMIZED, MESH_FILE_LODS, MESH_FILE_OPTIMIZED | MESH_FILE_LODS };
+	for (unsigned int flag : flags)
+		remove(MeshFile::GetCachePath(path, flag).c_str());
+	remove(path);
+}
+
+TEST(MeshCacheSharesAndReleases)
+{
+	TestDevice device;
+	const char* path = "MeshCacheTest.obj";
+	WriteGrid(path, 4);
+
+	MeshCache& cache = MeshCache::GetInstance();
+	MeshCacheStats start = cache.GetStats();
+
+	// The first load builds it, the second (spelled differently) shares it
+	std::shared_ptr<Mesh> first = cache.Load(path, device.GetDevice());
+	std::shared_ptr<Mesh> second = cache.Load("./MeshCacheTest.obj", device.GetDevice());
+	CHECK(first && first->GetIndexCount() > 0);
+	CHECK(first == second);
+
+	MeshCacheStats shared = cache.GetStats();
+	CHECK(shared.misses == start.misses + 1);
+	CHECK(shared.hits == start.hits + 1);
+	CHECK(shared.residentMeshes == start.residentMeshes + 1);
+	CHECK(shared.residentBytes == start.residentBytes + first->GetMemorySize());
+
+	// Different options are a different mesh
+	std::shared_ptr<Mesh> packed = cache.Load(path, device.GetDevice(), true, true);
+	CHECK(packed && packed != first && packed->HasPackedVertices());
+	CHECK(cache.GetStats().misses == start.misses + 2);
+	CHECK(cache.GetStats().residentMeshes == start.residentMeshes + 2);
+
+	// Still resident until the last handle goes
+	first.reset();
+	CHECK(cache.GetStats().residentMeshes == start.residentMeshes + 2);
+	second.reset();
+	packed.reset();
+	MeshCacheStats released = cache.GetStats();
+	CHECK(released.residentMeshes == start.residentMeshes);
+	CHECK(released.residentBytes == start.residentBytes);
+
+	// So the next load is a miss again
+	std::shared_ptr<Mesh> again = cache.Load(path, device.GetDevice());
+	CHECK(again && cache.GetStats().misses == start.misses + 3);
+	again.reset();
+
+	RemoveWithCaches(path);
+}
+
+TEST(MeshCacheLoadsAFileOnceAcrossThreads)
+{
+	TestDevice device;
+	const char* path = "MeshCacheThreadsTest.obj";
+	WriteGrid(path, 200);
+
+	MeshCache& cache = MeshCache::GetInstance();
+	MeshCacheStats start = cache.GetStats();
+
+	// Every thread asks for the same file at the same moment
+	const int threadCount = 8;
+	std::vector<std::shared_ptr<Mesh>> meshes(threadCount);
+	std::vector<std::thread> threads;
+	std::atomic<int> ready(0);
+	for (int i = 0; i < threadCount; i++)
+	{
+		threads.emplace_back([&, i]()
+		{
+			ready++;
+			while (ready < threadCount)
+				std::this_thread::yield();
+			meshes[i] = cache.Load(path, device.GetDevice(), false);
+		});
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+
+	// One build; everyone else waited for it and shares the result
+	MeshCacheStats loaded = cache.GetStats();
+	CHECK(loaded.misses == start.misses + 1);
+	CHECK(loaded.hits == start.hits + threadCount - 1);
+	CHECK(loaded.residentMeshes == start.residentMeshes + 1);
+	bool same = meshes[0] != nullptr;
+	for (std::shared_ptr<Mesh>& mesh : meshes)
+		same = same && mesh == meshes[0];
+	CHECK(same);
+
+	meshes.clear();
+	CHECK(cache.GetStats().residentMeshes == start.residentMeshes);
+
+	RemoveWithCaches(path);
+}
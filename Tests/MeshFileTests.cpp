@@ -0,0 +1,100 @@
+#include "TestFramework.h"
+#include "MeshFile.h"
+#include <stdio.h>
+#include <string.h>
+
+static void WriteCache(const std::string& cachePath, const std::vector<char>& bytes)
+{
+	WriteTestFile(cachePath.c_str(), std::string(bytes.begin(), bytes.end()));
+}
+
+TEST(MeshFileRoundTrip)
+{
+	const char* path = "MeshFileTest.obj";
+	WriteTestFile(path,
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 0 0 1\n"
+		"f 1 2 3\nf 1 3 4\nf 1 4 5\n");
+
+	MeshData data;
+	CHECK(ObjLoader::Load(path, data));
+	CHECK(!data.indices.empty());
+
+	// Each set of flags has its own cache
+	std::string cachePath = MeshFile::GetCachePath(path, MESH_FILE_OPTIMIZED);
+	CHECK(cachePath != MeshFile::GetCachePath(path, 0));
+	CHECK(MeshFile::Write(path, data, MESH_FILE_OPTIMIZED));
+
+	{
+		MappedFile cache(cachePath.c_str());
+		const MeshFileHeader* header = MeshFile::Validate(cache, path, MESH_FILE_OPTIMIZED);
+		CHECK(header != nullptr);
+		if (header)
+		{
+			CHECK(header->vertexCount == data.vertices.size());
+			CHECK(header->indexCount == data.indices.size());
+			CHECK(header->lodCount == 1);
+			CHECK(memcmp(MeshFile::GetVertices(header), &data.vertices[0], sizeof(Vertex) * data.vertices.size()) == 0);
+			CHECK(memcmp(MeshFile::GetIndices(header), &data.indices[0], sizeof(int) * data.indices.size()) == 0);
+
+			// The loader flips z, so the box runs from (0, 0, -1) to (1, 1, 0)
+			CHECK(header->boundsMin.x == 0 && header->boundsMin.y == 0 && header->boundsMin.z == -1);
+			CHECK(header->boundsMax.x == 1 && header->boundsMax.y == 1 && header->boundsMax.z == 0);
+		}
+
+		// Built one way, so it's no good for the other
+		CHECK(MeshFile::Validate(cache, path, MESH_FILE_OPTIMIZED | MESH_FILE_LODS) == nullptr);
+	}
+
+	// An index off the end of the vertices is rejected
+	std::vector<char> bytes = ReadTestFile(cachePath.c_str());
+	const MeshFileHeader* header = (const MeshFileHeader*)&bytes[0];
+	int badIndex = (int)header->vertexCount;
+	memcpy(&bytes[bytes.size() - sizeof(int)], &badIndex, sizeof(int));
+	WriteCache(cachePath, bytes);
+	{
+		MappedFile cache(cachePath.c_str());
+		CHECK(MeshFile::Validate(cache, path, MESH_FILE_OPTIMIZED) == nullptr);
+	}
+
+	// And so is one cut short
+	bytes.resize(bytes.size() - sizeof(int));
+	WriteCache(cachePath, bytes);
+	{
+		MappedFile cache(cachePath.c_str());
+		CHECK(MeshFile::Validate(cache, path, MESH_FILE_OPTIMIZED) == nullptr);
+	}
+
+	remove(cachePath.c_str());
+	remove(path);
+}
+
+TEST(MeshFileNoticesAChangedSource)
+{
+	const char* path = "MeshFileSourceTest.obj";
+	WriteTestFile(path, "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 3\n");
+
+	MeshData data;
+	CHECK(ObjLoader::Load(path, data));
+	CHECK(MeshFile::Write(path, data, 0));
+	std::string cachePath = MeshFile::GetCachePath(path, 0);
+	{
+		MappedFile cache(cachePath.c_str());
+		CHECK(MeshFile::Validate(cache, path, 0) != nullptr);
+	}
+
+	// An edited source is rebuilt
+	WriteTestFile(path, "v 0 0 0\nv 2.5 0 0\nv 1 1 0\nf 1 2 3\n");
+	{
+		MappedFile cache(cachePath.c_str());
+		CHECK(MeshFile::Validate(cache, path, 0) == nullptr);
+	}
+
+	// But with no source at all the cache is all there is
+	CHECK(MeshFile::Write(path, data, 0));
+	remove(path);
+	{
+		MappedFile cache(cachePath.c_str());
+		CHECK(MeshFile::Validate(cache, path, 0) != nullptr);
+	}
+	remove(cachePath.c_str());
+}
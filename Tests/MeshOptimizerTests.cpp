@@ -0,0 +1,106 @@
+#include "TestFramework.h"
+#include "MeshOptimizer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <array>
+
+// A flat grid of quadsPerSide x quadsPerSide quads whose
+// triangles are shuffled, so the vertex cache barely helps
+static MeshData MakeShuffledGrid(int quadsPerSide)
+{
+	MeshData data;
+	int side = quadsPerSide + 1;
+	for (int y = 0; y < side; y++)
+	{
+		for (int x = 0; x < side; x++)
+		{
+			Vertex vertex = {};
+			vertex.Position = DirectX::XMFLOAT3((float)x, 0.0f, (float)y);
+			vertex.Normal = DirectX::XMFLOAT3(0, 1, 0);
+			vertex.UV = DirectX::XMFLOAT2((float)x / quadsPerSide, (float)y / quadsPerSide);
+			data.vertices.push_back(vertex);
+		}
+	}
+
+	std::vector<std::array<int, 3>> triangles;
+	for (int y = 0; y < quadsPerSide; y++)
+	{
+		for (int x = 0; x < quadsPerSide; x++)
+		{
+			int a = y * side + x;
+			triangles.push_back({ a, a + side, a + 1 });
+			triangles.push_back({ a + 1, a + side, a + side + 1 });
+		}
+	}
+
+	srand(42);
+	for (int i = (int)triangles.size() - 1; i > 0; i--)
+		std::swap(triangles[i], triangles[rand() % (i + 1)]);
+	for (const std::array<int, 3>& triangle : triangles)
+		data.indices.insert(data.indices.end(), triangle.begin(), triangle.end());
+	return data;
+}
+
+// Each triangle as its three corner positions, starting from the
+// smallest corner (keeping the winding), in sorted order
+static std::vector<std::array<float, 9>> TrianglePositions(const MeshData& data)
+{
+	std::vector<std::array<float, 9>> triangles;
+	for (size_t i = 0; i + 2 < data.indices.size(); i += 3)
+	{
+		std::array<std::array<float, 3>, 3> corners;
+		for (int c = 0; c < 3; c++)
+		{
+			const DirectX::XMFLOAT3& p = data.vertices[data.indices[i + c]].Position;
+			corners[c] = { p.x, p.y, p.z };
+		}
+		int first = (int)(std::min_element(corners.begin(), corners.end()) - corners.begin());
+		std::array<float, 9> triangle;
+		for (int c = 0; c < 3; c++)
+			std::copy(corners[(first + c) % 3].begin(), corners[(first + c) % 3].end(), triangle.begin() + c * 3);
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+TEST(MeshOptimizerMeasuresACMR)
+{
+	// Nothing shared is three misses a triangle, a fan reuses the hub
+	int separate[] = { 0, 1, 2, 3, 4, 5 };
+	CHECK(MeshOptimizer::CalculateACMR(separate, 6, 6, 16) == 3.0f);
+
+	int fan[] = { 0, 1, 2, 0, 2, 3, 0, 3, 4, 0, 4, 5 };
+	CHECK(MeshOptimizer::CalculateACMR(fan, 12, 6, 16) == 1.5f);
+
+	// A cache too small to keep anything
+	CHECK(MeshOptimizer::CalculateACMR(fan, 12, 6, 0) == 3.0f);
+	CHECK(MeshOptimizer::CalculateACMR(fan, 0, 6, 16) == 0.0f);
+}
+
+TEST(MeshOptimizerLowersACMR)
+{
+	MeshData data = MakeShuffledGrid(64);
+	std::vector<std::array<float, 9>> before = TrianglePositions(data);
+
+	MeshOptimizerStats stats = {};
+	MeshOptimizer::Optimize(data, &stats);
+	printf("    ACMR %.3f -> %.3f (vertex cache) -> %.3f (overdraw)\n", stats.acmrBefore, stats.acmrAfterCache, stats.acmrAfter);
+
+	// Shuffled, nearly every corner misses; a grid can get under one
+	CHECK(stats.acmrBefore > 2.0f);
+	CHECK(stats.acmrAfterCache < 1.0f);
+	CHECK(stats.acmrAfter < 1.0f);
+	CHECK(stats.acmrAfter <= stats.acmrAfterCache * 1.1f);
+	CHECK(stats.acmrAfter == MeshOptimizer::CalculateACMR(&data.indices[0], (int)data.indices.size(), (int)data.vertices.size(), 16));
+
+	// Same triangles, same way round
+	CHECK(TrianglePositions(data) == before);
+
+	// Nothing to measure
+	MeshData empty;
+	stats.acmrBefore = 1.0f;
+	MeshOptimizer::Optimize(empty, &stats);
+	CHECK(stats.acmrBefore == 0.0f && stats.acmrAfter == 0.0f);
+}
@@ -0,0 +1,242 @@
+#include "TestFramework.h"
+#include "MeshSimplifier.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+using namespace DirectX;
+
+static XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+static float Dot(const XMFLOAT3& a, const XMFLOAT3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+// Distance from p to the closest point of triangle abc
+// (Ericson, "Real-Time Collision Detection", 5.1.5)
+static float DistanceToTriangle(const XMFLOAT3& p, const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+{
+	XMFLOAT3 ab = Subtract(b, a), ac = Subtract(c, a), ap = Subtract(p, a);
+	float d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+	XMFLOAT3 closest;
+	if (d1 <= 0 && d2 <= 0)
+	{
+		closest = a;
+	}
+	else
+	{
+		XMFLOAT3 bp = Subtract(p, b);
+		float d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+		XMFLOAT3 cp = Subtract(p, c);
+		float d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+		float vc = d1 * d4 - d3 * d2, vb = d5 * d2 - d1 * d6, va = d3 * d6 - d5 * d4;
+		if (d3 >= 0 && d4 <= d3)
+			closest = b;
+		else if (d6 >= 0 && d5 <= d6)
+			closest = c;
+		else if (vc <= 0 && d1 >= 0 && d3 <= 0)
+		{
+			float v = d1 / (d1 - d3);
+			closest = XMFLOAT3(a.x + ab.x * v, a.y + ab.y * v, a.z + ab.z * v);
+		}
+		else if (vb <= 0 && d2 >= 0 && d6 <= 0)
+		{
+			float w = d2 / (d2 - d6);
+			closest = XMFLOAT3(a.x + ac.x * w, a.y + ac.y * w, a.z + ac.z * w);
+		}
+		else if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+		{
+			float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			closest = XMFLOAT3(b.x + (c.x - b.x) * w, b.y + (c.y - b.y) * w, b.z + (c.z - b.z) * w);
+		}
+		else
+		{
+			float denom = 1.0f / (va + vb + vc);
+			float v = vb * denom, w = vc * denom;
+			closest = XMFLOAT3(a.x + ab.x * v + ac.x * w, a.y + ab.y * v + ac.y * w, a.z + ab.z * v + ac.z * w);
+		}
+	}
+	XMFLOAT3 offset = Subtract(p, closest);
+	return sqrtf(Dot(offset, offset));
+}
+
+// How far any original vertex ends up from the simplified surface
+static float FarthestVertex(const MeshData& data, const std::vector<int>& simplified)
+{
+	float farthest = 0.0f;
+	for (const Vertex& vertex : data.vertices)
+	{
+		float nearest = FLT_MAX;
+		for (size_t t = 0; t < simplified.size(); t += 3)
+		{
+			float distance = DistanceToTriangle(vertex.Position,
+				data.vertices[simplified[t]].Position, data.vertices[simplified[t + 1]].Position, data.vertices[simplified[t + 2]].Position);
+			nearest = std::min(nearest, distance);
+		}
+		farthest = std::max(farthest, nearest);
+	}
+	return farthest;
+}
+
+// --------------------------------------------------------
+// A tube of segments x rings quads, open at both ends, that
+// touches x = 0.  The uv seam runs down x = 0 and each seam
+// vertex has a copy at u = 1 - the copies' x is -0.
+// --------------------------------------------------------
+static MeshData MakeTube(int segments, int rings)
+{
+	MeshData data;
+	for (int ring = 0; ring <= rings; ring++)
+	{
+		for (int segment = 0; segment <= segments; segment++)
+		{
+			float angle = XM_2PI * (segment % segments) / segments;
+			Vertex vertex = {};
+			vertex.Position = XMFLOAT3(1.0f - cosf(angle), (float)ring / rings * 2.0f, sinf(angle));
+			vertex.Normal = XMFLOAT3(-cosf(angle), 0.0f, sinf(angle));
+			vertex.UV = XMFLOAT2((float)segment / segments, (float)ring / rings);
+			if (segment % segments == 0)
+				vertex.Position.x = segment == 0 ? 0.0f : -0.0f;
+			data.vertices.push_back(vertex);
+		}
+	}
+
+	int row = segments + 1;
+	for (int ring = 0; ring < rings; ring++)
+	{
+		for (int segment = 0; segment < segments; segment++)
+		{
+			int a = ring * row + segment;
+			int quad[] = { a, a + row, a + 1, a + 1, a + row, a + row + 1 };
+			data.indices.insert(data.indices.end(), quad, quad + 6);
+		}
+	}
+	return data;
+}
+
+TEST(MeshSimplifierHalvesAFlatGrid)
+{
+	// 32 x 32 quads on the plane y = 0
+	MeshData data;
+	for (int y = 0; y <= 32; y++)
+	{
+		for (int x = 0; x <= 32; x++)
+		{
+			Vertex vertex = {};
+			vertex.Position = XMFLOAT3((float)x, 0.0f, (float)y);
+			vertex.Normal = XMFLOAT3(0, 1, 0);
+			data.vertices.push_back(vertex);
+		}
+	}
+	for (int y = 0; y < 32; y++)
+	{
+		for (int x = 0; x < 32; x++)
+		{
+			int a = y * 33 + x;
+			int quad[] = { a, a + 33, a + 1, a + 1, a + 33, a + 34 };
+			data.indices.insert(data.indices.end(), quad, quad + 6);
+		}
+	}
+
+	int target = (int)data.indices.size() / 2 / 3 * 3;
+	std::vector<int> result;
+	float error = MeshSimplifier::Simplify(&data.vertices[0], (int)data.vertices.size(), &data.indices[0], (int)data.indices.size(), target, 0.01f, result);
+
+	// Flat, so the interior can go for free
+	CHECK((int)result.size() <= target);
+	CHECK(result.size() % 3 == 0 && !result.empty());
+	CHECK(error < 1e-5f);
+
+	bool valid = true;
+	for (size_t t = 0; t < result.size(); t += 3)
+	{
+		valid = valid && result[t] >= 0 && result[t] < (int)data.vertices.size();
+		valid = valid && result[t] != result[t + 1] && result[t + 1] != result[t + 2] && result[t] != result[t + 2];
+	}
+	CHECK(valid);
+
+	// Every triangle still faces up, and the area is unchanged
+	float area = 0.0f;
+	bool facesUp = true;
+	for (size_t t = 0; t < result.size(); t += 3)
+	{
+		XMFLOAT3 a = data.vertices[result[t]].Position;
+		XMFLOAT3 ab = Subtract(data.vertices[result[t + 1]].Position, a);
+		XMFLOAT3 ac = Subtract(data.vertices[result[t + 2]].Position, a);
+		float up = ab.z * ac.x - ab.x * ac.z;
+		facesUp = facesUp && up > 0.0f;
+		area += up * 0.5f;
+	}
+	CHECK(facesUp);
+	CHECK(fabsf(area - 32.0f * 32.0f) < 1e-2f);
+}
+
+TEST(MeshSimplifierBoundsTheError)
+{
+	MeshData sphere;
+	CHECK(ObjLoader::Load(TestRegistry::GetAssetPath("Models/sphere.obj").c_str(), sphere));
+	if (sphere.indices.empty())
+		return;
+
+	// The sphere is 2 across and Simplify's errors are relative to that
+	float tolerances[] = { 0.005f, 0.02f, 0.1f };
+	size_t previous = sphere.indices.size() + 1;
+	for (float maxError : tolerances)
+	{
+		std::vector<int> result;
+		float error = MeshSimplifier::Simplify(&sphere.vertices[0], (int)sphere.vertices.size(), &sphere.indices[0], (int)sphere.indices.size(), 0, maxError, result);
+		float farthest = FarthestVertex(sphere, result);
+		printf("    max error %.3f: %zu -> %zu triangles, reported %.4f, farthest vertex %.4f\n",
+			maxError, sphere.indices.size() / 3, result.size() / 3, error, farthest / 2.0f);
+
+		// Stops at the error, not the (impossible) target.  The error
+		// is an average over the planes around each kept vertex, so
+		// the worst original vertex can sit a little further out.
+		CHECK(!result.empty());
+		CHECK(error <= maxError);
+		CHECK(farthest / 2.0f <= maxError * 2.5f);
+
+		// Looser limits go further
+		CHECK(result.size() < previous);
+		previous = result.size();
+	}
+}
+
+TEST(MeshSimplifierKeepsTheSeam)
+{
+	MeshData tube = MakeTube(24, 12);
+	std::vector<int> result;
+	MeshSimplifier::Simplify(&tube.vertices[0], (int)tube.vertices.size(), &tube.indices[0], (int)tube.indices.size(), 0, 1.0f, result);
+	CHECK(result.size() < tube.indices.size() / 2);
+
+	// Both copies of every seam vertex are still in use, so
+	// the uv seam (which sits on -0 and 0) hasn't torn open
+	bool kept = true;
+	int row = 25;
+	for (int ring = 0; ring <= 12; ring++)
+	{
+		kept = kept && std::find(result.begin(), result.end(), ring * row) != result.end();
+		kept = kept && std::find(result.begin(), result.end(), ring * row + 24) != result.end();
+	}
+	CHECK(kept);
+}
+
+TEST(MeshSimplifierBuildsLods)
+{
+	MeshData sphere;
+	CHECK(ObjLoader::Load(TestRegistry::GetAssetPath("Models/sphere.obj").c_str(), sphere));
+	if (sphere.indices.empty())
+		return;
+
+	int fullCount = (int)sphere.indices.size();
+	MeshSimplifier::GenerateLods(sphere, MESH_MAX_LODS, true);
+
+	// Each level is at most 90% of the one before, stored in order
+	CHECK(sphere.lodIndexCounts.size() > 1 && sphere.lodIndexCounts.size() <= (size_t)MESH_MAX_LODS);
+	CHECK(sphere.lodIndexCounts[0] == fullCount);
+	int total = 0;
+	for (size_t lod = 0; lod < sphere.lodIndexCounts.size(); lod++)
+	{
+		total += sphere.lodIndexCounts[lod];
+		if (lod > 0)
+			CHECK(sphere.lodIndexCounts[lod] <= sphere.lodIndexCounts[lod - 1] * 0.9f);
+	}
+	CHECK(total == (int)sphere.indices.size());
+}
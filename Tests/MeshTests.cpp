@@ -0,0 +1,327 @@
+#include "TestFramework.h"
+#include "TestDevice.h"
+#include "Mesh.h"
+#include "MeshFile.h"
+#include "VertexPacking.h"
+#include "ObjLoader.h"
+#include "ThreadPool.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A strip of vertexCount vertices along x, and triangles that
+// each use the first vertex, one in the middle and the last
+static void MakeStrip(int vertexCount, int triangleCount, std::vector<Vertex>& vertices, std::vector<int>& indices)
+{
+	vertices.assign(vertexCount, Vertex());
+	for (int i = 0; i < vertexCount; i++)
+	{
+		vertices[i].Position = DirectX::XMFLOAT3((float)i, (float)(i % 2), 0.0f);
+		vertices[i].Normal = DirectX::XMFLOAT3(0, 0, -1);
+		vertices[i].UV = DirectX::XMFLOAT2((float)i / vertexCount, (float)(i % 2));
+		vertices[i].Tangent = DirectX::XMFLOAT3(0, 0, 0);
+	}
+
+	indices.clear();
+	for (int t = 0; t < triangleCount; t++)
+	{
+		indices.push_back(0);
+		indices.push_back(1 + t % (vertexCount - 2));
+		indices.push_back(vertexCount - 1);
+	}
+}
+
+// --------------------------------------------------------
+// A bumpy grid of quadsPerSide x quadsPerSide quads with
+// jittered uvs, so no two triangles share a tangent
+// --------------------------------------------------------
+static void MakeGrid(int quadsPerSide, std::vector<Vertex>& vertices, std::vector<int>& indices)
+{
+	srand(1234);
+	int side = quadsPerSide + 1;
+	vertices.assign(side * side, Vertex());
+	for (int y = 0; y < side; y++)
+	{
+		for (int x = 0; x < side; x++)
+		{
+			float u = (float)x / quadsPerSide;
+			float v = (float)y / quadsPerSide;
+			float jitter = (rand() / (float)RAND_MAX - 0.5f) * 0.2f / quadsPerSide;
+			Vertex& vertex = vertices[y * side + x];
+			vertex.Position = DirectX::XMFLOAT3(u * 10.0f, sinf(u * 20.0f) * cosf(v * 20.0f), v * 10.0f);
+			vertex.Normal = DirectX::XMFLOAT3(0, 1, 0);
+			vertex.UV = DirectX::XMFLOAT2(u + jitter, v - jitter);
+			vertex.Tangent = DirectX::XMFLOAT3(0, 0, 0);
+		}
+	}
+
+	indices.clear();
+	for (int y = 0; y < quadsPerSide; y++)
+	{
+		for (int x = 0; x < quadsPerSide; x++)
+		{
+			int a = y * side + x;
+			int b = a + 1;
+			int c = a + side;
+			int d = c + 1;
+			int quad[] = { a, c, b, b, c, d };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+// Runs both tangent builders on copies of the vertices and
+// checks they agree to within rounding
+static bool TangentsMatchReference(const std::vector<Vertex>& vertices, std::vector<int>& indices)
+{
+	std::vector<Vertex> fast = vertices;
+	std::vector<Vertex> reference = vertices;
+	Mesh::CalculateTangents(&fast[0], (int)fast.size(), &indices[0], (int)indices.size());
+	Mesh::CalculateTangentsReference(&reference[0], (int)reference.size(), &indices[0], (int)indices.size());
+
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const DirectX::XMFLOAT3& a = fast[i].Tangent;
+		const DirectX::XMFLOAT3& b = reference[i].Tangent;
+		if (fabsf(a.x - b.x) > 1e-4f || fabsf(a.y - b.y) > 1e-4f || fabsf(a.z - b.z) > 1e-4f)
+		{
+			printf("    vertex %zu: (%f, %f, %f) vs reference (%f, %f, %f)\n", i, a.x, a.y, a.z, b.x, b.y, b.z);
+			return false;
+		}
+	}
+	return true;
+}
+
+TEST(MeshTangentsMatchTheReference)
+{
+	MeshData sphere;
+	CHECK(ObjLoader::Load(TestRegistry::GetAssetPath("Models/sphere.obj").c_str(), sphere));
+	if (!sphere.indices.empty())
+		CHECK(TangentsMatchReference(sphere.vertices, sphere.indices));
+
+	// 98 triangles, so the last group of four is half empty
+	std::vector<Vertex> vertices;
+	std::vector<int> indices;
+	MakeGrid(7, vertices, indices);
+	CHECK(TangentsMatchReference(vertices, indices));
+
+	// 131072 triangles, split across several accumulators
+	ThreadPool::SetThreadCount(4);
+	MakeGrid(256, vertices, indices);
+	CHECK(TangentsMatchReference(vertices, indices));
+	ThreadPool::SetThreadCount(0);
+}
+
+TEST(MeshTangentsSurviveDegenerateTriangles)
+{
+	std::vector<Vertex> vertices;
+	std::vector<int> indices;
+	MakeGrid(7, vertices, indices);
+	int gridVertices = (int)vertices.size();
+
+	// Every uv the same, uvs along a line, positions on one point, a
+	// NaN position, and a huge one whose tangent overflows to inf
+	Vertex corner = {};
+	corner.Normal = DirectX::XMFLOAT3(0, 1, 0);
+	auto addTriangle = [&](Vertex a, Vertex b, Vertex c)
+	{
+		int first = (int)vertices.size();
+		vertices.push_back(a);
+		vertices.push_back(b);
+		vertices.push_back(c);
+		indices.push_back(first);
+		indices.push_back(first + 1);
+		indices.push_back(first + 2);
+	};
+	auto make = [&](float x, float y, float z, float u, float v)
+	{
+		Vertex vertex = corner;
+		vertex.Position = DirectX::XMFLOAT3(x, y, z);
+		vertex.UV = DirectX::XMFLOAT2(u, v);
+		return vertex;
+	};
+	addTriangle(make(0, 0, 0, 0.5f, 0.5f), make(1, 0, 0, 0.5f, 0.5f), make(0, 0, 1, 0.5f, 0.5f));
+	addTriangle(make(0, 0, 0, 0, 0), make(1, 0, 0, 0.5f, 0.5f), make(0, 0, 1, 1, 1));
+	addTriangle(make(2, 0, 2, 0, 0), make(2, 0, 2, 1, 0), make(2, 0, 2, 0, 1));
+	addTriangle(make(NAN, 0, 0, 0, 0), make(1, 0, 0, 1, 0), make(0, 0, 1, 0, 1));
+	addTriangle(make(0, 0, 0, 0, 0), make(3e38f, 0, 0, 1e-5f, 0), make(0, 0, -3e38f, 0, 1e-5f));
+
+	// A broken normal, which the fallback can't use either
+	Vertex noNormal = make(0, 0, 0, 0, 0);
+	noNormal.Normal = DirectX::XMFLOAT3(0, 0, 0);
+	addTriangle(noNormal, noNormal, noNormal);
+
+	std::vector<Vertex> fast = vertices;
+	std::vector<Vertex> reference = vertices;
+	Mesh::CalculateTangents(&fast[0], (int)fast.size(), &indices[0], (int)indices.size());
+	Mesh::CalculateTangentsReference(&reference[0], (int)reference.size(), &indices[0], (int)indices.size());
+
+	// Every tangent is finite and unit length, on both paths
+	bool finite = true;
+	bool unit = true;
+	for (const std::vector<Vertex>* result : { &fast, &reference })
+	{
+		for (const Vertex& vertex : *result)
+		{
+			const DirectX::XMFLOAT3& t = vertex.Tangent;
+			finite = finite && isfinite(t.x) && isfinite(t.y) && isfinite(t.z);
+			unit = unit && fabsf(t.x * t.x + t.y * t.y + t.z * t.z - 1.0f) < 1e-4f;
+		}
+	}
+	CHECK(finite);
+	CHECK(unit);
+
+	// The bad triangles don't disturb the good grid next to them
+	std::vector<Vertex> grid(vertices.begin(), vertices.begin() + gridVertices);
+	std::vector<int> gridIndices(indices.begin(), indices.begin() + 7 * 7 * 6);
+	Mesh::CalculateTangents(&grid[0], gridVertices, &gridIndices[0], (int)gridIndices.size());
+	bool same = true;
+	for (int i = 0; i < gridVertices; i++)
+		same = same && memcmp(&grid[i].Tangent, &fast[i].Tangent, sizeof(grid[i].Tangent)) == 0;
+	CHECK(same);
+
+	// The fallback is perpendicular to the normal (+X for a +Y normal)
+	const DirectX::XMFLOAT3& fallback = fast[gridVertices].Tangent;
+	CHECK(fabsf(fallback.x - 1.0f) < 1e-6f && fabsf(fallback.y) < 1e-6f && fabsf(fallback.z) < 1e-6f);
+}
+
+TEST(MeshPacksSmallIndicesTo16Bits)
+{
+	int indices[] = { 0, 65535, 3, 70 };
+	std::vector<unsigned short> packed;
+	CHECK(Mesh::PackIndices(indices, 4, 65536, packed) == DXGI_FORMAT_R16_UINT);
+	CHECK(packed == std::vector<unsigned short>({ 0, 65535, 3, 70 }));
+
+	// One vertex too many for 16 bits
+	CHECK(Mesh::PackIndices(indices, 4, 65537, packed) == DXGI_FORMAT_R32_UINT);
+	CHECK(packed.empty());
+
+	CHECK(Mesh::PackIndices(indices, 0, 3, packed) == DXGI_FORMAT_R32_UINT);
+	CHECK(packed.empty());
+}
+
+TEST(MeshIndexBufferMatchesItsFormat)
+{
+	TestDevice device;
+	CHECK(device.GetDevice());
+
+	// 65536 vertices is the most 16-bit indices can reach
+	int sizes[] = { 4, 65536, 65537 };
+	for (int vertexCount : sizes)
+	{
+		std::vector<Vertex> vertices;
+		std::vector<int> indices;
+		MakeStrip(vertexCount, 100, vertices, indices);
+		Mesh mesh(&vertices[0], vertexCount, &indices[0], (int)indices.size(), device.GetDevice(), device.GetContext());
+
+		bool small = vertexCount <= 65536;
+		CHECK(mesh.GetIndexFormat() == (small ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT));
+		CHECK(mesh.GetIndexCount() == (int)indices.size());
+
+		D3D11_BUFFER_DESC desc = {};
+		CHECK(mesh.GetIndexBuffer());
+		if (!mesh.GetIndexBuffer())
+			continue;
+		mesh.GetIndexBuffer()->GetDesc(&desc);
+		CHECK(desc.ByteWidth == indices.size() * (small ? 2 : 4));
+		CHECK((desc.BindFlags & D3D11_BIND_INDEX_BUFFER) != 0);
+
+		// And the indices survive the trip in either size
+		std::vector<unsigned char> bytes = device.ReadBuffer(mesh.GetIndexBuffer());
+		CHECK(bytes.size() == desc.ByteWidth);
+		bool same = bytes.size() == desc.ByteWidth;
+		for (size_t i = 0; same && i < indices.size(); i++)
+		{
+			unsigned int value = 0;
+			if (small)
+				value = ((unsigned short*)&bytes[0])[i];
+			else
+				memcpy(&value, &bytes[i * 4], 4);
+			same = value == (unsigned int)indices[i];
+		}
+		CHECK(same);
+	}
+}
+
+// Times the 4-wide tangents against the plain ones, on one
+// and on every thread
+static void CompareTangents(int quadsPerSide, int runs)
+{
+	std::vector<Vertex> vertices;
+	std::vector<int> indices;
+	MakeGrid(quadsPerSide, vertices, indices);
+	int triangles = (int)indices.size() / 3;
+	printf("  %d vertices, %d triangles\n", (int)vertices.size(), triangles);
+
+	double reference = TestRegistry::Time([&]() { Mesh::CalculateTangentsReference(&vertices[0], (int)vertices.size(), &indices[0], (int)indices.size()); }, runs);
+	printf("    reference       %9.3f ms  %6.2f ns/triangle\n", reference, reference * 1e6 / triangles);
+
+	int threadCounts[] = { 1, 0 };
+	for (int threads : threadCounts)
+	{
+		ThreadPool::SetThreadCount(threads);
+		double fast = TestRegistry::Time([&]() { Mesh::CalculateTangents(&vertices[0], (int)vertices.size(), &indices[0], (int)indices.size()); }, runs);
+		printf("    4-wide, %2d thr  %9.3f ms  %6.2f ns/triangle  (%.2fx)\n", ThreadPool::GetInstance().GetThreadCount(), fast, fast * 1e6 / triangles, reference / fast);
+	}
+	ThreadPool::SetThreadCount(0);
+}
+
+TEST(MeshPositionStreamMatchesTheVertices)
+{
+	TestDevice device;
+	CHECK(device.GetDevice());
+
+	const char* path = "MeshPositionStreamTest.obj";
+	WriteTestFile(path,
+		"v -1.5 0 2\nv 1 0.25 2\nv 1 3 -2\nv -1 2 -2.75\n"
+		"vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+		"vn 0 1 0\n"
+		"f 1/1/1 2/2/1 3/3/1 4/4/1\n");
+
+	for (int packed = 0; packed < 2; packed++)
+	{
+		Mesh mesh(path, device.GetDevice(), false, packed != 0, true, false);
+		CHECK(mesh.HasPackedVertices() == (packed != 0));
+		CHECK(mesh.GetPositionBuffer());
+		if (!mesh.GetPositionBuffer())
+			continue;
+
+		std::vector<unsigned char> vertexBytes = device.ReadBuffer(mesh.GetVertexBuffer());
+		std::vector<unsigned char> positionBytes = device.ReadBuffer(mesh.GetPositionBuffer());
+		size_t vertexSize = packed ? sizeof(PackedVertex) : sizeof(Vertex);
+		size_t positionSize = packed ? sizeof(PackedPosition) : sizeof(DirectX::XMFLOAT3);
+		size_t vertexCount = vertexBytes.size() / vertexSize;
+		CHECK(vertexCount == 4);
+		CHECK(positionBytes.size() == vertexCount * positionSize);
+		if (positionBytes.size() != vertexCount * positionSize)
+			continue;
+
+		// Position comes first in both vertex formats, in the same encoding
+		bool same = true;
+		for (size_t i = 0; i < vertexCount; i++)
+			same = same && memcmp(&positionBytes[i * positionSize], &vertexBytes[i * vertexSize], positionSize) == 0;
+		CHECK(same);
+
+		// And the unpacked positions are the file's (with z flipped)
+		if (!packed)
+		{
+			const DirectX::XMFLOAT3* positions = (const DirectX::XMFLOAT3*)&positionBytes[0];
+			CHECK(positions[0].x == -1.5f && positions[0].y == 0.0f && positions[0].z == -2.0f);
+		}
+	}
+
+	// Without one, there's no extra buffer
+	Mesh withoutStream(path, device.GetDevice(), false, false, false, false);
+	CHECK(!withoutStream.GetPositionBuffer());
+
+	remove(MeshFile::GetCachePath(path, 0).c_str());
+	remove(path);
+}
+
+BENCHMARK(MeshTangents)
+{
+	// Fits in cache, then 2097152 triangles (about 45 MB of vertices)
+	CompareTangents(64, 50);
+	CompareTangents(1024, 5);
+}
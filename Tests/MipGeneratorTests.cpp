@@ -0,0 +1,108 @@
+#include "TestFramework.h"
+#include "MipGenerator.h"
+
+static MipLevel MakeNoise(unsigned int width, unsigned int height)
+{
+	MipLevel level = { width, height };
+	level.pixels.resize((size_t)width * height * 4);
+	unsigned int seed = width * 31 + height;
+	for (unsigned char& value : level.pixels)
+	{
+		seed = seed * 1664525 + 1013904223;
+		value = (unsigned char)(seed >> 24);
+	}
+	return level;
+}
+
+TEST(MipDownsampleMatchesReference)
+{
+	// Odd sizes, single rows and columns, and ones big enough to
+	// be split across the thread pool
+	unsigned int sizes[][2] =
+	{
+		{ 1, 1 }, { 2, 2 }, { 3, 3 }, { 7, 5 }, { 9, 1 }, { 1, 17 },
+		{ 64, 64 }, { 130, 67 }, { 513, 300 },
+	};
+	for (auto& size : sizes)
+	{
+		MipLevel source = MakeNoise(size[0], size[1]);
+		MipLevel fast;
+		MipLevel reference;
+		MipGenerator::Downsample(source, fast);
+		MipGenerator::DownsampleReference(source, reference);
+		CHECK(fast.width == reference.width && fast.height == reference.height);
+		CHECK(fast.pixels == reference.pixels);
+	}
+}
+
+TEST(MipDownsampleRoundsToNearest)
+{
+	MipLevel source = { 2, 2 };
+	source.pixels =
+	{
+		0, 255, 10, 1,		1, 255, 10, 1,
+		1, 254, 11, 2,		1, 254, 11, 1,
+	};
+	MipLevel destination;
+	MipGenerator::DownsampleReference(source, destination);
+	CHECK(destination.width == 1 && destination.height == 1);
+
+	// 3/4 rounds up, 254.5 and 10.5 go up, 5/4 down
+	CHECK(destination.pixels == std::vector<unsigned char>({ 1, 255, 11, 1 }));
+}
+
+TEST(MipChainGoesDownToOne)
+{
+	std::vector<MipLevel> levels(1, MakeNoise(37, 20));
+	MipGenerator::GenerateMips(levels);
+
+	// 37x20, 18x10, 9x5, 4x2, 2x1, 1x1
+	CHECK(levels.size() == 6);
+	for (size_t i = 1; i < levels.size(); i++)
+	{
+		unsigned int width = levels[i - 1].width > 1 ? levels[i - 1].width / 2 : 1;
+		unsigned int height = levels[i - 1].height > 1 ? levels[i - 1].height / 2 : 1;
+		CHECK(levels[i].width == width && levels[i].height == height);
+		CHECK(levels[i].pixels.size() == (size_t)width * height * 4);
+	}
+	CHECK(levels.back().width == 1 && levels.back().height == 1);
+}
+
+// FNV-1a of a level's pixels
+static unsigned int Checksum(const MipLevel& level)
+{
+	unsigned int hash = 2166136261u;
+	for (unsigned char value : level.pixels)
+	{
+		hash ^= value;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+TEST(MipChainMatchesKnownChecksums)
+{
+	// The filter is exact integer math, so these are the same on every
+	// platform and with or without SSE2 - a change here changes the art
+	const unsigned int expected[] =
+	{
+		0xae82d5e7u, 0xfd4df067u, 0x75cac540u, 0xad57f153u, 0x40550779u,
+		0xea015b4bu, 0x57a784b0u, 0xff3120deu, 0xdae03f97u,
+	};
+
+	// 300x200 down to 1x1
+	std::vector<MipLevel> levels(1, MakeNoise(300, 200));
+	MipGenerator::GenerateMips(levels);
+	CHECK(levels.size() == sizeof(expected) / sizeof(expected[0]));
+
+	MipLevel reference = levels[0];
+	for (size_t i = 0; i < levels.size() && i < sizeof(expected) / sizeof(expected[0]); i++)
+	{
+		CHECK(Checksum(levels[i]) == expected[i]);
+		CHECK(Checksum(reference) == expected[i]);
+
+		MipLevel next;
+		MipGenerator::DownsampleReference(reference, next);
+		reference = next;
+	}
+}
@@ -0,0 +1,381 @@
+#include "TestFramework.h"
+#include "ObjLoader.h"
+#include "ThreadPool.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+
+static bool Near(float a, float b)
+{
+	return fabsf(a - b) <= 1e-6f * (1.0f + fabsf(b));
+}
+
+// --------------------------------------------------------
+// A flat grid of quadsPerSide x quadsPerSide quads, two
+// triangles each, with a uv and shared normal per corner.
+// 1024 per side is about two million faces and 160 MB.
+// --------------------------------------------------------
+static void WriteGridObj(const char* path, int quadsPerSide)
+{
+	FILE* out = fopen(path, "wb");
+	if (!out)
+		return;
+
+	int side = quadsPerSide + 1;
+	fprintf(out, "# %d x %d grid\n", quadsPerSide, quadsPerSide);
+	for (int y = 0; y < side; y++)
+	{
+		for (int x = 0; x < side; x++)
+		{
+			float u = (float)x / quadsPerSide;
+			float v = (float)y / quadsPerSide;
+			fprintf(out, "v %f %f %f\n", u * 100.0f - 50.0f, sinf(u * 20.0f) * cosf(v * 20.0f), v * 100.0f - 50.0f);
+			fprintf(out, "vt %f %f\n", u, v);
+		}
+	}
+	fprintf(out, "vn 0.000000 1.000000 0.000000\n");
+
+	for (int y = 0; y < quadsPerSide; y++)
+	{
+		for (int x = 0; x < quadsPerSide; x++)
+		{
+			int a = y * side + x + 1;
+			int b = a + 1;
+			int c = a + side;
+			int d = c + 1;
+			fprintf(out, "f %d/%d/1 %d/%d/1 %d/%d/1\n", a, a, c, c, b, b);
+			fprintf(out, "f %d/%d/1 %d/%d/1 %d/%d/1\n", b, b, c, c, d, d);
+		}
+	}
+	fclose(out);
+}
+
+static long long GetFileSize(const char* path)
+{
+	std::ifstream in(path, std::ios::binary | std::ios::ate);
+	return in ? (long long)in.tellg() : 0;
+}
+
+// --------------------------------------------------------
+// The old loader's approach, for comparison: getline into a
+// 100 character buffer and sscanf each line.  Triangles
+// with v/vt/vn corners only, and no vertex sharing.
+// --------------------------------------------------------
+static size_t LoadWithGetline(const char* path)
+{
+	std::ifstream obj(path);
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<DirectX::XMFLOAT3> normals;
+	std::vector<DirectX::XMFLOAT2> uvs;
+	std::vector<Vertex> verts;
+	char chars[100];
+	while (obj.good())
+	{
+		obj.getline(chars, 100);
+		if (chars[0] == 'v' && chars[1] == 'n')
+		{
+			DirectX::XMFLOAT3 norm;
+			sscanf(chars, "vn %f %f %f", &norm.x, &norm.y, &norm.z);
+			normals.push_back(norm);
+		}
+		else if (chars[0] == 'v' && chars[1] == 't')
+		{
+			DirectX::XMFLOAT2 uv;
+			sscanf(chars, "vt %f %f", &uv.x, &uv.y);
+			uvs.push_back(uv);
+		}
+		else if (chars[0] == 'v')
+		{
+			DirectX::XMFLOAT3 pos;
+			sscanf(chars, "v %f %f %f", &pos.x, &pos.y, &pos.z);
+			positions.push_back(pos);
+		}
+		else if (chars[0] == 'f')
+		{
+			unsigned int i[9];
+			if (sscanf(chars, "f %u/%u/%u %u/%u/%u %u/%u/%u", &i[0], &i[1], &i[2], &i[3], &i[4], &i[5], &i[6], &i[7], &i[8]) != 9)
+				continue;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				Vertex v = {};
+				v.Position = positions[i[corner * 3] - 1];
+				v.UV = uvs[i[corner * 3 + 1] - 1];
+				v.Normal = normals[i[corner * 3 + 2] - 1];
+				verts.push_back(v);
+			}
+		}
+	}
+	return verts.size();
+}
+
+// --------------------------------------------------------
+// groupCount groups of three positions, uvs and a normal,
+// each followed by a triangle using them and (after the
+// first) one that reaches back into the group before.
+// relative writes those as negative indices, otherwise they
+// are absolute.  Each group is about 150 bytes.
+// --------------------------------------------------------
+static std::string MakeGroupsObj(int groupCount, bool relative)
+{
+	std::string text;
+	char line[128];
+	for (int g = 0; g < groupCount; g++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			snprintf(line, sizeof(line), "v %d.5 %d.25 %d\nvt 0.%d 0.%d\n", g, c, g % 7, c + 1, g % 10);
+			text += line;
+		}
+		snprintf(line, sizeof(line), "vn 0 %d 1\n", g % 3);
+		text += line;
+
+		int p = g * 3 + 1; // First position (and uv) of this group
+		int n = g + 1;
+		if (relative)
+			snprintf(line, sizeof(line), "f -3/-3/-1 -2/-2/-1 -1/-1/-1\n");
+		else
+			snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n", p, p, n, p + 1, p + 1, n, p + 2, p + 2, n);
+		text += line;
+
+		if (g > 0)
+		{
+			if (relative)
+				snprintf(line, sizeof(line), "f -6/-5/-2 -4/-4/-2 -1/-1/-1\n");
+			else
+				snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n", p - 3, p - 2, n - 1, p - 1, p - 1, n - 1, p + 2, p + 2, n);
+			text += line;
+		}
+	}
+	return text;
+}
+
+// Times both loaders on one file and prints the throughput
+static void CompareLoaders(const char* path, int runs)
+{
+	double megabytes = GetFileSize(path) / (1024.0 * 1024.0);
+	MeshData data;
+	ObjLoadStats stats = {};
+	double mapped = TestRegistry::Time([&]() { data = MeshData(); ObjLoader::Load(path, data, &stats); }, runs);
+	double getline = TestRegistry::Time([&]() { LoadWithGetline(path); }, runs);
+
+	printf("  %s: %.1f MB, %zu triangles\n", path, megabytes, data.indices.size() / 3);
+	printf("    %zu vertices shared down to %zu (%.1f MB less)\n", stats.unsharedVertices, stats.sharedVertices,
+		(stats.unsharedVertices - stats.sharedVertices) * sizeof(Vertex) / (1024.0 * 1024.0));
+	printf("    ObjLoader         %9.2f ms  %8.1f MB/s\n", mapped, megabytes / (mapped / 1000.0));
+	printf("    getline + sscanf  %9.2f ms  %8.1f MB/s  (%.1fx slower)\n", getline, megabytes / (getline / 1000.0), getline / mapped);
+}
+
+TEST(ObjLoaderReadsEveryAttribute)
+{
+	// Comments, blank lines, tabs, CRLF, exponents, and no final newline
+	const char* path = "ObjLoaderAttributesTest.obj";
+	WriteTestFile(path,
+		"# exported by hand\r\n"
+		"\r\n"
+		"v 1.5 -2.25 3\r\n"
+		"v\t-0.5e1  4.0e-1 +7\r\n"
+		"v 0 0 0 1.0\r\n"
+		"vt 0.25 0.75\r\n"
+		"vt 1 0\r\n"
+		"vt 0 1\r\n"
+		"vn 0 0 1\r\n"
+		"o object\r\n"
+		"s off\r\n"
+		"f 1/1/1 2/2/1 3/3/1 # trailing comment");
+
+	MeshData data;
+	CHECK(ObjLoader::Load(path, data));
+	CHECK(data.vertices.size() == 3);
+	CHECK(data.indices.size() == 3);
+	if (data.vertices.size() == 3 && data.indices.size() == 3)
+	{
+		// The winding is flipped, so the first corner stays first
+		const Vertex& first = data.vertices[data.indices[0]];
+		CHECK(Near(first.Position.x, 1.5f) && Near(first.Position.y, -2.25f) && Near(first.Position.z, -3.0f));
+		CHECK(Near(first.UV.x, 0.25f) && Near(first.UV.y, 0.25f));
+		CHECK(first.Normal.x == 0 && first.Normal.y == 0 && first.Normal.z == -1);
+
+		// Z (and uv v) flipped into the left-handed space
+		const Vertex& second = data.vertices[data.indices[2]];
+		CHECK(Near(second.Position.x, -5.0f) && Near(second.Position.y, 0.4f) && Near(second.Position.z, -7.0f));
+		CHECK(Near(second.UV.x, 1.0f) && Near(second.UV.y, 1.0f));
+	}
+	remove(path);
+}
+
+TEST(ObjLoaderReadsLongLines)
+{
+	// The old loader cut every line off at 100 characters
+	const char* path = "ObjLoaderLongLineTest.obj";
+	WriteTestFile(path,
+		"v 0.000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001 0 0\n"
+		"v 1.000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000 0 0\n"
+		"v 0.999999999999999999999999999999999999999999999999999999999999999999999999999999999999999999999 1 0\n"
+		"f 1 2 3\n");
+
+	MeshData data;
+	CHECK(ObjLoader::Load(path, data));
+	CHECK(data.indices.size() == 3);
+	if (data.indices.size() == 3)
+	{
+		CHECK(Near(data.vertices[data.indices[0]].Position.x, 0.0f));
+		CHECK(Near(data.vertices[data.indices[2]].Position.x, 1.0f));
+		CHECK(Near(data.vertices[data.indices[1]].Position.x, 1.0f));
+		CHECK(data.vertices[data.indices[1]].Position.y == 1.0f);
+	}
+	remove(path);
+}
+
+TEST(ObjLoaderReadsTheSphere)
+{
+	MeshData data;
+	CHECK(ObjLoader::Load(TestRegistry::GetAssetPath("Models/sphere.obj").c_str(), data));
+	CHECK(!data.indices.empty() && data.indices.size() % 3 == 0);
+
+	// Unit sphere, so every normal is unit length too
+	bool onSphere = true;
+	for (Vertex& v : data.vertices)
+	{
+		float radius = sqrtf(v.Position.x * v.Position.x + v.Position.y * v.Position.y + v.Position.z * v.Position.z);
+		float normal = sqrtf(v.Normal.x * v.Normal.x + v.Normal.y * v.Normal.y + v.Normal.z * v.Normal.z);
+		onSphere = onSphere && fabsf(radius - 1.0f) < 1e-3f && fabsf(normal - 1.0f) < 1e-3f;
+	}
+	CHECK(onSphere);
+}
+
+TEST(ObjLoaderSharesCorners)
+{
+	const char* path = "ObjLoaderSharingTest.obj";
+	WriteTestFile(path,
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+		"vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+		"vn 0 0 -1\n"
+		"f 1/1/1 2/2/1 3/3/1 4/4/1\n"
+		"f 1/1/1 3/3/1 4/1/1\n");
+
+	MeshData data;
+	ObjLoadStats stats = {};
+	CHECK(ObjLoader::Load(path, data, &stats));
+
+	// The quad is two triangles sharing an edge.  The last face
+	// reuses two of its corners, but 4/1/1 has a different uv.
+	CHECK(data.vertices.size() == 5);
+	CHECK(data.indices.size() == 9);
+	CHECK(stats.unsharedVertices == 9);
+	CHECK(stats.sharedVertices == 5);
+	CHECK(stats.chunkCount == 1);
+	CHECK(stats.skippedFaces == 0);
+	remove(path);
+}
+
+TEST(ObjLoaderTriangulatesPolygons)
+{
+	// A pentagon with v/vt corners and a quad with bare v corners
+	const char* path = "ObjLoaderPolygonTest.obj";
+	WriteTestFile(path,
+		"v 0 0 0\nv 2 0 0\nv 3 1 0\nv 1 2 0\nv -1 1 0\n"
+		"vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+		"f 1/1 2/2 3/3 4/4 5/1\n"
+		"f -5 -4 -3 -2\n");
+
+	MeshData data;
+	ObjLoadStats stats = {};
+	CHECK(ObjLoader::Load(path, data, &stats));
+
+	// A fan of three and one of two
+	CHECK(data.indices.size() == (3 + 2) * 3);
+	CHECK(stats.skippedFaces == 0);
+
+	// Flat normals were made for both, facing -z once flipped
+	for (Vertex& v : data.vertices)
+	{
+		CHECK(v.Normal.x == 0 && v.Normal.y == 0 && fabsf(v.Normal.z) == 1);
+	}
+	remove(path);
+}
+
+TEST(ObjLoaderFallsBackToFlatNormals)
+{
+	// vn indices past the file's own normals are ignored
+	const char* path = "ObjLoaderNormalsTest.obj";
+	WriteTestFile(path,
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\nv 0 0 1\n"
+		"f 1//1 4//1 2//1\n"
+		"f 1 2 9\n");
+
+	MeshData data;
+	ObjLoadStats stats = {};
+	CHECK(ObjLoader::Load(path, data, &stats));
+	CHECK(data.vertices.size() == 3);
+	for (Vertex& v : data.vertices)
+	{
+		CHECK(v.Normal.x == 0 && fabsf(v.Normal.y) == 1 && v.Normal.z == 0);
+	}
+
+	// The face using a position that isn't there is dropped
+	CHECK(stats.skippedFaces == 1);
+	remove(path);
+
+	CHECK(!ObjLoader::Load("NoSuchFile.obj", data));
+}
+
+TEST(ObjLoaderResolvesRelativeIndicesAcrossChunks)
+{
+	// About 6 MB, so four threads get a chunk each and plenty of
+	// faces refer back into the chunk before theirs
+	const char* relativePath = "ObjLoaderRelativeTest.obj";
+	const char* absolutePath = "ObjLoaderAbsoluteTest.obj";
+	WriteTestFile(relativePath, MakeGroupsObj(40000, true));
+	WriteTestFile(absolutePath, MakeGroupsObj(40000, false));
+
+	ThreadPool::SetThreadCount(4);
+	MeshData relative;
+	MeshData absolute;
+	ObjLoadStats stats = {};
+	CHECK(ObjLoader::Load(relativePath, relative, &stats));
+	CHECK(ObjLoader::Load(absolutePath, absolute));
+	ThreadPool::SetThreadCount(0);
+
+	CHECK(stats.chunkCount == 4);
+	CHECK(stats.skippedFaces == 0);
+	CHECK(relative.indices.size() == (40000 * 2 - 1) * 3);
+	CHECK(relative.indices == absolute.indices);
+	CHECK(relative.vertices.size() == absolute.vertices.size());
+	CHECK(relative.vertices.size() == absolute.vertices.size()
+		&& memcmp(&relative.vertices[0], &absolute.vertices[0], sizeof(Vertex) * relative.vertices.size()) == 0);
+
+	remove(relativePath);
+	remove(absolutePath);
+}
+
+BENCHMARK(ObjLoaderThroughput)
+{
+	CompareLoaders(TestRegistry::GetAssetPath("Models/sphere.obj").c_str(), 20);
+
+	const char* path = "ObjLoaderBenchmark.obj";
+	WriteGridObj(path, 1024);
+	CompareLoaders(path, 3);
+	remove(path);
+}
+
+BENCHMARK(ObjLoaderThreadScaling)
+{
+	const char* path = "ObjLoaderScalingBenchmark.obj";
+	WriteGridObj(path, 1024);
+	double megabytes = GetFileSize(path) / (1024.0 * 1024.0);
+	printf("  %.1f MB, 2097152 triangles\n", megabytes);
+
+	double oneThread = 0;
+	int threadCounts[] = { 1, 2, 4, 8 };
+	for (int threads : threadCounts)
+	{
+		ThreadPool::SetThreadCount(threads);
+		double milliseconds = TestRegistry::Time([&]() { MeshData data; ObjLoader::Load(path, data); }, 3);
+		if (threads == 1)
+			oneThread = milliseconds;
+		printf("    %d threads  %9.2f ms  %8.1f MB/s  (%.2fx)\n", threads, milliseconds, megabytes / (milliseconds / 1000.0), oneThread / milliseconds);
+	}
+	ThreadPool::SetThreadCount(0);
+	remove(path);
+}
@@ -0,0 +1,211 @@
+#include "TestFramework.h"
+#include "ParticlePool.h"
+#include "ThreadPool.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+using namespace DirectX;
+
+// Spawns a burst every frame and updates, so the ring fills up,
+// retires particles and wraps around the end a few times
+static void RunBursts(ParticlePool& pool, int framesToRun, int spawnsPerFrame)
+{
+	unsigned int seed = 12345;
+	for (int frame = 0; frame < framesToRun; frame++)
+	{
+		for (int i = 0; i < spawnsPerFrame; i++)
+		{
+			seed = seed * 1664525 + 1013904223;
+			float vx = (int)(seed >> 8 & 0xFFFF) / 65535.0f - 0.5f;
+			float vy = (int)(seed >> 16 & 0xFF) / 255.0f;
+			pool.Spawn(XMFLOAT3((float)i, 0, 0), XMFLOAT3(vx, vy, -vx));
+		}
+		pool.Update(0.016f, 0.5f);
+	}
+}
+
+static bool SameFloats(const float* a, const float* b, int count)
+{
+	return memcmp(a, b, sizeof(float) * count) == 0;
+}
+
+TEST(ParticleKernelsGiveIdenticalResults)
+{
+	// One pool small enough for a single run, and one with several
+	// chunks (and a capacity that isn't a multiple of 8)
+	int capacities[] = { 1000, PARTICLE_CHUNK_SIZE * 2 + 13 };
+	for (int capacity : capacities)
+	{
+		ParticlePool scalar(capacity);
+		scalar.SetKernel(ScalarKernel);
+		RunBursts(scalar, 60, capacity / 25);
+
+		for (int k = SSE4Kernel; k <= ParticlePool::GetBestKernel(); k++)
+		{
+			ParticlePool pool(capacity);
+			pool.SetKernel((ParticleKernel)k);
+			CHECK(pool.GetKernel() == k);
+			RunBursts(pool, 60, capacity / 25);
+
+			CHECK(pool.GetLivingCount() == scalar.GetLivingCount());
+			CHECK(SameFloats(pool.positionX, scalar.positionX, capacity));
+			CHECK(SameFloats(pool.positionY, scalar.positionY, capacity));
+			CHECK(SameFloats(pool.positionZ, scalar.positionZ, capacity));
+			CHECK(SameFloats(pool.age, scalar.age, capacity));
+		}
+	}
+}
+
+// Spawns until every particle is alive, each with its own velocity
+static void FillPool(ParticlePool& pool)
+{
+	unsigned int seed = 777;
+	for (int i = 0; i < pool.GetCapacity(); i++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		float v = (int)(seed >> 16) / 65535.0f - 0.5f;
+		pool.Spawn(XMFLOAT3((float)(i & 63), 0, 0), XMFLOAT3(v, 1.0f, -v));
+	}
+}
+
+TEST(ParticlePoolRetiresOldestFirstAndWraps)
+{
+	ParticlePool pool(8);
+	for (int i = 0; i < 6; i++)
+		CHECK(pool.Spawn(XMFLOAT3((float)i, 0, 0), XMFLOAT3(1, 0, 0)));
+	pool.Update(1.0f, 2.5f);
+
+	// Moves by velocity times age: 0 + 1 * 1
+	CHECK(pool.positionX[0] == 1.0f);
+
+	CHECK(pool.Spawn(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0)));
+	CHECK(pool.Spawn(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0)));
+	CHECK(!pool.Spawn(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0)));
+	CHECK(pool.GetLivingCount() == 8);
+
+	// Then 1 + 1 * 2
+	pool.Update(1.0f, 2.5f);
+	CHECK(pool.positionX[0] == 3.0f);
+
+	// The first six reach the life span together and the two younger stay
+	pool.Update(1.0f, 2.5f);
+	CHECK(pool.GetLivingCount() == 2);
+	CHECK(pool.positionX[0] == 3.0f); // Dead particles keep their last position
+
+	for (int i = 0; i < 3; i++)
+		CHECK(pool.Spawn(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0)));
+
+	int start[2];
+	int count[2];
+	CHECK(pool.GetLiveRuns(start, count) == 2);
+	CHECK(start[0] == 6 && count[0] == 2);
+	CHECK(start[1] == 0 && count[1] == 3);
+
+	std::vector<int> chunkStart;
+	std::vector<int> chunkCount;
+	CHECK(pool.GetLiveChunks(2, chunkStart, chunkCount) == 3);
+	CHECK(chunkStart == std::vector<int>({ 6, 0, 2 }));
+	CHECK(chunkCount == std::vector<int>({ 2, 2, 1 }));
+
+	// The wrapped pair dies next, leaving the three new ones as one run
+	pool.Update(1.0f, 2.5f);
+	CHECK(pool.GetLiveRuns(start, count) == 1);
+	CHECK(start[0] == 0 && count[0] == 3);
+}
+
+TEST(ParticlePoolEmptyHasNoRuns)
+{
+	ParticlePool pool(16);
+	int start[2];
+	int count[2];
+	std::vector<int> chunkStart;
+	std::vector<int> chunkCount;
+	CHECK(pool.GetLiveRuns(start, count) == 0);
+	CHECK(pool.GetLiveChunks(4, chunkStart, chunkCount) == 0);
+
+	// Updating nothing is fine too
+	pool.Update(1.0f, 1.0f);
+	CHECK(pool.GetLivingCount() == 0);
+}
+
+TEST(ParticlePoolWritesRecords)
+{
+	CHECK(ParticlePool::PackColor(XMFLOAT4(1, 0, 0.5f, 2)) == 0xFF8000FF);
+	CHECK(ParticlePool::PackColor(XMFLOAT4(-1, 1, 0, 0)) == 0x0000FF00);
+
+	ParticlePool pool(4);
+	pool.Spawn(XMFLOAT3(1, 2, 3), XMFLOAT3(0, 0, 0));
+	pool.Spawn(XMFLOAT3(4, 5, 6), XMFLOAT3(0, 0, 0));
+	pool.Update(0.25f, 1.0f);
+
+	ParticleRecord records[4] = {};
+	pool.WriteRecords(1, 1, 2.0f, 0x12345678, records);
+	CHECK(records[0].Size == 0.0f); // Only the one asked for
+	CHECK(records[1].Position.x == 4 && records[1].Position.y == 5 && records[1].Position.z == 6);
+	CHECK(records[1].Age == 0.25f);
+	CHECK(records[1].Size == 2.0f);
+	CHECK(records[1].Color == 0x12345678);
+}
+
+BENCHMARK(ParticlePoolUpdate)
+{
+	// One thread, so this is the cost of the pass itself (see
+	// ParticlePoolThreadScaling for what the chunks add).  The life
+	// span is long enough that every particle stays alive.  Each
+	// kernel the CPU runs takes a turn, against the scalar one.
+	static const char* kernelNames[] = { "scalar", "SSE4", "AVX2" };
+	ThreadPool::SetThreadCount(1);
+	int particleCounts[] = { 1000, 10000, 100000, 1000000 };
+	for (int particles : particleCounts)
+	{
+		ParticlePool pool(particles);
+		FillPool(pool);
+		double scalar = 0;
+		for (int k = ScalarKernel; k <= ParticlePool::GetBestKernel(); k++)
+		{
+			pool.SetKernel((ParticleKernel)k);
+			double milliseconds = TestRegistry::Time([&]() { pool.Update(0.016f, 1e9f); }, particles < 100000 ? 50 : 10);
+			if (k == ScalarKernel)
+				scalar = milliseconds;
+			printf("    %7d particles  %-6s  %8.3f ms  %6.2f ns/particle  (%.2fx)\n",
+				particles, kernelNames[k], milliseconds, milliseconds * 1e6 / particles, scalar / milliseconds);
+		}
+	}
+	ThreadPool::SetThreadCount(0);
+}
+
+BENCHMARK(ParticlePoolThreadScaling)
+{
+	// The particle manager's frame: update the pool, then pack every
+	// live particle's record, both split into chunks across the pool
+	int particleCounts[] = { 500000, 1000000 };
+	int threadCounts[] = { 1, 2, 4, 8, 16 };
+	for (int particles : particleCounts)
+	{
+		ParticlePool pool(particles);
+		FillPool(pool);
+		std::vector<ParticleRecord> records(particles);
+
+		double oneThread = 0;
+		for (int threads : threadCounts)
+		{
+			ThreadPool::SetThreadCount(threads);
+			double update = TestRegistry::Time([&]() { pool.Update(0.016f, 1e9f); }, 10);
+			double write = TestRegistry::Time([&]()
+			{
+				std::vector<int> start;
+				std::vector<int> count;
+				int chunks = pool.GetLiveChunks(PARTICLE_CHUNK_SIZE, start, count);
+				ThreadPool::GetInstance().ParallelFor(chunks, [&](int chunk)
+				{
+					pool.WriteRecords(start[chunk], count[chunk], 0.5f, 0xFFFFFFFF, &records[0]);
+				});
+			}, 10);
+			if (threads == 1)
+				oneThread = update + write;
+			printf("    %7d particles  %2d threads  update %7.3f ms  records %7.3f ms  %5.2f ns/particle  (%.2fx)\n",
+				particles, threads, update, write, (update + write) * 1e6 / particles, oneThread / (update + write));
+		}
+	}
+	ThreadPool::SetThreadCount(0);
+}
@@ -0,0 +1,129 @@
+#include "TestFramework.h"
+#include "ResidencyManager.h"
+
+// Rooms 0 - 1 - 2 - 3 in a line, one asset each.  Loads are
+// queued in pending and finished with FinishLoads(), like the
+// background loader would, and unloads are counted per asset.
+struct Corridor
+{
+	ResidencyManager manager;
+	std::vector<int> pending;
+	int unloads[4] = {};
+
+	Corridor(unsigned long long budget, int prefetchDistance)
+		: manager(budget, prefetchDistance)
+	{
+		for (int room = 0; room < 4; room++)
+		{
+			int asset = manager.AddAsset(
+				[this](int a) { pending.push_back(a); },
+				[this, room]() { unloads[room]++; });
+			manager.AddRoomAsset(room, asset);
+		}
+		for (int room = 0; room < 3; room++)
+			manager.ConnectRooms(room, room + 1);
+	}
+
+	void FinishLoads(unsigned long long bytes)
+	{
+		std::vector<int> finished;
+		finished.swap(pending);
+		for (int asset : finished)
+			manager.AssetLoaded(asset, bytes);
+	}
+};
+
+TEST(ResidencyPrefetchesNeighbors)
+{
+	Corridor corridor(1000, 1);
+	corridor.manager.Update(0);
+	CHECK(corridor.pending == std::vector<int>({ 0, 1 }));
+	CHECK(corridor.manager.GetLoadingCount() == 2);
+
+	corridor.FinishLoads(100);
+	CHECK(corridor.manager.GetResidentCount() == 2);
+	CHECK(corridor.manager.GetResidentBytes() == 200);
+
+	// Under budget, so nothing is dropped walking away
+	corridor.manager.Update(2);
+	corridor.FinishLoads(100);
+	corridor.manager.Update(3);
+	CHECK(corridor.manager.GetResidentCount() == 4);
+	CHECK(corridor.unloads[0] == 0);
+}
+
+TEST(ResidencyEvictsFurthestFirst)
+{
+	Corridor corridor(250, 0);
+	for (int room = 0; room < 3; room++)
+	{
+		corridor.manager.Update(room);
+		corridor.FinishLoads(100);
+	}
+
+	// Room 0 is two doors away and room 1 only one
+	CHECK(corridor.unloads[0] == 1);
+	CHECK(corridor.unloads[1] == 0);
+	CHECK(corridor.manager.GetResidentBytes() == 200);
+	CHECK(corridor.manager.GetPeakResidentBytes() == 300);
+}
+
+TEST(ResidencyKeepsWhatItNeedsOverBudget)
+{
+	// Everything within reach stays, even past the budget
+	Corridor corridor(150, 1);
+	corridor.manager.Update(1);
+	corridor.FinishLoads(100);
+	CHECK(corridor.manager.GetResidentCount() == 3);
+	CHECK(corridor.manager.GetResidentBytes() == 300);
+
+	// Then once they aren't, they go until it's back under
+	corridor.manager.Update(3);
+	CHECK(corridor.unloads[0] == 1);
+	CHECK(corridor.unloads[1] == 1);
+	CHECK(corridor.unloads[2] == 0);
+	CHECK(corridor.manager.GetResidentBytes() == 100);
+}
+
+TEST(ResidencyCancelsLoadsOutOfRange)
+{
+	Corridor corridor(100, 0);
+	corridor.manager.Update(0);
+	corridor.FinishLoads(80);
+	corridor.manager.Update(1); // Asset 1 starts loading...
+	corridor.manager.Update(2); // ...and is out of range before it arrives
+
+	CHECK(corridor.pending == std::vector<int>({ 1, 2 }));
+	corridor.manager.AssetLoaded(2, 80);
+
+	// Over budget: asset 0 is dropped and asset 1 cancelled
+	CHECK(corridor.unloads[0] == 1);
+	CHECK(corridor.manager.GetLoadingCount() == 0);
+	CHECK(corridor.manager.GetResidentBytes() == 80);
+
+	// When it does arrive it's unloaded straight away and never counted
+	corridor.manager.AssetLoaded(1, 80);
+	CHECK(corridor.unloads[1] == 1);
+	CHECK(corridor.manager.GetResidentBytes() == 80);
+	CHECK(corridor.manager.GetResidentCount() == 1);
+}
+
+TEST(ResidencyAlwaysKeepsRoomlessAssets)
+{
+	ResidencyManager manager(10, 0);
+	int loads = 0;
+	int unloads = 0;
+	int asset = manager.AddAsset(
+		[&](int a) { loads++; manager.AssetLoaded(a, 100); },
+		[&]() { unloads++; });
+
+	manager.Update(0);
+	CHECK(asset == 0);
+	CHECK(loads == 1);
+	CHECK(manager.GetResidentCount() == 1);
+
+	manager.SetBudget(0);
+	manager.Update(0);
+	CHECK(unloads == 0);
+	CHECK(manager.GetResidentBytes() == 100);
+}
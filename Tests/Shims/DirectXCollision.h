@@ -0,0 +1,37 @@
+#pragma once
+
+// --------------------------------------------------------
+// The bounding volumes from DirectXCollision, for the CMake
+// build of the tests (see DirectXMath.h here)
+// --------------------------------------------------------
+
+#include "DirectXMath.h"
+
+namespace DirectX
+{
+	struct BoundingBox
+	{
+		XMFLOAT3 Center;
+		XMFLOAT3 Extents;
+
+		BoundingBox() : Center(0, 0, 0), Extents(1.0f, 1.0f, 1.0f) {}
+		BoundingBox(const XMFLOAT3& center, const XMFLOAT3& extents) : Center(center), Extents(extents) {}
+
+		static void CreateFromPoints(BoundingBox& out, FXMVECTOR pt1, FXMVECTOR pt2)
+		{
+			XMVECTOR minimum = XMVectorMin(pt1, pt2);
+			XMVECTOR maximum = XMVectorMax(pt1, pt2);
+			XMStoreFloat3(&out.Center, (minimum + maximum) * 0.5f);
+			XMStoreFloat3(&out.Extents, (maximum - minimum) * 0.5f);
+		}
+	};
+
+	struct BoundingSphere
+	{
+		XMFLOAT3 Center;
+		float Radius;
+
+		BoundingSphere() : Center(0, 0, 0), Radius(1.0f) {}
+		BoundingSphere(const XMFLOAT3& center, float radius) : Center(center), Radius(radius) {}
+	};
+}
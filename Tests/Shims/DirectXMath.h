@@ -0,0 +1,185 @@
+#pragma once
+
+// --------------------------------------------------------
+// Plain C++ stand-in for the parts of DirectXMath the
+// CPU-side code uses, for the CMake build of the tests.
+// Windows builds use the real header from the SDK.
+//
+// XMVECTOR is a compiler vector type rather than __m128, so
+// the operators are the built-in ones.  Comparisons return
+// all-ones/all-zeros lane masks, the same as the real thing.
+// --------------------------------------------------------
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#define XM_CALLCONV
+
+namespace DirectX
+{
+	const float XM_PI = 3.141592654f;
+	const float XM_2PI = 6.283185307f;
+	const float XM_PIDIV2 = 1.570796327f;
+	const float XM_PIDIV4 = 0.785398163f;
+
+	struct XMFLOAT2
+	{
+		float x;
+		float y;
+
+		XMFLOAT2() = default;
+		constexpr XMFLOAT2(float x, float y) : x(x), y(y) {}
+	};
+
+	struct XMFLOAT3
+	{
+		float x;
+		float y;
+		float z;
+
+		XMFLOAT3() = default;
+		constexpr XMFLOAT3(float x, float y, float z) : x(x), y(y), z(z) {}
+	};
+
+	struct XMFLOAT4
+	{
+		float x;
+		float y;
+		float z;
+		float w;
+
+		XMFLOAT4() = default;
+		constexpr XMFLOAT4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+	};
+
+	struct alignas(16) XMFLOAT4A : public XMFLOAT4
+	{
+		XMFLOAT4A() = default;
+		constexpr XMFLOAT4A(float x, float y, float z, float w) : XMFLOAT4(x, y, z, w) {}
+	};
+
+	// A GCC/Clang vector type, so arithmetic and comparisons compile
+	// to SSE/NEON like the real thing, and v[i] reads a single lane
+	typedef float XMVECTOR __attribute__((vector_size(16)));
+	typedef int32_t XMVECTORI __attribute__((vector_size(16)));
+
+	typedef const XMVECTOR& FXMVECTOR;
+	typedef const XMVECTOR& GXMVECTOR;
+	typedef const XMVECTOR& HXMVECTOR;
+	typedef const XMVECTOR& CXMVECTOR;
+
+	namespace Shim
+	{
+		inline uint32_t Bits(float value)
+		{
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			return bits;
+		}
+
+		inline float Float(uint32_t bits)
+		{
+			float value;
+			memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+	}
+
+	// Loads and stores ----------------------------------------
+
+	inline XMVECTOR XMVectorSet(float x, float y, float z, float w) { return XMVECTOR{ x, y, z, w }; }
+	inline XMVECTOR XMVectorZero() { return XMVECTOR{ 0, 0, 0, 0 }; }
+	inline XMVECTOR XMVectorReplicate(float value) { return XMVECTOR{ value, value, value, value }; }
+	inline XMVECTOR XMVectorSplatOne() { return XMVectorReplicate(1.0f); }
+
+	inline XMVECTOR XMLoadFloat(const float* source) { return XMVECTOR{ *source, 0, 0, 0 }; }
+	inline XMVECTOR XMLoadFloat2(const XMFLOAT2* source) { return XMVECTOR{ source->x, source->y, 0, 0 }; }
+	inline XMVECTOR XMLoadFloat3(const XMFLOAT3* source) { return XMVECTOR{ source->x, source->y, source->z, 0 }; }
+	inline XMVECTOR XMLoadFloat4(const XMFLOAT4* source) { return XMVECTOR{ source->x, source->y, source->z, source->w }; }
+	inline XMVECTOR XMLoadFloat4A(const XMFLOAT4A* source) { return XMVECTOR{ source->x, source->y, source->z, source->w }; }
+
+	inline void XMStoreFloat(float* destination, FXMVECTOR v) { *destination = v[0]; }
+	inline void XMStoreFloat2(XMFLOAT2* destination, FXMVECTOR v) { *destination = XMFLOAT2(v[0], v[1]); }
+	inline void XMStoreFloat3(XMFLOAT3* destination, FXMVECTOR v) { *destination = XMFLOAT3(v[0], v[1], v[2]); }
+	inline void XMStoreFloat4(XMFLOAT4* destination, FXMVECTOR v) { *destination = XMFLOAT4(v[0], v[1], v[2], v[3]); }
+	inline void XMStoreFloat4A(XMFLOAT4A* destination, FXMVECTOR v) { *destination = XMFLOAT4A(v[0], v[1], v[2], v[3]); }
+
+	inline float XMVectorGetX(FXMVECTOR v) { return v[0]; }
+	inline float XMVectorGetY(FXMVECTOR v) { return v[1]; }
+	inline float XMVectorGetZ(FXMVECTOR v) { return v[2]; }
+	inline float XMVectorGetW(FXMVECTOR v) { return v[3]; }
+
+	// Arithmetic ---------------------------------------------
+
+	inline XMVECTOR XMVectorAdd(FXMVECTOR a, FXMVECTOR b) { return a + b; }
+	inline XMVECTOR XMVectorSubtract(FXMVECTOR a, FXMVECTOR b) { return a - b; }
+	inline XMVECTOR XMVectorMultiply(FXMVECTOR a, FXMVECTOR b) { return a * b; }
+	inline XMVECTOR XMVectorDivide(FXMVECTOR a, FXMVECTOR b) { return a / b; }
+	inline XMVECTOR XMVectorMultiplyAdd(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c) { return a * b + c; }
+	inline XMVECTOR XMVectorScale(FXMVECTOR a, float scale) { return a * scale; }
+	inline XMVECTOR XMVectorNegate(FXMVECTOR a) { return -a; }
+	inline XMVECTOR XMVectorAbs(FXMVECTOR a) { return (XMVECTOR)((XMVECTORI)a & 0x7FFFFFFF); }
+	inline XMVECTOR XMVectorReciprocal(FXMVECTOR a) { return 1.0f / a; }
+
+	inline XMVECTOR XMVectorSqrt(FXMVECTOR a)
+	{
+#if defined(__SSE__)
+		return (XMVECTOR)_mm_sqrt_ps((__m128)a);
+#else
+		XMVECTOR result;
+		for (int i = 0; i < 4; i++)
+			result[i] = sqrtf(a[i]);
+		return result;
+#endif
+	}
+
+	// Comparisons and masks -----------------------------------
+
+	inline XMVECTOR XMVectorEqual(FXMVECTOR a, FXMVECTOR b) { return (XMVECTOR)(a == b); }
+	inline XMVECTOR XMVectorLess(FXMVECTOR a, FXMVECTOR b) { return (XMVECTOR)(a < b); }
+	inline XMVECTOR XMVectorGreaterOrEqual(FXMVECTOR a, FXMVECTOR b) { return (XMVECTOR)(a >= b); }
+	inline XMVECTOR XMVectorIsNaN(FXMVECTOR a) { return (XMVECTOR)(a != a); }
+	inline XMVECTOR XMVectorIsInfinite(FXMVECTOR a) { return (XMVECTOR)(((XMVECTORI)a & 0x7FFFFFFF) == 0x7F800000); }
+	inline XMVECTOR XMVectorOrInt(FXMVECTOR a, FXMVECTOR b) { return (XMVECTOR)((XMVECTORI)a | (XMVECTORI)b); }
+	inline XMVECTOR XMVectorAndInt(FXMVECTOR a, FXMVECTOR b) { return (XMVECTOR)((XMVECTORI)a & (XMVECTORI)b); }
+
+	// Bits set in control take b, clear ones take a
+	inline XMVECTOR XMVectorSelect(FXMVECTOR a, FXMVECTOR b, FXMVECTOR control)
+	{
+		XMVECTORI mask = (XMVECTORI)control;
+		return (XMVECTOR)(((XMVECTORI)a & ~mask) | ((XMVECTORI)b & mask));
+	}
+
+	// Like minps/maxps, the second value wins when either is NaN
+	inline XMVECTOR XMVectorMin(FXMVECTOR a, FXMVECTOR b) { return XMVectorSelect(b, a, XMVectorLess(a, b)); }
+	inline XMVECTOR XMVectorMax(FXMVECTOR a, FXMVECTOR b) { return XMVectorSelect(b, a, XMVectorLess(b, a)); }
+
+	// 3D vector operations ------------------------------------
+
+	inline XMVECTOR XMVector3Dot(FXMVECTOR a, FXMVECTOR b)
+	{
+		return XMVectorReplicate(a[0] * b[0] + a[1] * b[1] + a[2] * b[2]);
+	}
+
+	inline XMVECTOR XMVector3Cross(FXMVECTOR a, FXMVECTOR b)
+	{
+		return XMVectorSet(
+			a[1] * b[2] - a[2] * b[1],
+			a[2] * b[0] - a[0] * b[2],
+			a[0] * b[1] - a[1] * b[0],
+			0.0f);
+	}
+
+	inline XMVECTOR XMVector3LengthSq(FXMVECTOR v) { return XMVector3Dot(v, v); }
+	inline XMVECTOR XMVector3Length(FXMVECTOR v) { return XMVectorSqrt(XMVector3LengthSq(v)); }
+
+	inline XMVECTOR XMVector3Normalize(FXMVECTOR v)
+	{
+		float length = XMVectorGetX(XMVector3Length(v));
+		return length > 0.0f ? XMVectorScale(v, 1.0f / length) : XMVectorZero();
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+// --------------------------------------------------------
+// Half float conversions from DirectXPackedVector, for the
+// CMake build of the tests (see DirectXMath.h here)
+// --------------------------------------------------------
+
+#include "DirectXMath.h"
+
+namespace DirectX
+{
+	namespace PackedVector
+	{
+		typedef uint16_t HALF;
+
+		// Rounds to nearest even, with denormals, infinity and NaN
+		inline HALF XMConvertFloatToHalf(float value)
+		{
+			uint32_t bits = Shim::Bits(value);
+			uint32_t sign = (bits >> 16) & 0x8000;
+			uint32_t magnitude = bits & 0x7FFFFFFF;
+
+			if (magnitude >= 0x7F800000) // Infinity or NaN
+				return (HALF)(sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0));
+			if (magnitude >= 0x477FF000) // Rounds past the largest half
+				return (HALF)(sign | 0x7C00);
+
+			if (magnitude < 0x38800000) // Denormal (or zero) as a half
+			{
+				if (magnitude < 0x33000000)
+					return (HALF)sign;
+				uint32_t exponent = magnitude >> 23;
+				uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+				uint32_t shift = 126 - exponent;
+				uint32_t half = mantissa >> shift;
+				uint32_t remainder = mantissa & ((1u << shift) - 1);
+				uint32_t midpoint = 1u << (shift - 1);
+				if (remainder > midpoint || (remainder == midpoint && (half & 1)))
+					half++;
+				return (HALF)(sign | half);
+			}
+
+			// Rebias the exponent, then round the dropped 13 bits - a
+			// carry out of the mantissa correctly bumps the exponent
+			uint32_t half = (magnitude - 0x38000000) >> 13;
+			uint32_t remainder = magnitude & 0x1FFF;
+			if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+				half++;
+			return (HALF)(sign | half);
+		}
+
+		inline float XMConvertHalfToFloat(HALF value)
+		{
+			uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+			uint32_t exponent = (value >> 10) & 0x1F;
+			uint32_t mantissa = value & 0x3FF;
+
+			if (exponent == 0x1F)
+				return Shim::Float(sign | 0x7F800000 | (mantissa << 13));
+			if (exponent == 0)
+			{
+				if (mantissa == 0)
+					return Shim::Float(sign);
+
+				// Normalize the denormal
+				exponent = 1;
+				while (!(mantissa & 0x400))
+				{
+					mantissa <<= 1;
+					exponent--;
+				}
+				mantissa &= 0x3FF;
+			}
+			return Shim::Float(sign | ((exponent + 112) << 23) | (mantissa << 13));
+		}
+	}
+}
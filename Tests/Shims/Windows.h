@@ -0,0 +1,250 @@
+#pragma once
+
+// --------------------------------------------------------
+// Stand-in for the few Win32 calls the CPU-side code makes,
+// so the tests build with CMake on Linux and macOS.  Only
+// the Tests CMake build puts this folder on the include
+// path - Windows builds use the real SDK.
+//
+// Files are opened and memory mapped with POSIX calls.
+// A HANDLE points at a ShimHandle holding the descriptor.
+// --------------------------------------------------------
+
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <map>
+#include <mutex>
+
+typedef int BOOL;
+typedef unsigned int UINT;
+typedef unsigned long DWORD;
+typedef long LONG;
+typedef long HRESULT;
+typedef void* HANDLE;
+typedef void* HWND;
+typedef void* HINSTANCE;
+typedef uintptr_t WPARAM;
+typedef intptr_t LPARAM;
+typedef intptr_t LRESULT;
+typedef long long __int64;
+
+#define CALLBACK
+#define WINAPI
+#define TRUE 1
+#define FALSE 0
+#define MAX_PATH 260
+
+#define S_OK ((HRESULT)0)
+#define E_FAIL ((HRESULT)0x80004005L)
+#define E_INVALIDARG ((HRESULT)0x80070057L)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000EL)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+#define INVALID_HANDLE_VALUE ((HANDLE)(intptr_t)-1)
+#define GENERIC_READ 0x80000000u
+#define FILE_SHARE_READ 0x1
+#define OPEN_EXISTING 3
+#define FILE_FLAG_SEQUENTIAL_SCAN 0x08000000
+#define PAGE_READONLY 0x02
+#define FILE_MAP_READ 0x0004
+#define MOVEFILE_REPLACE_EXISTING 0x1
+
+union LARGE_INTEGER
+{
+	long long QuadPart;
+};
+
+struct FILETIME
+{
+	DWORD dwLowDateTime;
+	DWORD dwHighDateTime;
+};
+
+struct WIN32_FILE_ATTRIBUTE_DATA
+{
+	DWORD dwFileAttributes;
+	FILETIME ftCreationTime;
+	FILETIME ftLastAccessTime;
+	FILETIME ftLastWriteTime;
+	DWORD nFileSizeHigh;
+	DWORD nFileSizeLow;
+};
+
+enum GET_FILEEX_INFO_LEVELS { GetFileExInfoStandard };
+
+struct ShimHandle
+{
+	int fd;
+};
+
+// Mapped views and their sizes, which munmap needs back
+inline std::map<const void*, size_t>& ShimMappedViews(std::mutex*& lock)
+{
+	static std::mutex viewLock;
+	static std::map<const void*, size_t> views;
+	lock = &viewLock;
+	return views;
+}
+
+inline HANDLE CreateFileA(const char* path, DWORD, DWORD, void*, DWORD, DWORD, HANDLE)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return INVALID_HANDLE_VALUE;
+	return new ShimHandle{ fd };
+}
+
+inline BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size)
+{
+	struct stat info;
+	if (fstat(((ShimHandle*)file)->fd, &info) != 0)
+		return FALSE;
+	size->QuadPart = info.st_size;
+	return TRUE;
+}
+
+// The mapping is just another descriptor for the same file
+inline HANDLE CreateFileMappingA(HANDLE file, void*, DWORD, DWORD, DWORD, const char*)
+{
+	int fd = dup(((ShimHandle*)file)->fd);
+	if (fd < 0)
+		return 0;
+	return new ShimHandle{ fd };
+}
+
+inline void* MapViewOfFile(HANDLE mapping, DWORD, DWORD, DWORD, size_t)
+{
+	int fd = ((ShimHandle*)mapping)->fd;
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+		return 0;
+
+	void* view = mmap(0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (view == MAP_FAILED)
+		return 0;
+
+	std::mutex* lock;
+	std::map<const void*, size_t>& views = ShimMappedViews(lock);
+	std::lock_guard<std::mutex> guard(*lock);
+	views[view] = (size_t)info.st_size;
+	return view;
+}
+
+inline BOOL UnmapViewOfFile(const void* view)
+{
+	std::mutex* lock;
+	std::map<const void*, size_t>& views = ShimMappedViews(lock);
+	std::lock_guard<std::mutex> guard(*lock);
+	auto found = views.find(view);
+	if (found == views.end())
+		return FALSE;
+	munmap((void*)view, found->second);
+	views.erase(found);
+	return TRUE;
+}
+
+inline BOOL CloseHandle(HANDLE handle)
+{
+	ShimHandle* shim = (ShimHandle*)handle;
+	BOOL closed = close(shim->fd) == 0;
+	delete shim;
+	return closed;
+}
+
+inline BOOL GetFileAttributesExA(const char* path, GET_FILEEX_INFO_LEVELS, void* information)
+{
+	struct stat info;
+	if (stat(path, &info) != 0)
+		return FALSE;
+
+	// 100ns ticks, like a FILETIME (the epoch doesn't matter here)
+	unsigned long long size = (unsigned long long)info.st_size;
+#ifdef __APPLE__
+	unsigned long long time = (unsigned long long)info.st_mtimespec.tv_sec * 10000000ull + info.st_mtimespec.tv_nsec / 100;
+#else
+	unsigned long long time = (unsigned long long)info.st_mtim.tv_sec * 10000000ull + info.st_mtim.tv_nsec / 100;
+#endif
+
+	WIN32_FILE_ATTRIBUTE_DATA* attributes = (WIN32_FILE_ATTRIBUTE_DATA*)information;
+	memset(attributes, 0, sizeof(WIN32_FILE_ATTRIBUTE_DATA));
+	attributes->nFileSizeHigh = (DWORD)(size >> 32);
+	attributes->nFileSizeLow = (DWORD)(size & 0xFFFFFFFF);
+	attributes->ftLastWriteTime.dwHighDateTime = (DWORD)(time >> 32);
+	attributes->ftLastWriteTime.dwLowDateTime = (DWORD)(time & 0xFFFFFFFF);
+	return TRUE;
+}
+
+inline BOOL MoveFileExA(const char* from, const char* to, DWORD)
+{
+	return rename(from, to) == 0;
+}
+
+inline BOOL DeleteFileA(const char* path)
+{
+	return unlink(path) == 0;
+}
+
+inline DWORD GetCurrentThreadId()
+{
+	return (DWORD)(uintptr_t)pthread_self();
+}
+
+// Returns the length without the terminator, or the size needed
+// (with it) when the buffer is too small, or 0 on failure.  Like
+// Windows, "." and ".." are resolved without touching the disk.
+inline DWORD GetFullPathNameA(const char* file, DWORD bufferLength, char* buffer, char** filePart)
+{
+	char joined[PATH_MAX];
+	if (file[0] == '/')
+	{
+		snprintf(joined, sizeof(joined), "%s", file);
+	}
+	else
+	{
+		char directory[PATH_MAX];
+		if (!getcwd(directory, sizeof(directory)))
+			return 0;
+		snprintf(joined, sizeof(joined), "%s/%s", directory, file);
+	}
+
+	// Rebuild the path a part at a time, dropping "." and backing up on ".."
+	char resolved[PATH_MAX];
+	size_t length = 0;
+	char* next;
+	for (char* part = strtok_r(joined, "/", &next); part; part = strtok_r(0, "/", &next))
+	{
+		if (strcmp(part, ".") == 0)
+			continue;
+		if (strcmp(part, "..") == 0)
+		{
+			while (length > 0 && resolved[length - 1] != '/')
+				length--;
+			if (length > 0)
+				length--;
+			continue;
+		}
+		length += snprintf(resolved + length, sizeof(resolved) - length, "/%s", part);
+	}
+	if (length == 0)
+		resolved[length++] = '/';
+	resolved[length] = 0;
+
+	if (length + 1 > bufferLength)
+		return (DWORD)length + 1;
+	memcpy(buffer, resolved, length + 1);
+	if (filePart)
+	{
+		char* slash = strrchr(buffer, '/');
+		*filePart = slash ? slash + 1 : buffer;
+	}
+	return (DWORD)length;
+}
@@ -0,0 +1,276 @@
+#pragma once
+
+// --------------------------------------------------------
+// A software stand-in for the bits of Direct3D 11 that the
+// CPU-side code touches, for the CMake build of the tests.
+//
+// D3D11CreateDevice hands back a device that keeps every
+// buffer's description and bytes in memory, and a context
+// whose draws do nothing.  Copying into a STAGING buffer and
+// mapping it reads the bytes back, the same way a test does
+// against a real (WARP) device on Windows - see TestDevice.h.
+// --------------------------------------------------------
+
+#include "Windows.h"
+#include <atomic>
+#include <vector>
+
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN = 0,
+	DXGI_FORMAT_R32G32B32A32_FLOAT = 2,
+	DXGI_FORMAT_R32G32B32_FLOAT = 6,
+	DXGI_FORMAT_R16G16B16A16_SNORM = 13,
+	DXGI_FORMAT_R32G32_FLOAT = 16,
+	DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+	DXGI_FORMAT_R16G16_FLOAT = 34,
+	DXGI_FORMAT_R16G16_SNORM = 37,
+	DXGI_FORMAT_R32_UINT = 42,
+	DXGI_FORMAT_R16_UINT = 57,
+};
+
+enum D3D_DRIVER_TYPE
+{
+	D3D_DRIVER_TYPE_UNKNOWN = 0,
+	D3D_DRIVER_TYPE_HARDWARE = 1,
+	D3D_DRIVER_TYPE_REFERENCE = 2,
+	D3D_DRIVER_TYPE_NULL = 3,
+	D3D_DRIVER_TYPE_SOFTWARE = 4,
+	D3D_DRIVER_TYPE_WARP = 5,
+};
+
+enum D3D_FEATURE_LEVEL
+{
+	D3D_FEATURE_LEVEL_11_0 = 0xb000,
+};
+
+enum D3D11_USAGE
+{
+	D3D11_USAGE_DEFAULT = 0,
+	D3D11_USAGE_IMMUTABLE = 1,
+	D3D11_USAGE_DYNAMIC = 2,
+	D3D11_USAGE_STAGING = 3,
+};
+
+enum D3D11_BIND_FLAG
+{
+	D3D11_BIND_VERTEX_BUFFER = 0x1,
+	D3D11_BIND_INDEX_BUFFER = 0x2,
+	D3D11_BIND_CONSTANT_BUFFER = 0x4,
+};
+
+enum D3D11_CPU_ACCESS_FLAG
+{
+	D3D11_CPU_ACCESS_WRITE = 0x10000,
+	D3D11_CPU_ACCESS_READ = 0x20000,
+};
+
+enum D3D11_MAP
+{
+	D3D11_MAP_READ = 1,
+	D3D11_MAP_WRITE = 2,
+	D3D11_MAP_READ_WRITE = 3,
+	D3D11_MAP_WRITE_DISCARD = 4,
+};
+
+enum D3D11_INPUT_CLASSIFICATION
+{
+	D3D11_INPUT_PER_VERTEX_DATA = 0,
+	D3D11_INPUT_PER_INSTANCE_DATA = 1,
+};
+
+#define D3D11_SDK_VERSION 7
+#define D3D11_APPEND_ALIGNED_ELEMENT 0xffffffff
+
+struct D3D11_BUFFER_DESC
+{
+	UINT ByteWidth;
+	D3D11_USAGE Usage;
+	UINT BindFlags;
+	UINT CPUAccessFlags;
+	UINT MiscFlags;
+	UINT StructureByteStride;
+};
+
+struct D3D11_SUBRESOURCE_DATA
+{
+	const void* pSysMem;
+	UINT SysMemPitch;
+	UINT SysMemSlicePitch;
+};
+
+struct D3D11_MAPPED_SUBRESOURCE
+{
+	void* pData;
+	UINT RowPitch;
+	UINT DepthPitch;
+};
+
+struct D3D11_INPUT_ELEMENT_DESC
+{
+	const char* SemanticName;
+	UINT SemanticIndex;
+	DXGI_FORMAT Format;
+	UINT InputSlot;
+	UINT AlignedByteOffset;
+	D3D11_INPUT_CLASSIFICATION InputSlotClass;
+	UINT InstanceDataStepRate;
+};
+
+// COM reference counting - objects delete themselves on the last Release
+struct IUnknown
+{
+	IUnknown() : references(1) {}
+	virtual ~IUnknown() {}
+
+	UINT AddRef() { return ++references; }
+
+	UINT Release()
+	{
+		UINT remaining = --references;
+		if (remaining == 0)
+			delete this;
+		return remaining;
+	}
+
+private:
+	std::atomic<UINT> references;
+};
+
+struct ID3D11DeviceChild : public IUnknown {};
+struct ID3D11Resource : public ID3D11DeviceChild {};
+struct ID3D11InputLayout : public ID3D11DeviceChild {};
+
+struct ID3D11Buffer : public ID3D11Resource
+{
+	virtual void GetDesc(D3D11_BUFFER_DESC* desc) = 0;
+};
+
+struct ID3D11DeviceContext : public ID3D11DeviceChild
+{
+	virtual void IASetVertexBuffers(UINT startSlot, UINT bufferCount, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets) = 0;
+	virtual void IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset) = 0;
+	virtual void DrawIndexed(UINT indexCount, UINT startIndexLocation, int baseVertexLocation) = 0;
+	virtual void CopyResource(ID3D11Resource* destination, ID3D11Resource* source) = 0;
+	virtual HRESULT Map(ID3D11Resource* resource, UINT subresource, D3D11_MAP mapType, UINT mapFlags, D3D11_MAPPED_SUBRESOURCE* mapped) = 0;
+	virtual void Unmap(ID3D11Resource* resource, UINT subresource) = 0;
+};
+
+struct ID3D11Device : public IUnknown
+{
+	virtual HRESULT CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer) = 0;
+	virtual HRESULT CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const void* shaderCode, size_t shaderSize, ID3D11InputLayout** inputLayout) = 0;
+	virtual void GetImmediateContext(ID3D11DeviceContext** context) = 0;
+};
+
+namespace D3D11Shim
+{
+	class Buffer : public ID3D11Buffer
+	{
+	public:
+		D3D11_BUFFER_DESC desc;
+		std::vector<unsigned char> bytes;
+
+		void GetDesc(D3D11_BUFFER_DESC* out) override { *out = desc; }
+	};
+
+	class InputLayout : public ID3D11InputLayout
+	{
+	public:
+		std::vector<D3D11_INPUT_ELEMENT_DESC> elements;
+	};
+
+	class DeviceContext : public ID3D11DeviceContext
+	{
+	public:
+		void IASetVertexBuffers(UINT, UINT, ID3D11Buffer* const*, const UINT*, const UINT*) override {}
+		void IASetIndexBuffer(ID3D11Buffer*, DXGI_FORMAT, UINT) override {}
+		void DrawIndexed(UINT, UINT, int) override {}
+
+		void CopyResource(ID3D11Resource* destination, ID3D11Resource* source) override
+		{
+			Buffer* to = dynamic_cast<Buffer*>(destination);
+			Buffer* from = dynamic_cast<Buffer*>(source);
+			if (to && from && to->bytes.size() == from->bytes.size())
+				to->bytes = from->bytes;
+		}
+
+		// Only STAGING buffers can be read back, like the real thing
+		HRESULT Map(ID3D11Resource* resource, UINT, D3D11_MAP mapType, UINT, D3D11_MAPPED_SUBRESOURCE* mapped) override
+		{
+			Buffer* buffer = dynamic_cast<Buffer*>(resource);
+			if (!buffer || (mapType == D3D11_MAP_READ && buffer->desc.Usage != D3D11_USAGE_STAGING))
+				return E_INVALIDARG;
+			mapped->pData = buffer->bytes.data();
+			mapped->RowPitch = buffer->desc.ByteWidth;
+			mapped->DepthPitch = buffer->desc.ByteWidth;
+			return S_OK;
+		}
+
+		void Unmap(ID3D11Resource*, UINT) override {}
+	};
+
+	class Device : public ID3D11Device
+	{
+	public:
+		Device() : context(new DeviceContext()) {}
+		~Device() override { context->Release(); }
+
+		HRESULT CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** out) override
+		{
+			if (!desc || desc->ByteWidth == 0 || (desc->Usage == D3D11_USAGE_IMMUTABLE && !initialData))
+				return E_INVALIDARG;
+
+			Buffer* buffer = new Buffer();
+			buffer->desc = *desc;
+			buffer->bytes.assign(desc->ByteWidth, 0);
+			if (initialData)
+			{
+				const unsigned char* source = (const unsigned char*)initialData->pSysMem;
+				buffer->bytes.assign(source, source + desc->ByteWidth);
+			}
+
+			if (out)
+				*out = buffer;
+			else
+				buffer->Release();
+			return S_OK;
+		}
+
+		// Any shader is accepted - there's nothing to check it against
+		HRESULT CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const void*, size_t, ID3D11InputLayout** out) override
+		{
+			InputLayout* layout = new InputLayout();
+			layout->elements.assign(elements, elements + elementCount);
+			if (out)
+				*out = layout;
+			else
+				layout->Release();
+			return S_OK;
+		}
+
+		void GetImmediateContext(ID3D11DeviceContext** out) override
+		{
+			context->AddRef();
+			*out = context;
+		}
+
+	private:
+		DeviceContext* context;
+	};
+}
+
+inline HRESULT D3D11CreateDevice(void*, D3D_DRIVER_TYPE, HINSTANCE, UINT, const D3D_FEATURE_LEVEL*, UINT, UINT,
+	ID3D11Device** device, D3D_FEATURE_LEVEL* featureLevel, ID3D11DeviceContext** context)
+{
+	D3D11Shim::Device* created = new D3D11Shim::Device();
+	if (featureLevel)
+		*featureLevel = D3D_FEATURE_LEVEL_11_0;
+	if (context)
+		created->GetImmediateContext(context);
+	if (device)
+		*device = created;
+	else
+		created->Release();
+	return S_OK;
+}
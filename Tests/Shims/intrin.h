@@ -0,0 +1,35 @@
+#pragma once
+
+// --------------------------------------------------------
+// The MSVC CPU feature intrinsics, in GCC/Clang terms
+// --------------------------------------------------------
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+// Newer cpuid.h headers declare their own versions (or macros)
+// with these names, so the shims go by others
+inline void ShimCpuidex(int info[4], int leaf, int subleaf)
+{
+	__cpuid_count(leaf, subleaf, info[0], info[1], info[2], info[3]);
+}
+
+inline void ShimCpuid(int info[4], int leaf)
+{
+	ShimCpuidex(info, leaf, 0);
+}
+
+#undef __cpuid
+#undef __cpuidex
+#define __cpuid ShimCpuid
+#define __cpuidex ShimCpuidex
+
+// Inline assembly, so callers don't need -mxsave
+inline unsigned long long ShimXgetbv(unsigned int index)
+{
+	unsigned int low;
+	unsigned int high;
+	__asm__ __volatile__("xgetbv" : "=a"(low), "=d"(high) : "c"(index));
+	return ((unsigned long long)high << 32) | low;
+}
+#define _xgetbv ShimXgetbv
@@ -0,0 +1,24 @@
+#pragma once
+
+// --------------------------------------------------------
+// The system malloc.h plus the MSVC aligned allocation
+// calls, which other compilers spell differently
+// --------------------------------------------------------
+
+#if __has_include_next(<malloc.h>)
+#include_next <malloc.h>
+#endif
+#include <stdlib.h>
+
+inline void* _aligned_malloc(size_t size, size_t alignment)
+{
+	void* memory = 0;
+	if (posix_memalign(&memory, alignment < sizeof(void*) ? sizeof(void*) : alignment, size) != 0)
+		return 0;
+	return memory;
+}
+
+inline void _aligned_free(void* memory)
+{
+	free(memory);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+// --------------------------------------------------------
+// Enough of WRL's ComPtr for the CMake build of the tests.
+// Holds one reference to a COM-style object (see d3d11.h
+// here) and releases it when it goes away.
+// --------------------------------------------------------
+
+#include <stddef.h>
+
+namespace Microsoft
+{
+	namespace WRL
+	{
+		template <typename T>
+		class ComPtr
+		{
+		public:
+			ComPtr() : pointer(nullptr) {}
+			ComPtr(decltype(nullptr)) : pointer(nullptr) {}
+			ComPtr(T* other) : pointer(other) { AddRef(); }
+			ComPtr(const ComPtr& other) : pointer(other.pointer) { AddRef(); }
+			ComPtr(ComPtr&& other) : pointer(other.pointer) { other.pointer = nullptr; }
+
+			template <typename U>
+			ComPtr(const ComPtr<U>& other) : pointer(other.Get()) { AddRef(); }
+
+			~ComPtr() { Release(); }
+
+			ComPtr& operator=(const ComPtr& other)
+			{
+				if (pointer != other.pointer)
+				{
+					ComPtr(other).Swap(*this);
+				}
+				return *this;
+			}
+
+			ComPtr& operator=(ComPtr&& other)
+			{
+				ComPtr(static_cast<ComPtr&&>(other)).Swap(*this);
+				return *this;
+			}
+
+			ComPtr& operator=(T* other)
+			{
+				ComPtr(other).Swap(*this);
+				return *this;
+			}
+
+			ComPtr& operator=(decltype(nullptr))
+			{
+				Release();
+				return *this;
+			}
+
+			T* Get() const { return pointer; }
+			T* operator->() const { return pointer; }
+			explicit operator bool() const { return pointer != nullptr; }
+
+			T* const* GetAddressOf() const { return &pointer; }
+			T** GetAddressOf() { return &pointer; }
+
+			T** ReleaseAndGetAddressOf()
+			{
+				Release();
+				return &pointer;
+			}
+
+			void Reset() { Release(); }
+
+			void Swap(ComPtr& other)
+			{
+				T* temp = pointer;
+				pointer = other.pointer;
+				other.pointer = temp;
+			}
+
+		private:
+			T* pointer;
+
+			void AddRef()
+			{
+				if (pointer)
+					pointer->AddRef();
+			}
+
+			void Release()
+			{
+				T* temp = pointer;
+				if (temp)
+				{
+					pointer = nullptr;
+					temp->Release();
+				}
+			}
+		};
+
+		template <typename T, typename U>
+		bool operator==(const ComPtr<T>& a, const ComPtr<U>& b) { return a.Get() == b.Get(); }
+		template <typename T, typename U>
+		bool operator!=(const ComPtr<T>& a, const ComPtr<U>& b) { return a.Get() != b.Get(); }
+	}
+}
@@ -0,0 +1,50 @@
+#include "TestDevice.h"
+#include <string.h>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "d3d11.lib")
+#endif
+
+TestDevice::TestDevice()
+{
+	D3D11CreateDevice(0, D3D_DRIVER_TYPE_WARP, 0, 0, 0, 0, D3D11_SDK_VERSION,
+		device.GetAddressOf(), 0, context.GetAddressOf());
+}
+
+Microsoft::WRL::ComPtr<ID3D11Device> TestDevice::GetDevice()
+{
+	return device;
+}
+
+Microsoft::WRL::ComPtr<ID3D11DeviceContext> TestDevice::GetContext()
+{
+	return context;
+}
+
+std::vector<unsigned char> TestDevice::ReadBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer> buffer)
+{
+	std::vector<unsigned char> bytes;
+	if (!buffer)
+		return bytes;
+
+	D3D11_BUFFER_DESC desc;
+	buffer->GetDesc(&desc);
+	desc.Usage = D3D11_USAGE_STAGING;
+	desc.BindFlags = 0;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	desc.MiscFlags = 0;
+	desc.StructureByteStride = 0;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> staging;
+	if (FAILED(device->CreateBuffer(&desc, 0, staging.GetAddressOf())))
+		return bytes;
+	context->CopyResource(staging.Get(), buffer.Get());
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(staging.Get(), 0, D3D11_MAP_READ, 0, &mapped)))
+		return bytes;
+	bytes.resize(desc.ByteWidth);
+	memcpy(&bytes[0], mapped.pData, desc.ByteWidth);
+	context->Unmap(staging.Get(), 0);
+	return bytes;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+
+// --------------------------------------------------------
+// A Direct3D device for tests that create GPU resources
+//
+// On Windows this is WARP (the software rasterizer), so no
+// GPU or window is needed.  The CMake build elsewhere gets
+// the software stand-in from Shims/d3d11.h.
+// --------------------------------------------------------
+class TestDevice
+{
+public:
+	TestDevice();
+
+	Microsoft::WRL::ComPtr<ID3D11Device> GetDevice();
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> GetContext();
+
+	// Copies a buffer back through a staging buffer.  Empty
+	// if it couldn't be read.
+	std::vector<unsigned char> ReadBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer> buffer);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+};
@@ -0,0 +1,105 @@
+#include "TestFramework.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+
+// The CMake build passes in the real location, otherwise this
+// is relative to the project folder (Visual Studio's default)
+#ifndef TEST_ASSET_DIRECTORY
+#define TEST_ASSET_DIRECTORY "../Assets"
+#endif
+
+int TestRegistry::failedChecks = 0;
+
+// A function static, so tests registering from other files'
+// static initializers never see it before it's constructed
+std::vector<TestCase>& TestRegistry::GetTests()
+{
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+int TestRegistry::Register(const char* name, void (*run)())
+{
+	GetTests().push_back({ name, run });
+	return (int)GetTests().size();
+}
+
+int TestRegistry::RunAll()
+{
+	int failedTests = 0;
+	for (TestCase& test : GetTests())
+	{
+		failedChecks = 0;
+		test.run();
+		printf("%s %s\n", failedChecks == 0 ? "[  OK  ]" : "[ FAIL ]", test.name);
+		failedTests += failedChecks == 0 ? 0 : 1;
+	}
+
+	printf("\n%d of %d tests passed\n", (int)GetTests().size() - failedTests, (int)GetTests().size());
+	return failedTests;
+}
+
+void TestRegistry::Fail(const char* file, int line, const char* condition)
+{
+	failedChecks++;
+	printf("    %s(%d): CHECK(%s) failed\n", file, line, condition);
+}
+
+std::vector<TestCase>& TestRegistry::GetBenchmarks()
+{
+	static std::vector<TestCase> benchmarks;
+	return benchmarks;
+}
+
+int TestRegistry::RegisterBenchmark(const char* name, void (*run)())
+{
+	GetBenchmarks().push_back({ name, run });
+	return (int)GetBenchmarks().size();
+}
+
+void TestRegistry::RunBenchmarks(const char* filter)
+{
+	for (TestCase& benchmark : GetBenchmarks())
+	{
+		if (filter && !strstr(benchmark.name, filter))
+			continue;
+
+		printf("%s\n", benchmark.name);
+		benchmark.run();
+		printf("\n");
+	}
+}
+
+double TestRegistry::Time(const std::function<void()>& work, int runs)
+{
+	double best = 0;
+	for (int i = 0; i < runs; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		work();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		if (i == 0 || elapsed.count() < best)
+			best = elapsed.count();
+	}
+	return best;
+}
+
+std::string TestRegistry::GetAssetPath(const char* file)
+{
+	return std::string(TEST_ASSET_DIRECTORY) + "/" + file;
+}
+
+void WriteTestFile(const char* path, const std::string& contents)
+{
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(contents.data(), contents.size());
+}
+
+std::vector<char> ReadTestFile(const char* path)
+{
+	std::ifstream in(path, std::ios::binary);
+	return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
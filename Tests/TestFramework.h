@@ -0,0 +1,69 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// One registered test or benchmark - see TEST() and BENCHMARK() below
+struct TestCase
+{
+	const char* name;
+	void (*run)();
+};
+
+// --------------------------------------------------------
+// Just enough of a unit test framework for the CPU-side code
+//
+// TEST(Name) { ... } defines a test and registers it before
+// main() runs.  CHECK(condition) reports a failure with its
+// file and line and keeps going, so one run shows every
+// broken check.  Nothing here needs a window or a device.
+//
+// BENCHMARK(Name) { ... } registers a benchmark the same
+// way.  Those only run with "Tests --bench" and print their
+// own timings - they're for comparing runs, not for passing.
+// --------------------------------------------------------
+class TestRegistry
+{
+public:
+	static std::vector<TestCase>& GetTests();
+	static int Register(const char* name, void (*run)());
+
+	// Runs every test, returning how many had a failed check
+	static int RunAll();
+
+	static void Fail(const char* file, int line, const char* condition);
+
+	static std::vector<TestCase>& GetBenchmarks();
+	static int RegisterBenchmark(const char* name, void (*run)());
+
+	// Runs every benchmark with filter in its name (all of them if null)
+	static void RunBenchmarks(const char* filter);
+
+	// Best time of several runs of work, in milliseconds
+	static double Time(const std::function<void()>& work, int runs = 5);
+
+	// Path to a file in the repo's Assets folder
+	static std::string GetAssetPath(const char* file);
+
+private:
+	static int failedChecks; // In the test that's running
+};
+
+#define TEST(name) \
+	static void name(); \
+	static int name##Registration = TestRegistry::Register(#name, name); \
+	static void name()
+
+// Test files go in the working directory - each test removes
+// the ones it makes
+void WriteTestFile(const char* path, const std::string& contents);
+std::vector<char> ReadTestFile(const char* path);
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static int name##Registration = TestRegistry::RegisterBenchmark(#name, name); \
+	static void name()
+
+#define CHECK(condition) \
+	do { if (!(condition)) TestRegistry::Fail(__FILE__, __LINE__, #condition); } while (0)
@@ -0,0 +1,169 @@
+#include "TestFramework.h"
+#include "TextureCompressor.h"
+#include <cstring>
+
+// Smooth ramps in every channel with a little deterministic noise,
+// roughly what a photographed material looks like up close
+static MipLevel MakeGradient(unsigned int width, unsigned int height)
+{
+	MipLevel level = { width, height };
+	level.pixels.resize((size_t)width * height * 4);
+	unsigned int seed = 3;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			seed = seed * 1664525 + 1013904223;
+			int noise = (int)(seed >> 29) - 4;
+			unsigned char* texel = &level.pixels[((size_t)y * width + x) * 4];
+			texel[0] = (unsigned char)(16 + x * 223 / (width - 1) + noise);
+			texel[1] = (unsigned char)(y * 255 / (height - 1));
+			texel[2] = (unsigned char)(64 + (x + y) / 2);
+			texel[3] = 255;
+		}
+	}
+	return level;
+}
+
+static MipLevel RoundTrip(const MipLevel& level, TextureKind kind)
+{
+	std::vector<unsigned char> blocks;
+	TextureCompressor::CompressLevel(level, kind, blocks);
+
+	MipLevel decoded;
+	TextureCompressor::DecompressLevel(&blocks[0], kind, level.width, level.height, decoded);
+	return decoded;
+}
+
+TEST(TextureBlockSizes)
+{
+	MipLevel level = MakeGradient(64, 32);
+	std::vector<unsigned char> blocks;
+	TextureCompressor::CompressLevel(level, ColorTexture, blocks);
+	CHECK(blocks.size() == 16 * 8 * 8);
+	TextureCompressor::CompressLevel(level, GrayscaleTexture, blocks);
+	CHECK(blocks.size() == 16 * 8 * 8);
+	TextureCompressor::CompressLevel(level, NormalTexture, blocks);
+	CHECK(blocks.size() == 16 * 8 * 16);
+
+	// Small mips round up to whole blocks
+	MipLevel small = MakeGradient(2, 2);
+	TextureCompressor::CompressLevel(small, SurfaceTexture, blocks);
+	CHECK(blocks.size() == 16);
+}
+
+TEST(TextureBC1Quality)
+{
+	MipLevel level = MakeGradient(128, 128);
+	double psnr = TextureCompressor::MeasurePSNR(level, RoundTrip(level, ColorTexture), ColorTexture);
+	CHECK(psnr > 38.0);
+}
+
+TEST(TextureBC4Quality)
+{
+	MipLevel level = MakeGradient(128, 128);
+	double psnr = TextureCompressor::MeasurePSNR(level, RoundTrip(level, GrayscaleTexture), GrayscaleTexture);
+	CHECK(psnr > 48.0);
+
+	// BC5 is two of the same blocks
+	psnr = TextureCompressor::MeasurePSNR(level, RoundTrip(level, SurfaceTexture), SurfaceTexture);
+	CHECK(psnr > 48.0);
+}
+
+TEST(TextureSolidBlocksAreExact)
+{
+	// Red and blue at 255 and green at 0 are exact in 5:6:5
+	MipLevel level = { 8, 8 };
+	level.pixels.resize(8 * 8 * 4);
+	for (size_t i = 0; i < level.pixels.size(); i += 4)
+	{
+		level.pixels[i + 0] = 255;
+		level.pixels[i + 1] = 0;
+		level.pixels[i + 2] = 255;
+		level.pixels[i + 3] = 255;
+	}
+	CHECK(TextureCompressor::MeasurePSNR(level, RoundTrip(level, ColorTexture), ColorTexture) == 100.0);
+
+	// BC4 keeps any single value exactly
+	for (size_t i = 0; i < level.pixels.size(); i += 4)
+		level.pixels[i] = 77;
+	CHECK(TextureCompressor::MeasurePSNR(level, RoundTrip(level, GrayscaleTexture), GrayscaleTexture) == 100.0);
+}
+
+TEST(TextureKeepsAlpha)
+{
+	// A cut out: solid in the middle, fading out to the edges
+	MipLevel level = MakeGradient(64, 64);
+	for (unsigned int y = 0; y < 64; y++)
+	{
+		for (unsigned int x = 0; x < 64; x++)
+		{
+			int edge = x < y ? x : y;
+			edge = edge < 63 - x ? edge : 63 - x;
+			edge = edge < 63 - y ? edge : 63 - y;
+			level.pixels[(y * 64 + x) * 4 + 3] = (unsigned char)(edge * 16 < 255 ? edge * 16 : 255);
+		}
+	}
+	CHECK(TextureCompressor::HasAlpha(level));
+	CHECK(!TextureCompressor::HasAlpha(MakeGradient(64, 64)));
+
+	std::vector<unsigned char> blocks;
+	TextureCompressor::CompressLevel(level, ColorAlphaTexture, blocks);
+	CHECK(blocks.size() == 16 * 16 * 16);
+
+	// As good as BC1 on the colors, with the alpha as sharp as BC4
+	MipLevel decoded = RoundTrip(level, ColorAlphaTexture);
+	CHECK(TextureCompressor::MeasurePSNR(level, decoded, ColorTexture) > 38.0);
+	CHECK(TextureCompressor::MeasurePSNR(level, decoded, ColorAlphaTexture) > 38.0);
+	double alphaError = 0;
+	for (size_t i = 3; i < level.pixels.size(); i += 4)
+		alphaError += ((double)level.pixels[i] - decoded.pixels[i]) * ((double)level.pixels[i] - decoded.pixels[i]);
+	CHECK(alphaError / (64 * 64) < 2.0);
+
+	// BC1 alone would have lost it
+	CHECK(!TextureCompressor::HasAlpha(RoundTrip(level, ColorTexture)));
+}
+
+TEST(TexturePadsToBlocks)
+{
+	MipLevel original = MakeGradient(67, 9);
+	MipLevel level = original;
+	CHECK(TextureCompressor::CanCompress(level));
+	TextureCompressor::PadToBlocks(level);
+	CHECK(level.width == 68 && level.height == 12);
+	CHECK(level.pixels.size() == 68 * 12 * 4);
+
+	// Every texel of the image is still there, and the padding repeats the edges
+	bool same = true;
+	for (unsigned int y = 0; y < 12; y++)
+	{
+		for (unsigned int x = 0; x < 68; x++)
+		{
+			unsigned int sx = x < 67 ? x : 66;
+			unsigned int sy = y < 9 ? y : 8;
+			same = same && memcmp(&level.pixels[(y * 68 + x) * 4], &original.pixels[(sy * 67 + sx) * 4], 4) == 0;
+		}
+	}
+	CHECK(same);
+
+	// The header remembers the image's size, for scaling the UVs
+	std::vector<MipLevel> mips(1, level);
+	std::vector<unsigned char> dds;
+	TextureCompressor::BuildDDS(mips, ColorTexture, dds, 67, 9);
+	CHECK(dds.size() == DDS_FILE_HEADER_SIZE + 17 * 3 * 8);
+	float uScale = 0;
+	float vScale = 0;
+	TextureCompressor::ReadImageScale(&dds[0], uScale, vScale);
+	CHECK(uScale == 67.0f / 68.0f && vScale == 9.0f / 12.0f);
+
+	// Already whole blocks, so nothing to do
+	MipLevel whole = MakeGradient(64, 8);
+	TextureCompressor::PadToBlocks(whole);
+	CHECK(whole.width == 64 && whole.height == 8);
+	TextureCompressor::BuildDDS(std::vector<MipLevel>(1, whole), ColorTexture, dds);
+	TextureCompressor::ReadImageScale(&dds[0], uScale, vScale);
+	CHECK(uScale == 1.0f && vScale == 1.0f);
+
+	MipLevel tiny = MakeGradient(3, 8);
+	CHECK(!TextureCompressor::CanCompress(tiny));
+}
@@ -0,0 +1,41 @@
+#include "TestFramework.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <vector>
+
+TEST(ThreadPoolRunsEveryJobOnce)
+{
+	std::vector<std::atomic<int>> runs(1000);
+	ThreadPool::GetInstance().ParallelFor((int)runs.size(), [&](int i) { runs[i]++; });
+
+	bool once = true;
+	for (std::atomic<int>& count : runs)
+		once = once && count == 1;
+	CHECK(once);
+}
+
+TEST(ThreadPoolShutdownFinishesQueuedTasks)
+{
+	ThreadPool::SetThreadCount(3);
+	CHECK(ThreadPool::GetInstance().GetThreadCount() == 3);
+
+	std::atomic<int> finished(0);
+	for (int i = 0; i < 100; i++)
+	{
+		ThreadPool::GetInstance().Enqueue([&]() { finished++; });
+	}
+
+	// Joins the workers, which empty the queue first
+	ThreadPool::Shutdown();
+	CHECK(finished == 100);
+
+	// One thread still has a worker for queued tasks
+	ThreadPool::SetThreadCount(1);
+	CHECK(ThreadPool::GetInstance().GetThreadCount() == 1);
+	ThreadPool::GetInstance().Enqueue([&]() { finished++; });
+	ThreadPool::GetInstance().ParallelFor(10, [&](int) { finished++; });
+	ThreadPool::Shutdown();
+	CHECK(finished == 111);
+
+	ThreadPool::SetThreadCount(0);
+}
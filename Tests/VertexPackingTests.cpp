@@ -0,0 +1,98 @@
+#include "TestFramework.h"
+#include "VertexPacking.h"
+#include <math.h>
+using namespace DirectX;
+
+static float Dot(XMFLOAT3 a, XMFLOAT3 b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static XMFLOAT3 Normalized(float x, float y, float z)
+{
+	float length = sqrtf(x * x + y * y + z * z);
+	return XMFLOAT3(x / length, y / length, z / length);
+}
+
+TEST(VertexPackRoundTrip)
+{
+	XMFLOAT3 center(1.0f, -2.0f, 3.0f);
+	XMFLOAT3 extents(10.0f, 0.5f, 4.0f);
+
+	std::vector<Vertex> vertices;
+	unsigned int seed = 99;
+	for (int i = 0; i < 500; i++)
+	{
+		float r[9];
+		for (float& value : r)
+		{
+			seed = seed * 1664525 + 1013904223;
+			value = (seed >> 8) / 8388608.0f - 1.0f; // -1 to 1
+		}
+
+		Vertex v;
+		v.Position = XMFLOAT3(center.x + r[0] * extents.x, center.y + r[1] * extents.y, center.z + r[2] * extents.z);
+		v.Normal = Normalized(r[3], r[4], r[5] + 0.01f);
+		v.UV = XMFLOAT2(r[6] * 4.0f, r[7] + 1.0f);
+		v.Tangent = Normalized(r[8], r[5], r[3] - 0.01f);
+		vertices.push_back(v);
+	}
+
+	std::vector<PackedVertex> packed(vertices.size());
+	VertexPacker::Pack(&vertices[0], (int)vertices.size(), center, extents, &packed[0]);
+
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		Vertex original = vertices[i];
+		Vertex v = VertexPacker::Unpack(packed[i], center, extents);
+
+		// Within a SNORM16 step of each extent
+		CHECK(fabsf(v.Position.x - original.Position.x) <= extents.x / 32767.0f);
+		CHECK(fabsf(v.Position.y - original.Position.y) <= extents.y / 32767.0f);
+		CHECK(fabsf(v.Position.z - original.Position.z) <= extents.z / 32767.0f);
+
+		// Within a quarter of a degree
+		CHECK(Dot(v.Normal, original.Normal) > 0.99999f);
+		CHECK(Dot(v.Tangent, original.Tangent) > 0.99999f);
+
+		// Half floats keep 11 significant bits
+		CHECK(fabsf(v.UV.x - original.UV.x) <= fabsf(original.UV.x) / 1024.0f + 1e-4f);
+		CHECK(fabsf(v.UV.y - original.UV.y) <= fabsf(original.UV.y) / 1024.0f + 1e-4f);
+	}
+}
+
+TEST(VertexPackFlatMesh)
+{
+	// No extent on y - every position there is the center
+	Vertex v = {};
+	v.Position = XMFLOAT3(2.0f, 5.0f, -1.0f);
+	v.Normal = XMFLOAT3(0, 1, 0);
+	v.Tangent = XMFLOAT3(1, 0, 0);
+
+	PackedVertex packed;
+	VertexPacker::Pack(&v, 1, XMFLOAT3(0, 5, 0), XMFLOAT3(4, 0, 4), &packed);
+	CHECK(packed.Position[1] == 0);
+
+	Vertex unpacked = VertexPacker::Unpack(packed, XMFLOAT3(0, 5, 0), XMFLOAT3(4, 0, 4));
+	CHECK(unpacked.Position.y == 5.0f);
+	CHECK(fabsf(unpacked.Position.x - 2.0f) <= 4.0f / 32767.0f);
+}
+
+TEST(OctahedronKeepsTheAxes)
+{
+	XMFLOAT3 axes[] =
+	{
+		XMFLOAT3(1, 0, 0), XMFLOAT3(-1, 0, 0),
+		XMFLOAT3(0, 1, 0), XMFLOAT3(0, -1, 0),
+		XMFLOAT3(0, 0, 1), XMFLOAT3(0, 0, -1),
+	};
+	for (XMFLOAT3 axis : axes)
+	{
+		XMFLOAT3 decoded = VertexPacker::OctahedronDecode(VertexPacker::OctahedronEncode(axis));
+		CHECK(decoded.x == axis.x && decoded.y == axis.y && decoded.z == axis.z);
+	}
+
+	// The lower half folds out to the corners
+	XMFLOAT2 down = VertexPacker::OctahedronEncode(XMFLOAT3(0, 0, -1));
+	CHECK(fabsf(down.x) == 1.0f && fabsf(down.y) == 1.0f);
+}
@@ -0,0 +1,120 @@
+#include "TextureAtlas.h"
+#include <cstddef>
+
+TextureAtlas::TextureAtlas()
+{
+	width = 0;
+	height = 0;
+}
+
+bool TextureAtlas::Plan(const std::vector<std::wstring>& files, const std::vector<unsigned int>& widths, const std::vector<unsigned int>& heights, unsigned int maxSize)
+{
+	this->files = files;
+	images.resize(files.size());
+	spots.resize(files.size());
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		// Missing images still get a spot, so everything has UVs
+		images[i].width = widths[i] > 0 ? widths[i] : 4;
+		images[i].height = heights[i] > 0 ? heights[i] : 4;
+
+		// Gutters both sides, rounded up to whole blocks
+		spots[i].width = (images[i].width + ATLAS_GUTTER * 2 + 3) & ~3u;
+		spots[i].height = (images[i].height + ATLAS_GUTTER * 2 + 3) & ~3u;
+	}
+
+	if (files.empty() || !AtlasPacker::Pack(spots, maxSize, width, height))
+	{
+		width = 0;
+		height = 0;
+		return false;
+	}
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		images[i].x = spots[i].x + ATLAS_GUTTER;
+		images[i].y = spots[i].y + ATLAS_GUTTER;
+	}
+	return true;
+}
+
+void TextureAtlas::Place(int index, const MipLevel* image, MipLevel& atlas)
+{
+	const AtlasRect& spot = spots[index];
+	const AtlasRect& inside = images[index];
+
+	for (unsigned int y = spot.y; y < spot.y + spot.height; y++)
+	{
+		unsigned char* out = &atlas.pixels[((size_t)y * atlas.width + spot.x) * 4];
+		if (!image)
+		{
+			for (unsigned int i = 0; i < spot.width * 4; i++)
+				out[i] = 255;
+			continue;
+		}
+
+		// Nearest texel of the image, clamped to its edges out in the gutter
+		unsigned int imageY = y < inside.y ? 0 : (y - inside.y < inside.height ? y - inside.y : inside.height - 1);
+		const unsigned char* row = &image->pixels[(size_t)(imageY * image->height / inside.height) * image->width * 4];
+		for (unsigned int x = spot.x; x < spot.x + spot.width; x++, out += 4)
+		{
+			unsigned int imageX = x < inside.x ? 0 : (x - inside.x < inside.width ? x - inside.x : inside.width - 1);
+			const unsigned char* texel = &row[(size_t)(imageX * image->width / inside.width) * 4];
+			out[0] = texel[0];
+			out[1] = texel[1];
+			out[2] = texel[2];
+			out[3] = texel[3];
+		}
+	}
+}
+
+int TextureAtlas::Find(const std::wstring& file)
+{
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (files[i] == file)
+			return (int)i;
+	}
+	return -1;
+}
+
+int TextureAtlas::GetImageCount()
+{
+	return (int)files.size();
+}
+
+const std::wstring& TextureAtlas::GetFile(int index)
+{
+	return files[index];
+}
+
+DirectX::XMFLOAT2 TextureAtlas::GetUVScale(int index)
+{
+	return DirectX::XMFLOAT2((float)images[index].width / width, (float)images[index].height / height);
+}
+
+DirectX::XMFLOAT2 TextureAtlas::GetUVOffset(int index)
+{
+	return DirectX::XMFLOAT2((float)images[index].x / width, (float)images[index].y / height);
+}
+
+unsigned int TextureAtlas::GetWidth()
+{
+	return width;
+}
+
+unsigned int TextureAtlas::GetHeight()
+{
+	return height;
+}
+
+float TextureAtlas::GetEfficiency()
+{
+	if (width == 0 || height == 0)
+		return 0.0f;
+
+	unsigned long long used = 0;
+	for (const AtlasRect& image : images)
+		used += (unsigned long long)image.width * image.height;
+	return (float)((double)used / ((unsigned long long)width * height));
+}
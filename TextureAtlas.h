@@ -0,0 +1,59 @@
+#pragma once
+
+#include "AtlasPacker.h"
+#include "MipGenerator.h"
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+
+// Edge texels copied out around each image, so filtering never reaches a neighbor
+static const unsigned int ATLAS_GUTTER = 8;
+
+// Mips past this would shrink the gutters under a texel
+static const unsigned int ATLAS_MIP_LEVELS = 4;
+
+// --------------------------------------------------------
+// Several images laid out in one texture
+//
+// Entities drawn with an atlas pick their image out of it
+// with a UV scale and offset, so one material (and one
+// texture) covers all of them.  Each image is ringed by a
+// gutter of copies of its edge texels, and its spot is a
+// multiple of 4 texels each way so no compressed block
+// mixes two images.
+//
+// The layout only needs the images' sizes, so it's worked
+// out up front and the UVs are ready long before the pixels.
+// --------------------------------------------------------
+class TextureAtlas
+{
+public:
+	TextureAtlas();
+
+	// Lays the images out given their sizes (0 x 0 for one that can't
+	// be read gets a small spot of its own).  False if they won't all
+	// fit in maxSize x maxSize.
+	bool Plan(const std::vector<std::wstring>& files, const std::vector<unsigned int>& widths, const std::vector<unsigned int>& heights, unsigned int maxSize);
+
+	// Copies an image into its spot, stretching it to fit if it's
+	// changed size since Plan(), and smears its edges over the gutter.
+	// A null image fills the spot with white.
+	void Place(int index, const MipLevel* image, MipLevel& atlas);
+
+	int Find(const std::wstring& file); // -1 if it isn't in the atlas
+	int GetImageCount();
+	const std::wstring& GetFile(int index);
+	DirectX::XMFLOAT2 GetUVScale(int index);
+	DirectX::XMFLOAT2 GetUVOffset(int index);
+
+	unsigned int GetWidth();
+	unsigned int GetHeight();
+	float GetEfficiency(); // Share of the atlas the images themselves cover
+
+private:
+	std::vector<std::wstring> files;
+	std::vector<AtlasRect> spots;	// Each image plus its gutter
+	std::vector<AtlasRect> images;	// Just the image
+	unsigned int width;
+	unsigned int height;
+};
@@ -0,0 +1,590 @@
+#include "TextureCompressor.h"
+#include "ThreadPool.h"
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+// Block rows per job when a level is split across the pool
+static const unsigned int COMPRESS_BLOCK_ROWS_PER_JOB = 16;
+
+#define DDS_FOURCC(a, b, c, d) ((unsigned int)(a) | ((unsigned int)(b) << 8) | ((unsigned int)(c) << 16) | ((unsigned int)(d) << 24))
+
+// The on-disk layout from the DDS docs, which DDSTextureLoader reads
+struct DDSPixelFormat
+{
+	unsigned int size;
+	unsigned int flags;
+	unsigned int fourCC;
+	unsigned int rgbBitCount;
+	unsigned int rBitMask;
+	unsigned int gBitMask;
+	unsigned int bBitMask;
+	unsigned int aBitMask;
+};
+
+struct DDSHeader
+{
+	unsigned int size;
+	unsigned int flags;
+	unsigned int height;
+	unsigned int width;
+	unsigned int pitchOrLinearSize;
+	unsigned int depth;
+	unsigned int mipMapCount;
+	unsigned int reserved1[11];
+	DDSPixelFormat pixelFormat;
+	unsigned int caps;
+	unsigned int caps2;
+	unsigned int caps3;
+	unsigned int caps4;
+	unsigned int reserved2;
+};
+
+static unsigned short To565(const float color[3])
+{
+	int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+	int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+	int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+	r = r < 0 ? 0 : (r > 31 ? 31 : r);
+	g = g < 0 ? 0 : (g > 63 ? 63 : g);
+	b = b < 0 ? 0 : (b > 31 ? 31 : b);
+	return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+static void From565(unsigned short color, int rgb[3])
+{
+	int r = (color >> 11) & 31;
+	int g = (color >> 5) & 63;
+	int b = color & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Colors a 4 color mode BC1 block can hold: both ends, then the thirds
+static void BC1Palette(unsigned short color0, unsigned short color1, int palette[4][3])
+{
+	From565(color0, palette[0]);
+	From565(color1, palette[1]);
+	for (int c = 0; c < 3; c++)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+}
+
+// Picks the closest palette entry for each texel and returns the total squared error
+static int BC1Indices(const unsigned char texels[64], unsigned short color0, unsigned short color1, int indices[16])
+{
+	int palette[4][3];
+	BC1Palette(color0, color1, palette);
+
+	int error = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		int best = 0;
+		int bestDistance = INT_MAX;
+		for (int p = 0; p < 4; p++)
+		{
+			int dr = texels[i * 4 + 0] - palette[p][0];
+			int dg = texels[i * 4 + 1] - palette[p][1];
+			int db = texels[i * 4 + 2] - palette[p][2];
+			int distance = dr * dr + dg * dg + db * db;
+			if (distance < bestDistance)
+			{
+				best = p;
+				bestDistance = distance;
+			}
+		}
+		indices[i] = best;
+		error += bestDistance;
+	}
+	return error;
+}
+
+// Least squares end points for a fixed set of indices, or false if the
+// indices don't pin them down (every texel on the same palette entry)
+static bool BC1Refine(const unsigned char texels[64], const int indices[16], float color0[3], float color1[3])
+{
+	static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+	float aa = 0, bb = 0, ab = 0;
+	float ax[3] = {}, bx[3] = {};
+	for (int i = 0; i < 16; i++)
+	{
+		float a = weights[indices[i]];
+		float b = 1.0f - a;
+		aa += a * a;
+		bb += b * b;
+		ab += a * b;
+		for (int c = 0; c < 3; c++)
+		{
+			ax[c] += a * texels[i * 4 + c];
+			bx[c] += b * texels[i * 4 + c];
+		}
+	}
+
+	float determinant = aa * bb - ab * ab;
+	if (fabsf(determinant) < 1e-6f)
+		return false;
+
+	for (int c = 0; c < 3; c++)
+	{
+		color0[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+		color1[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+	}
+	return true;
+}
+
+bool TextureCompressor::CanCompress(const MipLevel& top)
+{
+	return top.width >= 4 && top.height >= 4;
+}
+
+void TextureCompressor::PadToBlocks(MipLevel& top)
+{
+	unsigned int width = (top.width + 3) & ~3u;
+	unsigned int height = (top.height + 3) & ~3u;
+	if (width == top.width && height == top.height)
+		return;
+
+	// Past the edge, repeat the last column and row
+	std::vector<unsigned char> padded((size_t)width * height * 4);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		const unsigned char* row = &top.pixels[(size_t)(y < top.height ? y : top.height - 1) * top.width * 4];
+		unsigned char* out = &padded[(size_t)y * width * 4];
+		memcpy(out, row, (size_t)top.width * 4);
+		for (unsigned int x = top.width; x < width; x++)
+			memcpy(&out[x * 4], &row[(top.width - 1) * 4], 4);
+	}
+	top.width = width;
+	top.height = height;
+	top.pixels.swap(padded);
+}
+
+bool TextureCompressor::HasAlpha(const MipLevel& level)
+{
+	for (size_t i = 3; i < level.pixels.size(); i += 4)
+	{
+		if (level.pixels[i] < 255)
+			return true;
+	}
+	return false;
+}
+
+void TextureCompressor::BuildDDS(const std::vector<MipLevel>& mips, TextureKind kind, std::vector<unsigned char>& dds,
+	unsigned int imageWidth, unsigned int imageHeight)
+{
+	DDSHeader header = {};
+	header.size = sizeof(DDSHeader);
+	header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;	// caps, height, width, pixel format, mip count, linear size
+	header.height = mips[0].height;
+	header.width = mips[0].width;
+	header.pitchOrLinearSize = ((mips[0].width + 3) / 4) * ((mips[0].height + 3) / 4) * GetBlockBytes(kind);
+	header.mipMapCount = (unsigned int)mips.size();
+	header.reserved1[0] = imageWidth > 0 ? imageWidth : mips[0].width;	// readers ignore these
+	header.reserved1[1] = imageHeight > 0 ? imageHeight : mips[0].height;
+	header.pixelFormat.size = sizeof(DDSPixelFormat);
+	header.pixelFormat.flags = 0x4;	// four CC
+	int channels = GetChannelCount(kind);
+	header.pixelFormat.fourCC =
+		channels == 4 ? DDS_FOURCC('D', 'X', 'T', '5') :
+		channels == 3 ? DDS_FOURCC('D', 'X', 'T', '1') :
+		channels == 2 ? DDS_FOURCC('A', 'T', 'I', '2') :
+		DDS_FOURCC('A', 'T', 'I', '1');
+	header.caps = 0x1000 | (mips.size() > 1 ? 0x400000 | 0x8 : 0);	// texture, mip map, complex
+
+	dds.resize(DDS_FILE_HEADER_SIZE);
+	memcpy(&dds[0], "DDS ", 4);
+	memcpy(&dds[4], &header, sizeof(DDSHeader));
+
+	std::vector<unsigned char> blocks;
+	for (const MipLevel& level : mips)
+	{
+		CompressLevel(level, kind, blocks);
+		dds.insert(dds.end(), blocks.begin(), blocks.end());
+	}
+}
+
+// Files written before the size was recorded hold 0, and weren't padded
+void TextureCompressor::ReadImageScale(const unsigned char* dds, float& uScale, float& vScale)
+{
+	DDSHeader header;
+	memcpy(&header, dds + 4, sizeof(DDSHeader));
+	unsigned int width = header.reserved1[0] > 0 && header.reserved1[0] <= header.width ? header.reserved1[0] : header.width;
+	unsigned int height = header.reserved1[1] > 0 && header.reserved1[1] <= header.height ? header.reserved1[1] : header.height;
+	uScale = (float)width / header.width;
+	vScale = (float)height / header.height;
+}
+
+void TextureCompressor::CompressLevel(const MipLevel& level, TextureKind kind, std::vector<unsigned char>& blocks)
+{
+	unsigned int blocksWide = (level.width + 3) / 4;
+	unsigned int blocksHigh = (level.height + 3) / 4;
+	blocks.resize((size_t)blocksWide * blocksHigh * GetBlockBytes(kind));
+
+	// Small levels aren't worth handing out
+	unsigned int jobs = (blocksHigh + COMPRESS_BLOCK_ROWS_PER_JOB - 1) / COMPRESS_BLOCK_ROWS_PER_JOB;
+	if (jobs <= 1)
+	{
+		CompressRows(level, kind, &blocks[0], 0, blocksHigh);
+		return;
+	}
+
+	unsigned char* output = &blocks[0];
+	ThreadPool::GetInstance().ParallelFor((int)jobs, [&](int job)
+	{
+		unsigned int first = job * COMPRESS_BLOCK_ROWS_PER_JOB;
+		unsigned int last = first + COMPRESS_BLOCK_ROWS_PER_JOB < blocksHigh ? first + COMPRESS_BLOCK_ROWS_PER_JOB : blocksHigh;
+		CompressRows(level, kind, output, first, last);
+	});
+}
+
+void TextureCompressor::DecompressLevel(const unsigned char* blocks, TextureKind kind, unsigned int width, unsigned int height, MipLevel& level)
+{
+	level.width = width;
+	level.height = height;
+	level.pixels.assign((size_t)width * height * 4, 0);
+
+	unsigned int blocksWide = (width + 3) / 4;
+	unsigned int blocksHigh = (height + 3) / 4;
+	unsigned int blockBytes = GetBlockBytes(kind);
+	int channels = GetChannelCount(kind);
+	for (unsigned int by = 0; by < blocksHigh; by++)
+	{
+		for (unsigned int bx = 0; bx < blocksWide; bx++)
+		{
+			const unsigned char* block = blocks + ((size_t)by * blocksWide + bx) * blockBytes;
+			unsigned char texels[64] = {};
+			if (channels == 4)
+			{
+				DecompressBC1(block + 8, texels);
+				DecompressBC4(block, 3, texels);
+			}
+			else if (channels == 3)
+			{
+				DecompressBC1(block, texels);
+			}
+			else
+			{
+				DecompressBC4(block, 0, texels);
+				if (channels == 2)
+					DecompressBC4(block + 8, 1, texels);
+			}
+
+			for (unsigned int y = 0; y < 4 && by * 4 + y < height; y++)
+			{
+				for (unsigned int x = 0; x < 4 && bx * 4 + x < width; x++)
+				{
+					unsigned char* pixel = &level.pixels[((size_t)(by * 4 + y) * width + bx * 4 + x) * 4];
+					memcpy(pixel, &texels[(y * 4 + x) * 4], 4);
+					if (channels < 4)
+						pixel[3] = 255;
+				}
+			}
+		}
+	}
+}
+
+double TextureCompressor::MeasurePSNR(const MipLevel& original, const MipLevel& decoded, TextureKind kind)
+{
+	int channels = GetChannelCount(kind);
+
+	double squaredError = 0;
+	size_t texels = (size_t)original.width * original.height;
+	for (size_t i = 0; i < texels; i++)
+	{
+		for (int c = 0; c < channels; c++)
+		{
+			double difference = (double)original.pixels[i * 4 + c] - decoded.pixels[i * 4 + c];
+			squaredError += difference * difference;
+		}
+	}
+
+	double meanError = squaredError / ((double)texels * channels);
+	if (meanError == 0)
+		return 100.0;
+	return 10.0 * log10(255.0 * 255.0 / meanError);
+}
+
+unsigned int TextureCompressor::GetBlockBytes(TextureKind kind)
+{
+	int channels = GetChannelCount(kind);
+	return channels == 4 || channels == 2 ? 16 : 8;
+}
+
+int TextureCompressor::GetChannelCount(TextureKind kind)
+{
+	switch (kind)
+	{
+	case ColorTexture: return 3;
+	case ColorAlphaTexture: return 4;
+	case NormalTexture: return 2;
+	case SurfaceTexture: return 2;
+	default: return 1;
+	}
+}
+
+void TextureCompressor::CompressRows(const MipLevel& level, TextureKind kind, unsigned char* blocks, unsigned int firstRow, unsigned int lastRow)
+{
+	unsigned int blocksWide = (level.width + 3) / 4;
+	unsigned int blockBytes = GetBlockBytes(kind);
+	int channels = GetChannelCount(kind);
+
+	for (unsigned int by = firstRow; by < lastRow; by++)
+	{
+		for (unsigned int bx = 0; bx < blocksWide; bx++)
+		{
+			// Gather the block, repeating the last row and column past the edge
+			unsigned char texels[64];
+			for (unsigned int y = 0; y < 4; y++)
+			{
+				unsigned int sy = by * 4 + y < level.height ? by * 4 + y : level.height - 1;
+				for (unsigned int x = 0; x < 4; x++)
+				{
+					unsigned int sx = bx * 4 + x < level.width ? bx * 4 + x : level.width - 1;
+					memcpy(&texels[(y * 4 + x) * 4], &level.pixels[((size_t)sy * level.width + sx) * 4], 4);
+				}
+			}
+
+			unsigned char* block = blocks + ((size_t)by * blocksWide + bx) * blockBytes;
+			if (channels == 4)
+			{
+				CompressBC4(texels, 3, block);
+				CompressBC1(texels, block + 8);
+			}
+			else if (channels == 3)
+			{
+				CompressBC1(texels, block);
+			}
+			else
+			{
+				CompressBC4(texels, 0, block);
+				if (channels == 2)
+					CompressBC4(texels, 1, block + 8);
+			}
+		}
+	}
+}
+
+void TextureCompressor::CompressBC1(const unsigned char texels[64], unsigned char* block)
+{
+	// Mean and covariance of the block's colors
+	float mean[3] = {};
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+			mean[c] += texels[i * 4 + c] / 16.0f;
+	}
+
+	float covariance[6] = {};	// rr, rg, rb, gg, gb, bb
+	for (int i = 0; i < 16; i++)
+	{
+		float r = texels[i * 4 + 0] - mean[0];
+		float g = texels[i * 4 + 1] - mean[1];
+		float b = texels[i * 4 + 2] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+
+	// Principal axis by power iteration, starting from the covariance
+	// column of the channel that varies most (a fixed start like gray
+	// can be square to the axis, e.g. a red and green block)
+	int widest = covariance[0] >= covariance[3] ? (covariance[0] >= covariance[5] ? 0 : 2) : (covariance[3] >= covariance[5] ? 1 : 2);
+	float axis[3] = {
+		widest == 0 ? covariance[0] : (widest == 1 ? covariance[1] : covariance[2]),
+		widest == 0 ? covariance[1] : (widest == 1 ? covariance[3] : covariance[4]),
+		widest == 0 ? covariance[2] : (widest == 1 ? covariance[4] : covariance[5]) };
+	for (int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[3] = {
+			covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+			covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+			covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2] };
+		float length = fabsf(next[0]) > fabsf(next[1]) ? fabsf(next[0]) : fabsf(next[1]);
+		length = length > fabsf(next[2]) ? length : fabsf(next[2]);
+		if (length < 1e-6f)
+			break;
+		for (int c = 0; c < 3; c++)
+			axis[c] = next[c] / length;
+	}
+
+	// The texels furthest along the axis each way become the end points
+	int lowest = 0;
+	int highest = 0;
+	float lowestDot = FLT_MAX;
+	float highestDot = -FLT_MAX;
+	for (int i = 0; i < 16; i++)
+	{
+		float dot = texels[i * 4 + 0] * axis[0] + texels[i * 4 + 1] * axis[1] + texels[i * 4 + 2] * axis[2];
+		if (dot < lowestDot)
+		{
+			lowestDot = dot;
+			lowest = i;
+		}
+		if (dot > highestDot)
+		{
+			highestDot = dot;
+			highest = i;
+		}
+	}
+
+	float end0[3] = { (float)texels[highest * 4 + 0], (float)texels[highest * 4 + 1], (float)texels[highest * 4 + 2] };
+	float end1[3] = { (float)texels[lowest * 4 + 0], (float)texels[lowest * 4 + 1], (float)texels[lowest * 4 + 2] };
+	unsigned short color0 = To565(end0);
+	unsigned short color1 = To565(end1);
+	int indices[16];
+	int error = BC1Indices(texels, color0, color1, indices);
+
+	// Then refit the ends to the indices that came out, keeping it if it helps
+	for (int pass = 0; pass < 2 && error > 0; pass++)
+	{
+		if (!BC1Refine(texels, indices, end0, end1))
+			break;
+
+		unsigned short refined0 = To565(end0);
+		unsigned short refined1 = To565(end1);
+		int refinedIndices[16];
+		int refinedError = BC1Indices(texels, refined0, refined1, refinedIndices);
+		if (refinedError >= error)
+			break;
+
+		color0 = refined0;
+		color1 = refined1;
+		error = refinedError;
+		memcpy(indices, refinedIndices, sizeof(indices));
+	}
+
+	// Four color mode needs color0 > color1 - swap the ends (and their
+	// indices) if not.  Equal ends decode as three color mode, where
+	// index 0 is still color0.
+	if (color0 < color1)
+	{
+		unsigned short swap = color0;
+		color0 = color1;
+		color1 = swap;
+		for (int i = 0; i < 16; i++)
+			indices[i] ^= 1;
+	}
+	else if (color0 == color1)
+	{
+		memset(indices, 0, sizeof(indices));
+	}
+
+	unsigned int packedIndices = 0;
+	for (int i = 0; i < 16; i++)
+		packedIndices |= (unsigned int)indices[i] << (i * 2);
+
+	block[0] = (unsigned char)(color0 & 0xFF);
+	block[1] = (unsigned char)(color0 >> 8);
+	block[2] = (unsigned char)(color1 & 0xFF);
+	block[3] = (unsigned char)(color1 >> 8);
+	block[4] = (unsigned char)(packedIndices & 0xFF);
+	block[5] = (unsigned char)((packedIndices >> 8) & 0xFF);
+	block[6] = (unsigned char)((packedIndices >> 16) & 0xFF);
+	block[7] = (unsigned char)(packedIndices >> 24);
+}
+
+void TextureCompressor::CompressBC4(const unsigned char texels[64], int channel, unsigned char* block)
+{
+	int low = 255;
+	int high = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		int value = texels[i * 4 + channel];
+		low = value < low ? value : low;
+		high = value > high ? value : high;
+	}
+
+	// Eight value mode: max, min, then six steps from max down to min
+	int palette[8] = { high, low };
+	for (int k = 2; k < 8; k++)
+		palette[k] = ((8 - k) * high + (k - 1) * low + 3) / 7;
+
+	unsigned long long packedIndices = 0;
+	if (high > low)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			int value = texels[i * 4 + channel];
+			int best = 0;
+			int bestDistance = INT_MAX;
+			for (int p = 0; p < 8; p++)
+			{
+				int distance = abs(value - palette[p]);
+				if (distance < bestDistance)
+				{
+					best = p;
+					bestDistance = distance;
+				}
+			}
+			packedIndices |= (unsigned long long)best << (i * 3);
+		}
+	}
+
+	block[0] = (unsigned char)high;
+	block[1] = (unsigned char)low;
+	for (int b = 0; b < 6; b++)
+		block[2 + b] = (unsigned char)((packedIndices >> (b * 8)) & 0xFF);
+}
+
+void TextureCompressor::DecompressBC1(const unsigned char* block, unsigned char texels[64])
+{
+	unsigned short color0 = (unsigned short)(block[0] | (block[1] << 8));
+	unsigned short color1 = (unsigned short)(block[2] | (block[3] << 8));
+	int palette[4][3];
+	BC1Palette(color0, color1, palette);
+
+	// Three color mode: the middle, then black
+	if (color0 <= color1)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+
+	unsigned int packedIndices = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+	for (int i = 0; i < 16; i++)
+	{
+		int index = (packedIndices >> (i * 2)) & 3;
+		for (int c = 0; c < 3; c++)
+			texels[i * 4 + c] = (unsigned char)palette[index][c];
+		texels[i * 4 + 3] = 255;
+	}
+}
+
+void TextureCompressor::DecompressBC4(const unsigned char* block, int channel, unsigned char texels[64])
+{
+	int high = block[0];
+	int low = block[1];
+	int palette[8] = { high, low };
+	if (high > low)
+	{
+		for (int k = 2; k < 8; k++)
+			palette[k] = ((8 - k) * high + (k - 1) * low + 3) / 7;
+	}
+	else
+	{
+		// Six value mode: six steps, then 0 and 255
+		for (int k = 2; k < 6; k++)
+			palette[k] = ((6 - k) * high + (k - 1) * low + 2) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	unsigned long long packedIndices = 0;
+	for (int b = 0; b < 6; b++)
+		packedIndices |= (unsigned long long)block[2 + b] << (b * 8);
+
+	for (int i = 0; i < 16; i++)
+		texels[i * 4 + channel] = (unsigned char)palette[(packedIndices >> (i * 3)) & 7];
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "MipGenerator.h"
+#include <vector>
+
+// What a texture holds, which decides how it gets compressed
+enum TextureKind
+{
+	ColorTexture,		// BC1 - RGB at 4 bits per texel
+	ColorAlphaTexture,	// BC3 - RGB as BC1 plus a BC4 block of alpha
+	NormalTexture,		// BC5 - just X and Y, shaders rebuild Z
+	GrayscaleTexture,	// BC4 - red channel only
+	SurfaceTexture		// BC5 - roughness and metalness in red and green
+};
+
+// Magic number plus header at the front of every DDS file we write
+static const unsigned int DDS_FILE_HEADER_SIZE = 128;
+
+// --------------------------------------------------------
+// Block compresses RGBA8 mip chains on the CPU
+//
+// The format follows from how many channels the kind keeps.
+// Each 4x4 block is fit independently: BC1 takes its end
+// points from the block's principal color axis and refines
+// them with a least squares pass, while BC4 (and BC5, which
+// is two BC4 blocks) uses the block's min and max.  BC3 is a
+// BC4 block of alpha ahead of a BC1 block.  The output is a
+// plain DDS file that DDSTextureLoader reads.
+//
+// D3D needs the top level of a block compressed texture to
+// be a multiple of 4 both ways - PadToBlocks() repeats the
+// last row and column out to the next one, so nothing is
+// lost but the image no longer fills the texture.  Whoever
+// samples it scales their UVs by the image's share of the
+// texture; BuildDDS() records the image's own size in the
+// header so a cached file can still tell.  Smaller mips can
+// be any size; their partial blocks repeat the edge texels.
+// --------------------------------------------------------
+class TextureCompressor
+{
+public:
+	// Whether the image is at least a block each way
+	static bool CanCompress(const MipLevel& top);
+	static void PadToBlocks(MipLevel& top);
+
+	// Whether any texel is less than fully opaque, which a
+	// ColorTexture needs ColorAlphaTexture to keep
+	static bool HasAlpha(const MipLevel& level);
+
+	// Compresses every level and wraps them up as a DDS file.  The
+	// image's size before padding (0 for the top level's) goes in
+	// the header for ReadImageScale().
+	static void BuildDDS(const std::vector<MipLevel>& mips, TextureKind kind, std::vector<unsigned char>& dds,
+		unsigned int imageWidth = 0, unsigned int imageHeight = 0);
+
+	// The image's size over the texture's, which UVs get scaled by
+	static void ReadImageScale(const unsigned char* dds, float& uScale, float& vScale);
+
+	static void CompressLevel(const MipLevel& level, TextureKind kind, std::vector<unsigned char>& blocks);
+	static void DecompressLevel(const unsigned char* blocks, TextureKind kind, unsigned int width, unsigned int height, MipLevel& level);
+
+	// Peak signal to noise ratio (dB) over the channels the kind keeps
+	static double MeasurePSNR(const MipLevel& original, const MipLevel& decoded, TextureKind kind);
+
+	static unsigned int GetBlockBytes(TextureKind kind);
+
+	// Channels the kind keeps (4 is BC3, 3 is BC1, 2 is BC5, 1 is BC4)
+	static int GetChannelCount(TextureKind kind);
+
+private:
+	static void CompressRows(const MipLevel& level, TextureKind kind, unsigned char* blocks, unsigned int firstRow, unsigned int lastRow);
+	static void CompressBC1(const unsigned char texels[64], unsigned char* block);
+	static void CompressBC4(const unsigned char texels[64], int channel, unsigned char* block);
+	static void DecompressBC1(const unsigned char* block, unsigned char texels[64]);
+	static void DecompressBC4(const unsigned char* block, int channel, unsigned char texels[64]);
+};
@@ -0,0 +1,133 @@
+#include "ThreadPool.h"
+#include <atomic>
+#include <memory>
+
+// Singleton requirement
+ThreadPool* ThreadPool::instance;
+int ThreadPool::requestedThreadCount = 0;
+
+ThreadPool::ThreadPool()
+{
+	stopping = false;
+	threadCount = requestedThreadCount > 0 ? requestedThreadCount : (int)std::thread::hardware_concurrency();
+	if (threadCount < 1)
+		threadCount = 1;
+
+	// Leave one core for the thread that hands out the work.  There's
+	// always at least one worker, or Enqueue'd tasks would never run.
+	int workerCount = threadCount - 1;
+	if (workerCount < 1)
+		workerCount = 1;
+
+	for (int i = 0; i < workerCount; i++)
+	{
+		workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::Shutdown()
+{
+	delete instance;
+	instance = nullptr;
+}
+
+void ThreadPool::SetThreadCount(int threadCount)
+{
+	Shutdown();
+	requestedThreadCount = threadCount;
+}
+
+int ThreadPool::GetThreadCount()
+{
+	return threadCount;
+}
+
+void ThreadPool::ParallelFor(int count, std::function<void(int)> job, TaskPriority priority)
+{
+	if (count <= 0)
+		return;
+
+	// Shared between the caller and every helper task
+	struct Batch
+	{
+		std::atomic<int> next;
+		std::atomic<int> finished;
+		std::mutex doneMutex;
+		std::condition_variable doneCondition;
+	};
+	std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+	batch->next = 0;
+	batch->finished = 0;
+
+	// Grabs indices until there are none left
+	auto runJobs = [batch, count, job]()
+	{
+		int i;
+		while ((i = batch->next++) < count)
+		{
+			job(i);
+			if (++batch->finished == count)
+			{
+				std::lock_guard<std::mutex> lock(batch->doneMutex);
+				batch->doneCondition.notify_all();
+			}
+		}
+	};
+
+	int helpers = count - 1 < threadCount - 1 ? count - 1 : threadCount - 1;
+	for (int i = 0; i < helpers; i++)
+	{
+		Enqueue(runJobs, priority);
+	}
+
+	// Work on this thread too, then wait for any stragglers
+	runJobs();
+
+	std::unique_lock<std::mutex> lock(batch->doneMutex);
+	batch->doneCondition.wait(lock, [&]() { return batch->finished == count; });
+}
+
+void ThreadPool::Enqueue(std::function<void()> task, TaskPriority priority)
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		if (priority == FramePriority)
+			frameTasks.push_back(task);
+		else
+			tasks.push_back(task);
+	}
+	queueCondition.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this]() { return stopping || !tasks.empty() || !frameTasks.empty(); });
+			if (stopping && tasks.empty() && frameTasks.empty())
+				return;
+
+			std::deque<std::function<void()>>& queue = frameTasks.empty() ? tasks : frameTasks;
+			task = queue.front();
+			queue.pop_front();
+		}
+		task();
+	}
+}
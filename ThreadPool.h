@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Which queue a task waits in
+enum TaskPriority
+{
+	BackgroundPriority,	// Loading and cooking assets - fine to wait
+	FramePriority		// Work the current frame is blocked on
+};
+
+// --------------------------------------------------------
+// A fixed set of worker threads shared by the whole program
+//
+// Used for splitting up big CPU jobs (like parsing large
+// model files) across every core.  Frame tasks go ahead of
+// background ones, though a worker already busy with a long
+// background task only gets to them once it's done.
+// --------------------------------------------------------
+class ThreadPool
+{
+#pragma region Singleton
+public:
+	// Gets the one and only instance of this class
+	static ThreadPool& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new ThreadPool();
+		}
+
+		return *instance;
+	}
+
+	// Finishes every queued task, joins the workers and deletes the
+	// pool.  Called once at exit - a later GetInstance() makes a new one.
+	static void Shutdown();
+
+	// Replaces the pool with one that runs threadCount jobs at once
+	// (0 goes back to one per core).  Only for tests and benchmarks -
+	// nothing can be using the old pool.
+	static void SetThreadCount(int threadCount);
+
+	// Remove these functions (C++ 11 version)
+	ThreadPool(ThreadPool const&) = delete;
+	void operator=(ThreadPool const&) = delete;
+
+private:
+	static ThreadPool* instance;
+	static int requestedThreadCount;
+	ThreadPool();
+#pragma endregion
+
+public:
+	~ThreadPool();
+
+	// Number of threads that can run jobs at once (workers + the caller)
+	int GetThreadCount();
+
+	// Runs job(0) ... job(count - 1) across the pool and returns once
+	// they have all finished.  The calling thread helps out, so this is
+	// safe to call from inside another job.
+	void ParallelFor(int count, std::function<void(int)> job, TaskPriority priority = BackgroundPriority);
+
+	// Queues a task to run on a worker without waiting for it
+	void Enqueue(std::function<void()> task, TaskPriority priority = BackgroundPriority);
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::deque<std::function<void()>> frameTasks; // Run before anything in tasks
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	bool stopping;
+	int threadCount;
+};
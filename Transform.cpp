@@ -92,6 +92,26 @@ DirectX::XMFLOAT3 Transform::GetForward()
     return forward;
 }
 
+DirectX::BoundingBox Transform::GetWorldBounds(const DirectX::BoundingBox& localBounds)
+{
+    UpdateMatrices();
+
+    // Gives the axis-aligned box around the rotated box
+    BoundingBox worldBounds;
+    localBounds.Transform(worldBounds, XMLoadFloat4x4(&worldMatrix));
+    return worldBounds;
+}
+
+DirectX::BoundingSphere Transform::GetWorldBounds(const DirectX::BoundingSphere& localBounds)
+{
+    UpdateMatrices();
+
+    // Radius grows by the largest of the three scales
+    BoundingSphere worldBounds;
+    localBounds.Transform(worldBounds, XMLoadFloat4x4(&worldMatrix));
+    return worldBounds;
+}
+
 void Transform::SetPosition(float x, float y, float z)
 {
     position = XMFLOAT3(x, y, z);
@@ -1,5 +1,6 @@
 #pragma once
 #include <DirectXMath.h>
+#include <DirectXCollision.h>
 class Transform
 {
 public:
@@ -16,6 +17,10 @@ public:
     DirectX::XMFLOAT3 GetRight();
     DirectX::XMFLOAT3 GetForward();
 
+    // Moves local space bounds (like a Mesh's) into world space
+    DirectX::BoundingBox GetWorldBounds(const DirectX::BoundingBox& localBounds);
+    DirectX::BoundingSphere GetWorldBounds(const DirectX::BoundingSphere& localBounds);
+
 
     // Setters
     void SetPosition(float x, float y, float z);
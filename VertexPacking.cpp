@@ -0,0 +1,120 @@
+#include "VertexPacking.h"
+#include <math.h>
+#include <string.h>
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+void VertexPacker::Pack(const Vertex* vertices, int vertexCount, XMFLOAT3 center, XMFLOAT3 extents, PackedVertex* packed)
+{
+	// Flat meshes have a zero extent on one axis - everything on
+	// that axis is at the center, so just store zeros
+	XMFLOAT3 scale(
+		extents.x > 0.0f ? 1.0f / extents.x : 0.0f,
+		extents.y > 0.0f ? 1.0f / extents.y : 0.0f,
+		extents.z > 0.0f ? 1.0f / extents.z : 0.0f);
+
+	for (int i = 0; i < vertexCount; i++)
+	{
+		const Vertex& v = vertices[i];
+		PackedVertex& p = packed[i];
+
+		p.Position[0] = ToSnorm16((v.Position.x - center.x) * scale.x);
+		p.Position[1] = ToSnorm16((v.Position.y - center.y) * scale.y);
+		p.Position[2] = ToSnorm16((v.Position.z - center.z) * scale.z);
+		p.Position[3] = 0;
+
+		XMFLOAT2 normal = OctahedronEncode(v.Normal);
+		p.Normal[0] = ToSnorm16(normal.x);
+		p.Normal[1] = ToSnorm16(normal.y);
+
+		p.UV[0] = XMConvertFloatToHalf(v.UV.x);
+		p.UV[1] = XMConvertFloatToHalf(v.UV.y);
+
+		XMFLOAT2 tangent = OctahedronEncode(v.Tangent);
+		p.Tangent[0] = ToSnorm16(tangent.x);
+		p.Tangent[1] = ToSnorm16(tangent.y);
+	}
+}
+
+// Same math as UnpackVertex in ShaderIncludes.hlsli
+Vertex VertexPacker::Unpack(const PackedVertex& packed, XMFLOAT3 center, XMFLOAT3 extents)
+{
+	Vertex v;
+	v.Position = XMFLOAT3(
+		center.x + FromSnorm16(packed.Position[0]) * extents.x,
+		center.y + FromSnorm16(packed.Position[1]) * extents.y,
+		center.z + FromSnorm16(packed.Position[2]) * extents.z);
+	v.Normal = OctahedronDecode(XMFLOAT2(FromSnorm16(packed.Normal[0]), FromSnorm16(packed.Normal[1])));
+	v.UV = XMFLOAT2(XMConvertHalfToFloat(packed.UV[0]), XMConvertHalfToFloat(packed.UV[1]));
+	v.Tangent = OctahedronDecode(XMFLOAT2(FromSnorm16(packed.Tangent[0]), FromSnorm16(packed.Tangent[1])));
+	return v;
+}
+
+void VertexPacker::ExtractPositions(const Vertex* vertices, int vertexCount, std::vector<XMFLOAT3>& positions)
+{
+	positions.resize(vertexCount);
+	for (int i = 0; i < vertexCount; i++)
+	{
+		positions[i] = vertices[i].Position;
+	}
+}
+
+void VertexPacker::ExtractPositions(const PackedVertex* vertices, int vertexCount, std::vector<PackedPosition>& positions)
+{
+	positions.resize(vertexCount);
+	for (int i = 0; i < vertexCount; i++)
+	{
+		memcpy(positions[i].Position, vertices[i].Position, sizeof(PackedPosition));
+	}
+}
+
+XMFLOAT2 VertexPacker::OctahedronEncode(XMFLOAT3 direction)
+{
+	// Project onto the octahedron |x| + |y| + |z| = 1
+	float sum = fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+	if (sum == 0.0f)
+		return XMFLOAT2(0, 0);
+
+	float x = direction.x / sum;
+	float y = direction.y / sum;
+
+	// Fold the lower half over the upper half's corners
+	if (direction.z < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+	return XMFLOAT2(x, y);
+}
+
+XMFLOAT3 VertexPacker::OctahedronDecode(XMFLOAT2 encoded)
+{
+	XMFLOAT3 direction(encoded.x, encoded.y, 1.0f - fabsf(encoded.x) - fabsf(encoded.y));
+
+	// Unfold the lower half
+	float t = direction.z < 0.0f ? -direction.z : 0.0f;
+	direction.x += direction.x >= 0.0f ? -t : t;
+	direction.y += direction.y >= 0.0f ? -t : t;
+
+	XMFLOAT3 normalized;
+	XMStoreFloat3(&normalized, XMVector3Normalize(XMLoadFloat3(&direction)));
+	return normalized;
+}
+
+short VertexPacker::ToSnorm16(float value)
+{
+	if (value > 1.0f)
+		value = 1.0f;
+	if (value < -1.0f)
+		value = -1.0f;
+	return (short)lroundf(value * 32767.0f);
+}
+
+// -32768 and -32767 both mean -1, same as the GPU
+float VertexPacker::FromSnorm16(short value)
+{
+	float f = value / 32767.0f;
+	return f < -1.0f ? -1.0f : f;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Vertex.h"
+#include <DirectXPackedVector.h>
+#include <vector>
+
+// --------------------------------------------------------
+// A compressed Vertex - 20 bytes instead of 44
+//
+// Must match VertexShaderInputPacked in ShaderIncludes.hlsli
+// and the layout made by Mesh::CreatePackedInputLayout.
+// --------------------------------------------------------
+struct PackedVertex
+{
+	short Position[4];	// xyz relative to the mesh bounds (SNORM16), w unused
+	short Normal[2];	// Octahedral (SNORM16)
+	DirectX::PackedVector::HALF UV[2];
+	short Tangent[2];	// Octahedral (SNORM16)
+};
+
+// Just the position of a PackedVertex, in the same format
+struct PackedPosition
+{
+	short Position[4];
+};
+
+// --------------------------------------------------------
+// Converts between Vertex and PackedVertex
+//
+// Positions are stored as -1 to 1 across the mesh's bounding
+// box, so they need that box's center and extents to decode.
+// Normals and tangents are folded onto an octahedron, which
+// spreads the precision evenly over every direction.
+// --------------------------------------------------------
+class VertexPacker
+{
+public:
+	static void Pack(const Vertex* vertices, int vertexCount, DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 extents, PackedVertex* packed);
+	static Vertex Unpack(const PackedVertex& packed, DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 extents);
+
+	// Copies out just the positions, for position-only vertex streams
+	static void ExtractPositions(const Vertex* vertices, int vertexCount, std::vector<DirectX::XMFLOAT3>& positions);
+	static void ExtractPositions(const PackedVertex* vertices, int vertexCount, std::vector<PackedPosition>& positions);
+
+	static DirectX::XMFLOAT2 OctahedronEncode(DirectX::XMFLOAT3 direction);
+	static DirectX::XMFLOAT3 OctahedronDecode(DirectX::XMFLOAT2 encoded);
+
+private:
+	static short ToSnorm16(float value);
+	static float FromSnorm16(short value);
+};
@@ -8,10 +8,22 @@ cbuffer ExternalData : register(b0)
 
 	matrix shadowView;
 	matrix shadowProjection;
+
+#ifdef PACKED_VERTICES
+	// The mesh's bounding box, for decoding positions
+	float3 positionCenter;
+	float3 positionExtents;
+#endif
 }
 
+#ifdef PACKED_VERTICES
+VertexToPixel main( VertexShaderInputPacked packed )
+{
+	VertexShaderInput input = UnpackVertex(packed, positionCenter, positionExtents);
+#else
 VertexToPixel main( VertexShaderInput input )
 {
+#endif
 	VertexToPixel output;
 	matrix wvp = mul(projection, mul(view, world));
 	output.position = mul(wvp, float4(input.position, 1.0f));
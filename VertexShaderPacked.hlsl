@@ -0,0 +1,3 @@
+// VertexShader.hlsl for meshes with PackedVertex data
+#define PACKED_VERTICES
+#include "VertexShader.hlsl"
@@ -5,6 +5,12 @@ cbuffer externalData : register(b0)
 	matrix world;
 	matrix view;
 	matrix projection;
+
+#ifdef PACKED_VERTICES
+	// The mesh's bounding box, for decoding positions
+	float3 positionCenter;
+	float3 positionExtents;
+#endif
 };
 
 // --------------------------------------------------------
@@ -12,8 +18,16 @@ cbuffer externalData : register(b0)
 // --------------------------------------------------------
 
 
-float4 main(VertexShaderInput input) : SV_POSITION
+// Only positions come in (see Mesh::DrawPositionOnly)
+#ifdef PACKED_VERTICES
+float4 main(VertexShaderInputPositionPacked packed) : SV_POSITION
+{
+	VertexShaderInputPosition input;
+	input.position = UnpackPosition(packed.position, positionCenter, positionExtents);
+#else
+float4 main(VertexShaderInputPosition input) : SV_POSITION
 {
+#endif
 	matrix wvp = mul(projection, mul(view, world));
 	return mul(wvp, float4(input.position, 1.0f));
 }
\ No newline at end of file
@@ -0,0 +1,3 @@
+// VertexShaderShadow.hlsl for meshes with PackedVertex data
+#define PACKED_VERTICES
+#include "VertexShaderShadow.hlsl"